@@ -36,6 +36,7 @@
 #include <string>
 
 #include <wx/filename.h>
+#include <wx/log.h>
 #include <wx/stdpaths.h>
 
 #include "hgkamva/util/FileUtil.h"
@@ -46,6 +47,7 @@ BEGIN_EVENT_TABLE(HgKamvaWxWindow, wxWindow)
 EVT_SIZE(HgKamvaWxWindow::onSize)
 EVT_PAINT(HgKamvaWxWindow::onPaint)
 EVT_ERASE_BACKGROUND(HgKamvaWxWindow::onEraseBackground)
+EVT_IDLE(HgKamvaWxWindow::onIdle)
 END_EVENT_TABLE()
 
 HgKamvaWxWindow::HgKamvaWxWindow(wxWindow* parent,
@@ -129,17 +131,19 @@ void HgKamvaWxWindow::initHgContainer()
   hgContainer_setDefaultFontName(mHgHtmlRenderer, "Tinos");
   hgContainer_setFontTextCacheSize(mHgHtmlRenderer, 10000);
 
+  // Prerender up to 512 px ahead of the scrolling in the idle time.
+  hgHtmlRenderer_setOverscanMargin(mHgHtmlRenderer, 512);
+
   std::string masterCss =
       hg::util::readFile(masterCssFile.GetFullPath().ToStdString());
   assert(masterCss.size());
 
   hgHtmlContext_loadMasterStylesheet(mHgHtmlRenderer, masterCss.c_str());
 
-  std::string htmlText =
-      hg::util::readFile(htmlFile.GetFullPath().ToStdString());
-  assert(htmlText.size());
-
-  hgHtmlRenderer_createHtmlDocumentFromUtf8(mHgHtmlRenderer, htmlText.c_str());
+  if(!hgHtmlRenderer_createHtmlDocumentFromFile(
+         mHgHtmlRenderer, htmlFile.GetFullPath().ToStdString().c_str())) {
+    wxLogError("Can not load the HTML file %s", htmlFile.GetFullPath());
+  }
 }
 
 void HgKamvaWxWindow::setBitmap(const int width, const int height)
@@ -275,6 +279,13 @@ void HgKamvaWxWindow::onPaint(wxPaintEvent& event)
   }
 }
 
+void HgKamvaWxWindow::onIdle(wxIdleEvent& event)
+{
+  if(hgHtmlRenderer_prerenderOverscan(mHgHtmlRenderer)) {
+    event.RequestMore();
+  }
+}
+
 void HgKamvaWxWindow::onEraseBackground(wxEraseEvent& WXUNUSED(event))
 {
   // Do nothing to "avoid flashing in MSW"  Grr.
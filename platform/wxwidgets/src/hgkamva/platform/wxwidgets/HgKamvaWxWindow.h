@@ -91,6 +91,9 @@ protected:
   /// Paint the bitmap onto the panel.
   void onPaint(wxPaintEvent& event);
 
+  /// Prerender the overscan in the idle time.
+  void onIdle(wxIdleEvent& event);
+
   /// Handle the erase-background event.
   void onEraseBackground(wxEraseEvent& event);
 
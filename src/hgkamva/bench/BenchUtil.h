@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_BENCH_UTIL_H
+#define HG_BENCH_UTIL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "litehtml.h"
+
+#include "hgkamva/renderer/HgHtmlRenderer.h"
+#include "hgkamva/util/FileUtil.h"
+#include "hgkamva/util/Filesystem.h"
+
+namespace hg
+{
+namespace bench
+{
+using Clock = std::chrono::steady_clock;
+
+inline double elapsedMicroseconds(Clock::time_point start)
+{
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - start);
+  return elapsed.count() / 1000.0;
+}
+
+// Nearest-rank percentile, `values` is sorted in place.
+inline double percentile(std::vector<double>& values, double pct)
+{
+  if(values.empty()) {
+    return 0.0;
+  }
+  std::sort(values.begin(), values.end());
+  std::size_t rank = static_cast<std::size_t>(pct / 100.0 * values.size());
+  return values[std::min(rank, values.size() - 1)];
+}
+
+// Same set up as in the renderer tests: test fonts, 96 DPI, screen media.
+inline bool initRenderer(HgHtmlRenderer& renderer,
+    const hg::filesystem::path& fontDir,
+    const hg::filesystem::path& dataDir)
+{
+  HgContainerPtr container = renderer.getHgContainer();
+
+  std::string fontConfig = hg::util::readFile(fontDir / "fonts.conf");
+  if(fontConfig.empty()
+      || !container->parseAndLoadFontConfigFromMemory(fontConfig, true)
+      || !container->addFontDir(fontDir)) {
+    return false;
+  }
+
+  container->setFontTextCacheSize(10000);
+  container->setDefaultFontName("Tinos");
+  container->setDefaultFontSize(16);
+
+  container->setDeviceDpiX(96);
+  container->setDeviceDpiY(96);
+  container->setDeviceMonochromeBits(0);
+  container->setDeviceColorBits(8);
+  container->setDeviceColorIndex(256);
+  container->setDeviceMediaType(litehtml::media_type_screen);
+
+  std::string masterCss = hg::util::readFile(dataDir / "master.css");
+  if(masterCss.empty()) {
+    return false;
+  }
+  renderer.getHtmlContext()->load_master_stylesheet(masterCss.c_str());
+  renderer.setBackgroundColor(litehtml::web_color(255, 255, 255));
+  return true;
+}
+
+}  // namespace bench
+}  // namespace hg
+
+#endif  // HG_BENCH_UTIL_H
@@ -0,0 +1,194 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+// Keystroke-to-pixels latency of the editing path against the document
+// size. For every size a generated document of N paragraphs is loaded,
+// then single characters are inserted into and deleted from a paragraph
+// in the middle of the viewport, every edit is followed by drawHtml()
+// at the same position. The caret rows also hit-test the caret after
+// every edit, which uses the text index updated by the edit. The latency
+// of an edit and its frame should not grow with the document size.
+//
+// Usage:
+//   HgKeystroke_bench [--repeat N] [--edits N] [--paragraphs N]...
+// Without --paragraphs the sizes 1000, 10000 and 100000 are measured.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <cairo/cairo.h>
+
+#include "hgkamva/bench/BenchUtil.h"
+#include "hgkamva/renderer/HgHtmlRenderer.h"
+#include "hgkamva/util/Filesystem.h"
+
+namespace
+{
+std::string generateDocument(int paragraphs)
+{
+  std::string htmlText = "<html><body>";
+  for(int i = 0; i < paragraphs; ++i) {
+    htmlText += "<p>Paragraph " + std::to_string(i)
+        + " of the generated document with some words to wrap.</p>";
+  }
+  htmlText += "</body></html>";
+  return htmlText;
+}
+
+struct EditResult
+{
+  std::vector<double> mEditMicros;
+  std::vector<double> mFrameBytes;
+  double mLoadMicros = 0;
+};
+
+bool edit(hg::HgHtmlRenderer& renderer,
+    const std::string& htmlText,
+    const int edits,
+    const bool caret,
+    EditResult& result)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int width = 640;
+  const int height = 480;
+  const int stride = cairo_format_stride_for_width(colorFormat, width);
+  std::vector<unsigned char> frameBuf(stride * height);
+
+  auto start = hg::bench::Clock::now();
+  renderer.createHtmlDocumentFromUtf8(htmlText);
+  renderer.renderHtml(width, height);
+  result.mLoadMicros += hg::bench::elapsedMicroseconds(start);
+
+  // The viewport in the middle of the document.
+  const int htmlX = 0;
+  const int htmlY = std::max(0, renderer.getDocument()->height() / 2);
+  renderer.drawHtml(
+      frameBuf.data(), colorFormat, width, height, stride, htmlX, htmlY);
+
+  // The edited paragraph is in the middle of the viewport.
+  hg::HgTextIndex::HitTestResult hit;
+  if(!renderer.hitTest(width / 2, htmlY + height / 2, hit)) {
+    return false;
+  }
+  const hg::HgTextIndex& textIndex = renderer.getDocument()->textIndex();
+  litehtml::element::ptr paragraph =
+      textIndex.runs()[hit.mRunIndex].mElement->parent();
+
+  for(int i = 0; i < edits; ++i) {
+    // The first word is replaced by every edit, take the current one.
+    litehtml::element::ptr word = paragraph->get_child(0);
+
+    start = hg::bench::Clock::now();
+    if(i % 2 == 0) {
+      renderer.insertText(word, 1, "x");
+    } else {
+      renderer.deleteText(word, 1, 1);
+    }
+    if(caret && !renderer.hitTest(width / 2, htmlY + height / 2, hit)) {
+      return false;
+    }
+    renderer.drawHtml(
+        frameBuf.data(), colorFormat, width, height, stride, htmlX, htmlY);
+    result.mEditMicros.push_back(hg::bench::elapsedMicroseconds(start));
+
+    const auto& stats = renderer.lastDrawStats();
+    result.mFrameBytes.push_back(static_cast<double>(
+        stats.mCopiedBytes + stats.mDrawnBytes + stats.mOverscanBytes));
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  hg::filesystem::path testDir =
+      hg::filesystem::absolute(hg::filesystem::path(argv[0]).parent_path());
+  hg::filesystem::path fontDir = testDir / "fonts";
+  hg::filesystem::path dataDir = testDir / "data";
+
+  int repeat = 3;
+  int edits = 50;
+  std::vector<int> sizes;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if(i + 1 < argc && arg == "--repeat") {
+      repeat = std::atoi(argv[++i]);
+    } else if(i + 1 < argc && arg == "--edits") {
+      edits = std::atoi(argv[++i]);
+    } else if(i + 1 < argc && arg == "--paragraphs") {
+      sizes.push_back(std::atoi(argv[++i]));
+    } else {
+      std::fprintf(stderr,
+          "Usage: %s [--repeat N] [--edits N] [--paragraphs N]...\n",
+          argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if(sizes.empty()) {
+    sizes = {1000, 10000, 100000};
+  }
+
+  std::printf("%10s %6s %6s %12s %10s %10s %10s %12s\n", "paragraphs",
+      "caret", "edits", "load(us)", "p50(us)", "p95(us)", "p99(us)",
+      "bytes/frame");
+
+  for(int size : sizes) {
+    std::string htmlText = generateDocument(size);
+
+    for(bool caret : {false, true}) {
+      EditResult result;
+      for(int i = 0; i < repeat; ++i) {
+        hg::HgHtmlRenderer renderer;
+        if(!hg::bench::initRenderer(renderer, fontDir, dataDir)) {
+          std::fprintf(stderr, "Can not init renderer\n");
+          return EXIT_FAILURE;
+        }
+        if(!edit(renderer, htmlText, edits, caret, result)) {
+          std::fprintf(stderr, "No text to edit\n");
+          return EXIT_FAILURE;
+        }
+      }
+      result.mLoadMicros /= repeat > 0 ? repeat : 1;
+
+      double totalBytes = 0;
+      for(double bytes : result.mFrameBytes) {
+        totalBytes += bytes;
+      }
+      std::size_t frames = result.mEditMicros.size();
+
+      std::printf("%10d %6s %6zu %12.0f %10.0f %10.0f %10.0f %12.0f\n", size,
+          caret ? "yes" : "no", frames, result.mLoadMicros,
+          hg::bench::percentile(result.mEditMicros, 50),
+          hg::bench::percentile(result.mEditMicros, 95),
+          hg::bench::percentile(result.mEditMicros, 99),
+          frames ? totalBytes / frames : 0.0);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
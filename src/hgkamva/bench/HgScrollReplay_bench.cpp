@@ -0,0 +1,259 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+// Headless replay of recorded scroll and resize traces against
+// HgHtmlRenderer. For every document of the corpus and every trace prints
+// the per-frame latency percentiles and the number of buffer bytes touched.
+//
+// Usage:
+//   HgScrollReplay_bench [--repeat N] [--overscan pixels]
+//       [--doc file.html]... [--trace file]...
+// Without --doc and --trace the whole corpus from data/corpus is replayed.
+// With --overscan the idle time between frames is simulated by the untimed
+// HgHtmlRenderer::prerenderOverscan() calls.
+//
+// Trace format, one command per line, '#' starts a comment:
+//   resize <width> <height>  -- relayout the document and reallocate buffer;
+//   scroll <htmlX> <htmlY>   -- draw a frame at the given document position.
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cairo/cairo.h>
+
+#include "hgkamva/bench/BenchUtil.h"
+#include "hgkamva/renderer/HgHtmlRenderer.h"
+#include "hgkamva/util/FileUtil.h"
+#include "hgkamva/util/Filesystem.h"
+#include "hgkamva/util/StringUtil.h"
+
+namespace
+{
+struct TraceCommand
+{
+  enum Type
+  {
+    resize,
+    scroll,
+  };
+
+  Type mType;
+  int mX;
+  int mY;
+};
+
+using Trace = std::vector<TraceCommand>;
+
+bool readTrace(const hg::filesystem::path& filePath, Trace& trace)
+{
+  std::ifstream ifs(filePath.string());
+  if(ifs.fail()) {
+    return false;
+  }
+
+  std::string line;
+  while(std::getline(ifs, line)) {
+    std::istringstream iss(line);
+    std::string command;
+    if(!(iss >> command) || command[0] == '#') {
+      continue;
+    }
+
+    TraceCommand traceCommand;
+    if(command == "resize") {
+      traceCommand.mType = TraceCommand::resize;
+    } else if(command == "scroll") {
+      traceCommand.mType = TraceCommand::scroll;
+    } else {
+      return false;
+    }
+    if(!(iss >> traceCommand.mX >> traceCommand.mY)) {
+      return false;
+    }
+    trace.push_back(traceCommand);
+  }
+  return true;
+}
+
+struct ReplayResult
+{
+  std::vector<double> mFrameMicros;
+  std::vector<double> mFrameBytes;
+  double mLoadMicros = 0;
+};
+
+void replay(hg::HgHtmlRenderer& renderer,
+    const std::string& htmlText,
+    const Trace& trace,
+    const int overscan,
+    ReplayResult& result)
+{
+  renderer.setOverscanMargin(overscan);
+
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  int width = 640;
+  int height = 480;
+  int stride = cairo_format_stride_for_width(colorFormat, width);
+  std::vector<unsigned char> frameBuf(stride * height);
+
+  auto start = hg::bench::Clock::now();
+  renderer.createHtmlDocumentFromUtf8(htmlText);
+  renderer.renderHtml(width, height);
+  result.mLoadMicros += hg::bench::elapsedMicroseconds(start);
+
+  int htmlX = 0;
+  int htmlY = 0;
+  for(const auto& command : trace) {
+    start = hg::bench::Clock::now();
+
+    if(command.mType == TraceCommand::resize) {
+      width = command.mX;
+      height = command.mY;
+      stride = cairo_format_stride_for_width(colorFormat, width);
+      frameBuf.resize(stride * height);
+      renderer.renderHtml(width, height);
+    } else {
+      htmlX = command.mX;
+      htmlY = command.mY;
+    }
+
+    renderer.drawHtml(frameBuf.data(), colorFormat, width, height, stride,
+        htmlX, htmlY);
+
+    result.mFrameMicros.push_back(hg::bench::elapsedMicroseconds(start));
+    const auto& stats = renderer.lastDrawStats();
+    result.mFrameBytes.push_back(static_cast<double>(
+        stats.mCopiedBytes + stats.mDrawnBytes + stats.mOverscanBytes));
+
+    // Idle time.
+    if(overscan > 0) {
+      renderer.prerenderOverscan();
+    }
+  }
+}
+
+void printResult(const std::string& docName,
+    const std::string& traceName,
+    ReplayResult& result)
+{
+  std::size_t frames = result.mFrameMicros.size();
+  double totalBytes = 0;
+  for(double bytes : result.mFrameBytes) {
+    totalBytes += bytes;
+  }
+
+  std::printf("%-20s %-12s %6zu %10.0f %10.0f %10.0f %10.0f %12.0f\n",
+      docName.c_str(), traceName.c_str(), frames, result.mLoadMicros,
+      hg::bench::percentile(result.mFrameMicros, 50),
+      hg::bench::percentile(result.mFrameMicros, 95),
+      hg::bench::percentile(result.mFrameMicros, 99),
+      frames ? totalBytes / frames : 0.0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  hg::filesystem::path testDir =
+      hg::filesystem::absolute(hg::filesystem::path(argv[0]).parent_path());
+  hg::filesystem::path fontDir = testDir / "fonts";
+  hg::filesystem::path dataDir = testDir / "data";
+  hg::filesystem::path corpusDir = dataDir / "corpus";
+
+  int repeat = 3;
+  int overscan = 0;
+  std::vector<hg::filesystem::path> docFiles;
+  std::vector<hg::filesystem::path> traceFiles;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if(i + 1 < argc && arg == "--repeat") {
+      repeat = std::atoi(argv[++i]);
+    } else if(i + 1 < argc && arg == "--overscan") {
+      overscan = std::atoi(argv[++i]);
+    } else if(i + 1 < argc && arg == "--doc") {
+      docFiles.emplace_back(argv[++i]);
+    } else if(i + 1 < argc && arg == "--trace") {
+      traceFiles.emplace_back(argv[++i]);
+    } else {
+      std::fprintf(stderr,
+          "Usage: %s [--repeat N] [--overscan pixels]"
+          " [--doc file.html]... [--trace file]...\n",
+          argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if(docFiles.empty() || traceFiles.empty()) {
+    for(const auto& entry : hg::filesystem::directory_iterator(corpusDir)) {
+      std::string name = entry.path().filename().string();
+      if(docFiles.empty() && hg::util::stringEndsWith(name, ".html")) {
+        docFiles.push_back(entry.path());
+      }
+      if(traceFiles.empty() && hg::util::stringEndsWith(name, ".trace")) {
+        traceFiles.push_back(entry.path());
+      }
+    }
+  }
+  std::sort(docFiles.begin(), docFiles.end());
+  std::sort(traceFiles.begin(), traceFiles.end());
+
+  std::printf("%-20s %-12s %6s %10s %10s %10s %10s %12s\n", "document",
+      "trace", "frames", "load(us)", "p50(us)", "p95(us)", "p99(us)",
+      "bytes/frame");
+
+  for(const auto& traceFile : traceFiles) {
+    Trace trace;
+    if(!readTrace(traceFile, trace)) {
+      std::fprintf(stderr, "Can not read trace %s\n", traceFile.c_str());
+      return EXIT_FAILURE;
+    }
+
+    for(const auto& docFile : docFiles) {
+      std::string htmlText = hg::util::readFile(docFile);
+      if(htmlText.empty()) {
+        std::fprintf(stderr, "Can not read document %s\n", docFile.c_str());
+        return EXIT_FAILURE;
+      }
+
+      ReplayResult result;
+      for(int i = 0; i < repeat; ++i) {
+        hg::HgHtmlRenderer renderer;
+        if(!hg::bench::initRenderer(renderer, fontDir, dataDir)) {
+          std::fprintf(stderr, "Can not init renderer\n");
+          return EXIT_FAILURE;
+        }
+        replay(renderer, htmlText, trace, overscan, result);
+      }
+      result.mLoadMicros /= repeat > 0 ? repeat : 1;
+
+      printResult(docFile.stem().string(), traceFile.stem().string(), result);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -1,11 +1,167 @@
 #include "hgkamva/container/HgCairo.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <stdexcept>
 
 #include <cairo/cairo-ft.h>
+#include <pixman.h>
 
 namespace hg
 {
+namespace
+{
+pixman_format_code_t toPixmanFormat(cairo_format_t format)
+{
+  switch(format) {
+    case CAIRO_FORMAT_ARGB32:
+      return PIXMAN_a8r8g8b8;
+    case CAIRO_FORMAT_RGB24:
+      return PIXMAN_x8r8g8b8;
+    case CAIRO_FORMAT_RGB30:
+      return PIXMAN_x2r10g10b10;
+    case CAIRO_FORMAT_RGB16_565:
+      return PIXMAN_r5g6b5;
+    case CAIRO_FORMAT_A8:
+      return PIXMAN_a8;
+    default:
+      throw std::logic_error("Pixman's format is not supported");
+  }
+}
+
+using PixmanImagePtr = std::unique_ptr<pixman_image_t,
+    decltype(&pixman_image_unref)>;
+
+PixmanImagePtr newPixmanImage(cairo_surface_t* surface)
+{
+  PixmanImagePtr image{
+      pixman_image_create_bits(
+          toPixmanFormat(cairo_image_surface_get_format(surface)),
+          cairo_image_surface_get_width(surface),
+          cairo_image_surface_get_height(surface),
+          reinterpret_cast<uint32_t*>(cairo_image_surface_get_data(surface)),
+          cairo_image_surface_get_stride(surface)),
+      pixman_image_unref};
+  if(!image) {
+    throw std::logic_error("Pixman's image is not created");
+  }
+  return image;
+}
+
+const double PI = 3.14159265358979323846;
+
+// The CSS radii are reduced proportionally if they are over the sides.
+double radiiFactor(const litehtml::position& rect,
+    const litehtml::border_radiuses& radii)
+{
+  double factor = 1;
+  auto fit = [&factor](double radiusSum, double side) {
+    if(radiusSum > side) {
+      factor = std::min(factor, side / radiusSum);
+    }
+  };
+  fit(radii.top_left_x + radii.top_right_x, rect.width);
+  fit(radii.bottom_left_x + radii.bottom_right_x, rect.width);
+  fit(radii.top_left_y + radii.bottom_left_y, rect.height);
+  fit(radii.top_right_y + radii.bottom_right_y, rect.height);
+  return factor;
+}
+
+void addCorner(cairo_t* context,
+    double cornerX,
+    double cornerY,
+    double radiusX,
+    double radiusY,
+    double centerX,
+    double centerY,
+    double angle)
+{
+  if(radiusX <= 0 || radiusY <= 0) {
+    cairo_line_to(context, cornerX, cornerY);
+    return;
+  }
+  cairo_save(context);
+  cairo_translate(context, centerX, centerY);
+  cairo_scale(context, radiusX, radiusY);
+  cairo_arc(context, 0, 0, 1, angle, angle + PI / 2);
+  cairo_restore(context);
+}
+
+void addRoundedRect(cairo_t* context,
+    const litehtml::position& rect,
+    const litehtml::border_radiuses& radii)
+{
+  const double factor = radiiFactor(rect, radii);
+  const double left = rect.left();
+  const double top = rect.top();
+  const double right = rect.right();
+  const double bottom = rect.bottom();
+  const double topLeftX = radii.top_left_x * factor;
+  const double topLeftY = radii.top_left_y * factor;
+  const double topRightX = radii.top_right_x * factor;
+  const double topRightY = radii.top_right_y * factor;
+  const double bottomRightX = radii.bottom_right_x * factor;
+  const double bottomRightY = radii.bottom_right_y * factor;
+  const double bottomLeftX = radii.bottom_left_x * factor;
+  const double bottomLeftY = radii.bottom_left_y * factor;
+
+  cairo_new_sub_path(context);
+  addCorner(context, left, top, topLeftX, topLeftY, left + topLeftX,
+      top + topLeftY, PI);
+  addCorner(context, right, top, topRightX, topRightY, right - topRightX,
+      top + topRightY, PI * 3 / 2);
+  addCorner(context, right, bottom, bottomRightX, bottomRightY,
+      right - bottomRightX, bottom - bottomRightY, 0);
+  addCorner(context, left, bottom, bottomLeftX, bottomLeftY,
+      left + bottomLeftX, bottom - bottomLeftY, PI / 2);
+  cairo_close_path(context);
+}
+
+bool isRounded(const litehtml::border_radiuses& radii)
+{
+  return radii.top_left_x > 0 || radii.top_left_y > 0 || radii.top_right_x > 0
+      || radii.top_right_y > 0 || radii.bottom_right_x > 0
+      || radii.bottom_right_y > 0 || radii.bottom_left_x > 0
+      || radii.bottom_left_y > 0;
+}
+
+// The same conversion as the cairo's one of the solid source.
+uint32_t toShort(double value)
+{
+  value = std::min(std::max(value, 0.0), 1.0);
+  return static_cast<uint32_t>(value * 65535.0 + 0.5);
+}
+
+template <typename Pixel>
+void fillSpans(unsigned char* data,
+    int stride,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    Pixel pixel)
+{
+  const std::size_t width = right - left;
+  // The whole rows without the padding are one span.
+  if(width * sizeof(Pixel) == static_cast<std::size_t>(stride)) {
+    Pixel* span = reinterpret_cast<Pixel*>(
+        data + static_cast<std::ptrdiff_t>(top) * stride);
+    std::fill(span, span + width * (bottom - top), pixel);
+    return;
+  }
+  for(int row = top; row < bottom; ++row) {
+    Pixel* span = reinterpret_cast<Pixel*>(
+                      data + static_cast<std::ptrdiff_t>(row) * stride)
+        + left;
+    std::fill(span, span + width, pixel);
+  }
+}
+}  // namespace
+
 HgCairo::HgCairo(unsigned char* buffer,
     const cairo_format_t colorFormat,
     const unsigned int width,
@@ -19,18 +175,41 @@ HgCairo::HgCairo(unsigned char* buffer,
 
   mContext = {cairo_create(surface.get()), cairo_destroy};
   checkStatus(cairo_status, mContext.get());
+  mClips.push_back({true, 0, 0, static_cast<int>(width),
+      static_cast<int>(height)});
+}
+
+HgCairo::HgCairo(cairo_surface_t* surface)
+{
+  checkStatus(cairo_surface_status, surface);
+  mContext = {cairo_create(surface), cairo_destroy};
+  checkStatus(cairo_status, mContext.get());
+  // The fast fills are for the image surfaces only.
+  if(cairo_surface_get_type(surface) == CAIRO_SURFACE_TYPE_IMAGE) {
+    mClips.push_back({true, 0, 0, cairo_image_surface_get_width(surface),
+        cairo_image_surface_get_height(surface)});
+  } else {
+    mClips.push_back({false, 0, 0, 0, 0});
+  }
 }
 
-HgCairo::~HgCairo() {}
+HgCairo::~HgCairo()
+{
+  flush();
+}
 
 void HgCairo::save()
 {
   cairo_save(mContext.get());
+  mClips.push_back(mClips.back());
 }
 
 void HgCairo::restore()
 {
   cairo_restore(mContext.get());
+  if(mClips.size() > 1) {
+    mClips.pop_back();
+  }
 }
 
 void HgCairo::clip(
@@ -38,10 +217,95 @@ void HgCairo::clip(
 {
   cairo_rectangle(mContext.get(), x, y, width, height);
   cairo_clip(mContext.get());
+
+  DeviceClip& clip = mClips.back();
+  int left, top, right, bottom;
+  if(!clip.mAligned
+      || !toDeviceRect(x, y, width, height, left, top, right, bottom)) {
+    clip.mAligned = false;
+    return;
+  }
+  clip.mLeft = std::max(clip.mLeft, left);
+  clip.mTop = std::max(clip.mTop, top);
+  clip.mRight = std::max(clip.mLeft, std::min(clip.mRight, right));
+  clip.mBottom = std::max(clip.mTop, std::min(clip.mBottom, bottom));
+}
+
+void HgCairo::translate(const double x, const double y)
+{
+  cairo_translate(mContext.get(), x, y);
+}
+
+void HgCairo::scale(const double factor)
+{
+  cairo_scale(mContext.get(), factor, factor);
+}
+
+void HgCairo::userToDeviceDistance(double& dx, double& dy) const
+{
+  cairo_user_to_device_distance(mContext.get(), &dx, &dy);
+}
+
+void HgCairo::showPage()
+{
+  flush();
+  cairo_show_page(mContext.get());
+  checkStatus(cairo_status, mContext.get());
+}
+
+void HgCairo::setQuality(
+    Quality quality, unsigned int draftSkips /*= skipNone*/)
+{
+  mQuality = quality;
+  mDraftSkips = draftSkips;
+  cairo_set_antialias(mContext.get(),
+      mQuality == fullQuality ? CAIRO_ANTIALIAS_DEFAULT
+                              : CAIRO_ANTIALIAS_FAST);
+}
+
+void HgCairo::pushGroup()
+{
+  flush();
+  cairo_push_group(mContext.get());
+  // The fast fills draw to the target, not to the group.
+  mClips.push_back({false, 0, 0, 0, 0});
+}
+
+void HgCairo::popGroupMasked(const SurfacePtr& mask,
+    const double x,
+    const double y,
+    const double width,
+    const double height)
+{
+  cairo_pop_group_to_source(mContext.get());
+  if(mClips.size() > 1) {
+    mClips.pop_back();
+  }
+
+  int maskWidth = cairo_image_surface_get_width(mask.get());
+  int maskHeight = cairo_image_surface_get_height(mask.get());
+  if(maskWidth <= 0 || maskHeight <= 0 || width <= 0 || height <= 0) {
+    return;
+  }
+  cairo_save(mContext.get());
+  cairo_translate(mContext.get(), x, y);
+  cairo_scale(mContext.get(), width / maskWidth, height / maskHeight);
+  cairo_mask_surface(mContext.get(), mask.get(), 0, 0);
+  cairo_restore(mContext.get());
 }
 
 void HgCairo::clear(const Color& color /*= Color{}*/)
 {
+  flush();
+  const DeviceClip& clip = mClips.back();
+  if(clip.mAligned && (color.mAlpha >= 1 || color.mAlpha <= 0)
+      && isSpanFormat()) {
+    if(clip.mLeft < clip.mRight && clip.mTop < clip.mBottom) {
+      fillDeviceSpans(clip.mLeft, clip.mTop, clip.mRight, clip.mBottom, color);
+    }
+    return;
+  }
+
   cairo_save(mContext.get());
   cairo_set_source_rgba(
       mContext.get(), color.mRed, color.mGreen, color.mBlue, color.mAlpha);
@@ -50,16 +314,48 @@ void HgCairo::clear(const Color& color /*= Color{}*/)
   cairo_restore(mContext.get());
 }
 
+void HgCairo::clearDeferred(const Color& color /*= Color{}*/)
+{
+  flush();
+  const DeviceClip& clip = mClips.back();
+  if(!clip.mAligned || (color.mAlpha < 1 && color.mAlpha > 0)
+      || !isSpanFormat()) {
+    clear(color);
+    return;
+  }
+  mDeferredClear.mPending = true;
+  mDeferredClear.mColor = color;
+  mDeferredClear.mRect = clip;
+}
+
+void HgCairo::flush()
+{
+  if(!mDeferredClear.mPending) {
+    return;
+  }
+  mDeferredClear.mPending = false;
+  const DeviceClip& rect = mDeferredClear.mRect;
+  if(rect.mLeft < rect.mRight && rect.mTop < rect.mBottom) {
+    fillDeviceSpans(rect.mLeft, rect.mTop, rect.mRight, rect.mBottom,
+        mDeferredClear.mColor);
+  }
+}
+
 void HgCairo::drawLine(const double x1,
     const double y1,
     const double x2,
     const double y2,
     const double width,
-    const Color& color /*= Color{}*/)
+    const Color& color /*= Color{}*/,
+    const double dash /*= 0*/)
 {
+  flush();
   cairo_save(mContext.get());
   cairo_set_source_rgba(
       mContext.get(), color.mRed, color.mGreen, color.mBlue, color.mAlpha);
+  if(dash > 0) {
+    cairo_set_dash(mContext.get(), &dash, 1, 0);
+  }
   cairo_move_to(mContext.get(), x1, y1);
   cairo_line_to(mContext.get(), x2, y2);
   cairo_set_line_width(mContext.get(), width);
@@ -67,6 +363,235 @@ void HgCairo::drawLine(const double x1,
   cairo_restore(mContext.get());
 }
 
+void HgCairo::fillRect(const double x,
+    const double y,
+    const double width,
+    const double height,
+    const Color& color)
+{
+  if(fillDeviceRect(x, y, width, height, color)) {
+    return;
+  }
+  flush();
+
+  cairo_save(mContext.get());
+  cairo_set_source_rgba(
+      mContext.get(), color.mRed, color.mGreen, color.mBlue, color.mAlpha);
+  cairo_rectangle(mContext.get(), x, y, width, height);
+  cairo_fill(mContext.get());
+  cairo_restore(mContext.get());
+}
+
+void HgCairo::fillRoundedRect(const litehtml::position& rect,
+    const litehtml::border_radiuses& radii,
+    const Color& color)
+{
+  if(!isRounded(radii)) {
+    fillRect(rect.x, rect.y, rect.width, rect.height, color);
+    return;
+  }
+  flush();
+
+  cairo_save(mContext.get());
+  cairo_set_source_rgba(
+      mContext.get(), color.mRed, color.mGreen, color.mBlue, color.mAlpha);
+  addRoundedRect(mContext.get(), rect, radii);
+  cairo_fill(mContext.get());
+  cairo_restore(mContext.get());
+}
+
+void HgCairo::fillFrame(const litehtml::position& outer,
+    const litehtml::border_radiuses& outerRadii,
+    const litehtml::position& inner,
+    const litehtml::border_radiuses& innerRadii,
+    const std::vector<double>& polygon,
+    const Color& color)
+{
+  flush();
+  cairo_save(mContext.get());
+  if(polygon.size() >= 6) {
+    cairo_move_to(mContext.get(), polygon[0], polygon[1]);
+    for(std::size_t i = 2; i + 1 < polygon.size(); i += 2) {
+      cairo_line_to(mContext.get(), polygon[i], polygon[i + 1]);
+    }
+    cairo_close_path(mContext.get());
+    cairo_clip(mContext.get());
+  }
+
+  cairo_set_source_rgba(
+      mContext.get(), color.mRed, color.mGreen, color.mBlue, color.mAlpha);
+  cairo_set_fill_rule(mContext.get(), CAIRO_FILL_RULE_EVEN_ODD);
+  addRoundedRect(mContext.get(), outer, outerRadii);
+  if(inner.width > 0 && inner.height > 0) {
+    addRoundedRect(mContext.get(), inner, innerRadii);
+  }
+  cairo_fill(mContext.get());
+  cairo_restore(mContext.get());
+}
+
+bool HgCairo::toDeviceRect(const double x,
+    const double y,
+    const double width,
+    const double height,
+    int& left,
+    int& top,
+    int& right,
+    int& bottom) const
+{
+  cairo_matrix_t matrix;
+  cairo_get_matrix(mContext.get(), &matrix);
+  if(matrix.xy != 0 || matrix.yx != 0) {
+    return false;
+  }
+
+  double x1 = matrix.xx * x + matrix.x0;
+  double x2 = matrix.xx * (x + width) + matrix.x0;
+  double y1 = matrix.yy * y + matrix.y0;
+  double y2 = matrix.yy * (y + height) + matrix.y0;
+  // The edges between the pixels are antialiased by cairo.
+  const double epsilon = 1e-6;
+  auto toPixel = [epsilon](double value, int& pixel) {
+    double rounded = std::round(value);
+    if(std::abs(value - rounded) > epsilon
+        || std::abs(rounded) > std::numeric_limits<int>::max()) {
+      return false;
+    }
+    pixel = static_cast<int>(rounded);
+    return true;
+  };
+  return toPixel(std::min(x1, x2), left) && toPixel(std::max(x1, x2), right)
+      && toPixel(std::min(y1, y2), top) && toPixel(std::max(y1, y2), bottom);
+}
+
+bool HgCairo::fillDeviceRect(const double x,
+    const double y,
+    const double width,
+    const double height,
+    const Color& color)
+{
+  const DeviceClip& clip = mClips.back();
+  if(color.mAlpha < 1 || !clip.mAligned || !isSpanFormat()) {
+    return false;
+  }
+  int left, top, right, bottom;
+  if(!toDeviceRect(x, y, width, height, left, top, right, bottom)) {
+    return false;
+  }
+
+  left = std::max(left, clip.mLeft);
+  top = std::max(top, clip.mTop);
+  right = std::min(right, clip.mRight);
+  bottom = std::min(bottom, clip.mBottom);
+  if(right <= left || bottom <= top) {
+    return true;
+  }
+
+  // The deferred clear under the fill is not needed.
+  if(mDeferredClear.mPending) {
+    const DeviceClip& clear = mDeferredClear.mRect;
+    if(left <= clear.mLeft && top <= clear.mTop && clear.mRight <= right
+        && clear.mBottom <= bottom) {
+      mDeferredClear.mPending = false;
+    } else {
+      flush();
+    }
+  }
+  return fillDeviceSpans(left, top, right, bottom, color);
+}
+
+bool HgCairo::isSpanFormat() const
+{
+  switch(cairo_image_surface_get_format(cairo_get_target(mContext.get()))) {
+    case CAIRO_FORMAT_ARGB32:
+    case CAIRO_FORMAT_RGB24:
+    case CAIRO_FORMAT_RGB30:
+    case CAIRO_FORMAT_RGB16_565:
+    case CAIRO_FORMAT_A8:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool HgCairo::fillDeviceSpans(const int left,
+    const int top,
+    const int right,
+    const int bottom,
+    const Color& color)
+{
+  cairo_surface_t* surface = cairo_get_target(mContext.get());
+  cairo_surface_flush(surface);
+  unsigned char* data = cairo_image_surface_get_data(surface);
+  const int stride = cairo_image_surface_get_stride(surface);
+
+  // The opaque color or the transparent one by the source operator.
+  const bool opaque = color.mAlpha >= 1;
+  const uint32_t red = opaque ? toShort(color.mRed) : 0;
+  const uint32_t green = opaque ? toShort(color.mGreen) : 0;
+  const uint32_t blue = opaque ? toShort(color.mBlue) : 0;
+  switch(cairo_image_surface_get_format(surface)) {
+    case CAIRO_FORMAT_ARGB32:
+    case CAIRO_FORMAT_RGB24:
+      fillSpans<uint32_t>(data, stride, left, top, right, bottom,
+          (opaque ? 0xFF000000 : 0) | (red >> 8) << 16 | (green >> 8) << 8
+              | blue >> 8);
+      break;
+    case CAIRO_FORMAT_RGB30:
+      fillSpans<uint32_t>(data, stride, left, top, right, bottom,
+          (red >> 6) << 20 | (green >> 6) << 10 | blue >> 6);
+      break;
+    case CAIRO_FORMAT_RGB16_565:
+      fillSpans<uint16_t>(data, stride, left, top, right, bottom,
+          static_cast<uint16_t>(
+              (red >> 11) << 11 | (green >> 10) << 5 | blue >> 11));
+      break;
+    case CAIRO_FORMAT_A8:
+      fillSpans<uint8_t>(
+          data, stride, left, top, right, bottom, opaque ? 0xFF : 0);
+      break;
+    default:
+      return false;
+  }
+  cairo_surface_mark_dirty_rectangle(
+      surface, left, top, right - left, bottom - top);
+  return true;
+}
+
+void HgCairo::drawImage(const SurfacePtr& image,
+    const double x,
+    const double y,
+    const double width,
+    const double height,
+    const double imageX,
+    const double imageY,
+    const double imageWidth,
+    const double imageHeight,
+    const bool repeat)
+{
+  flush();
+  int surfaceWidth = cairo_image_surface_get_width(image.get());
+  int surfaceHeight = cairo_image_surface_get_height(image.get());
+  if(surfaceWidth <= 0 || surfaceHeight <= 0 || imageWidth <= 0
+      || imageHeight <= 0) {
+    return;
+  }
+
+  cairo_save(mContext.get());
+  cairo_rectangle(mContext.get(), x, y, width, height);
+  cairo_clip(mContext.get());
+  cairo_translate(mContext.get(), imageX, imageY);
+  cairo_scale(mContext.get(), imageWidth / surfaceWidth,
+      imageHeight / surfaceHeight);
+  cairo_set_source_surface(mContext.get(), image.get(), 0, 0);
+  cairo_pattern_t* pattern = cairo_get_source(mContext.get());
+  cairo_pattern_set_extend(
+      pattern, repeat ? CAIRO_EXTEND_REPEAT : CAIRO_EXTEND_NONE);
+  cairo_pattern_set_filter(pattern,
+      mQuality == fullQuality ? CAIRO_FILTER_GOOD : CAIRO_FILTER_FAST);
+  cairo_paint(mContext.get());
+  cairo_restore(mContext.get());
+}
+
 void HgCairo::showGlyphs(const GlyphVector& glyphs,
     const ScaledFontPtr scaledFont,
     const double x,
@@ -74,6 +599,7 @@ void HgCairo::showGlyphs(const GlyphVector& glyphs,
     const cairo_text_extents_t& extents,
     const Color& color)
 {
+  flush();
   cairo_save(mContext.get());
   cairo_translate(mContext.get(), x, y);
   cairo_rectangle(mContext.get(), extents.x_bearing, extents.y_bearing,
@@ -112,8 +638,26 @@ int HgCairo::formatBitsPerPixel(cairo_format_t format)
 }
 
 // static
-HgCairo::ScaledFontPtr HgCairo::getScaledFont(
-    const FT_Face ftFace, const int ftLoadFlags, const int pixelSize)
+HgCairo::SurfacePtr HgCairo::createRoundedMask(const int width,
+    const int height,
+    const litehtml::border_radiuses& radii)
+{
+  SurfacePtr mask{cairo_image_surface_create(CAIRO_FORMAT_A8, width, height),
+      cairo_surface_destroy};
+  checkStatus(cairo_surface_status, mask.get());
+  ContextPtr context{cairo_create(mask.get()), cairo_destroy};
+  checkStatus(cairo_status, context.get());
+  addRoundedRect(context.get(), litehtml::position(0, 0, width, height), radii);
+  cairo_fill(context.get());
+  cairo_surface_flush(mask.get());
+  return mask;
+}
+
+// static
+HgCairo::ScaledFontPtr HgCairo::getScaledFont(const FT_Face ftFace,
+    const int ftLoadFlags,
+    const int pixelSize,
+    const bool draft /*= false*/)
 {
   FontFacePtr fontFace{
       cairo_ft_font_face_create_for_ft_face(ftFace, ftLoadFlags),
@@ -128,8 +672,12 @@ HgCairo::ScaledFontPtr HgCairo::getScaledFont(
   FontOptionsPtr fontOptions{
       cairo_font_options_create(), cairo_font_options_destroy};
   checkStatus(cairo_font_options_status, fontOptions.get());
-  cairo_font_options_set_antialias(fontOptions.get(), CAIRO_ANTIALIAS_GRAY);
-  cairo_font_options_set_hint_style(fontOptions.get(), CAIRO_HINT_STYLE_MEDIUM);
+  // The hinting of the draft font is off, the glyph positions are
+  // from the text layout and are the same for both fonts.
+  cairo_font_options_set_antialias(fontOptions.get(),
+      draft ? CAIRO_ANTIALIAS_FAST : CAIRO_ANTIALIAS_GRAY);
+  cairo_font_options_set_hint_style(fontOptions.get(),
+      draft ? CAIRO_HINT_STYLE_NONE : CAIRO_HINT_STYLE_MEDIUM);
   cairo_font_options_set_hint_metrics(
       fontOptions.get(), CAIRO_HINT_METRICS_DEFAULT);
   // CSS font-variation-settings
@@ -154,6 +702,7 @@ double HgCairo::xHeight(const ScaledFontPtr scaledFont)
 
 void HgCairo::rasterCopy(int diffX, int diffY)
 {
+  flush();
   if(diffX == 0 && diffY == 0) {
     return;
   }
@@ -214,4 +763,113 @@ void HgCairo::rasterCopy(int diffX, int diffY)
   cairo_surface_mark_dirty(surface);
 }
 
+// Copies the pixel rectangle from the other image surface
+// of the same color format.
+void HgCairo::rasterBlit(const HgCairo& src,
+    const int srcX,
+    const int srcY,
+    const int dstX,
+    const int dstY,
+    const int width,
+    const int height)
+{
+  flush();
+  if(width <= 0 || height <= 0) {
+    return;
+  }
+
+  cairo_surface_t* srcSurface = cairo_get_target(src.mContext.get());
+  checkStatus(cairo_surface_status, srcSurface);
+  cairo_surface_flush(srcSurface);
+
+  cairo_surface_t* dstSurface = cairo_get_target(mContext.get());
+  checkStatus(cairo_surface_status, dstSurface);
+  cairo_surface_flush(dstSurface);
+
+  cairo_format_t format = cairo_image_surface_get_format(dstSurface);
+  if(format != cairo_image_surface_get_format(srcSurface)) {
+    throw std::logic_error("HgCairo::rasterBlit(), color formats differ");
+  }
+  int bpp = formatBitsPerPixel(format) / 8;  // Bytes per pixel.
+
+  const unsigned char* srcData = cairo_image_surface_get_data(srcSurface);
+  int srcStride = cairo_image_surface_get_stride(srcSurface);
+  unsigned char* dstData = cairo_image_surface_get_data(dstSurface);
+  int dstStride = cairo_image_surface_get_stride(dstSurface);
+
+  const unsigned char* srcRow = srcData + srcY * srcStride + srcX * bpp;
+  unsigned char* dstRow = dstData + dstY * dstStride + dstX * bpp;
+  for(int y = 0; y < height; ++y) {
+    std::copy(srcRow, srcRow + width * bpp, dstRow);
+    srcRow += srcStride;
+    dstRow += dstStride;
+  }
+
+  cairo_surface_mark_dirty_rectangle(dstSurface, dstX, dstY, width, height);
+}
+
+void HgCairo::rasterScale(const HgCairo& src,
+    const double factor,
+    const double srcX,
+    const double srcY,
+    const double dstX,
+    const double dstY)
+{
+  flush();
+  if(factor <= 0) {
+    return;
+  }
+
+  cairo_surface_t* srcSurface = cairo_get_target(src.mContext.get());
+  checkStatus(cairo_surface_status, srcSurface);
+  cairo_surface_flush(srcSurface);
+
+  cairo_surface_t* dstSurface = cairo_get_target(mContext.get());
+  checkStatus(cairo_surface_status, dstSurface);
+  cairo_surface_flush(dstSurface);
+
+  if(cairo_image_surface_get_format(dstSurface)
+      != cairo_image_surface_get_format(srcSurface)) {
+    throw std::logic_error("HgCairo::rasterScale(), color formats differ");
+  }
+
+  PixmanImagePtr srcImage = newPixmanImage(srcSurface);
+  PixmanImagePtr dstImage = newPixmanImage(dstSurface);
+
+  // Maps the destination to the source.
+  pixman_transform_t transform;
+  pixman_transform_init_scale(&transform, pixman_double_to_fixed(1 / factor),
+      pixman_double_to_fixed(1 / factor));
+  transform.matrix[0][2] = pixman_double_to_fixed(srcX - dstX / factor);
+  transform.matrix[1][2] = pixman_double_to_fixed(srcY - dstY / factor);
+  pixman_image_set_transform(srcImage.get(), &transform);
+  pixman_image_set_filter(
+      srcImage.get(), PIXMAN_FILTER_BILINEAR, nullptr, 0);
+  pixman_image_set_repeat(srcImage.get(), PIXMAN_REPEAT_NONE);
+
+  // The source bounds in the destination.
+  int width = cairo_image_surface_get_width(dstSurface);
+  int height = cairo_image_surface_get_height(dstSurface);
+  int left = std::max(0,
+      static_cast<int>(std::ceil(dstX - srcX * factor)));
+  int top = std::max(0,
+      static_cast<int>(std::ceil(dstY - srcY * factor)));
+  int right = std::min(width,
+      static_cast<int>(std::floor(dstX
+          + (cairo_image_surface_get_width(srcSurface) - srcX) * factor)));
+  int bottom = std::min(height,
+      static_cast<int>(std::floor(dstY
+          + (cairo_image_surface_get_height(srcSurface) - srcY) * factor)));
+  if(right <= left || bottom <= top) {
+    return;
+  }
+
+  pixman_image_composite32(PIXMAN_OP_SRC, srcImage.get(), nullptr,
+      dstImage.get(), left, top, 0, 0, left, top, right - left,
+      bottom - top);
+
+  cairo_surface_mark_dirty_rectangle(
+      dstSurface, left, top, right - left, bottom - top);
+}
+
 }  // namespace hg
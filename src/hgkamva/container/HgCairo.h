@@ -66,6 +66,25 @@ public:
     double mAlpha;
   };
 
+  // The draft quality is cheaper for the scrolling, the context
+  // antialiasing and the image filter are fast, the fonts are not hinted.
+  // The thumbnail quality is the draft one with the text drawn as the gray
+  // bars of the laid out run widths, the text is not shaped.
+  enum Quality : int
+  {
+    fullQuality,
+    draftQuality,
+    thumbnailQuality,
+  };
+
+  // The parts of the document not drawn with the draft qualities.
+  enum DraftSkip : unsigned int
+  {
+    skipNone = 0,
+    skipDecorations = 1,
+    skipImages = 2,
+  };
+
   HgCairo() = delete;
 
   // TODO: Copy/move constructors/operators.
@@ -74,20 +93,82 @@ public:
       const unsigned int width,
       const unsigned int height,
       const int stride);
+  // Draws to the surface of any type, e.g. the PDF one.
+  explicit HgCairo(cairo_surface_t* surface);
   ~HgCairo();
 
   void save();
   void restore();
+  // The clip aligned to the device pixels keeps the fast fills.
   void clip(
       const double x, const double y, const double width, const double height);
+  void translate(const double x, const double y);
+  void scale(const double factor);
+  // Converts the distance to the device pixels.
+  void userToDeviceDistance(double& dx, double& dy) const;
+  // Ends the page of the multi-page surface.
+  void showPage();
+  // The draft skips are the DraftSkip flags.
+  void setQuality(Quality quality, unsigned int draftSkips = skipNone);
+  Quality quality() const;
+  // True if the draft qualities skip the part.
+  bool isSkipped(DraftSkip skip) const;
+  // Draws to the group until popGroupMasked().
+  void pushGroup();
+  // Draws the group through the A8 mask scaled to the rect.
+  void popGroupMasked(const SurfacePtr& mask,
+      const double x,
+      const double y,
+      const double width,
+      const double height);
 
+  // Clears the clip area, the opaque and the transparent colors are filled
+  // directly on the image surface.
   void clear(const Color& color = Color{});
+  // Clears the clip area before the next drawing. The clear is skipped
+  // if the drawing is the opaque fill covering the area.
+  void clearDeferred(const Color& color = Color{});
+  // Does the deferred clear.
+  void flush();
+  // The line is dashed by the dashes and the gaps of the dash length
+  // if it is not 0.
   void drawLine(const double x1,
       const double y1,
       const double x2,
       const double y2,
       const double width,
-      const Color& color = Color{});
+      const Color& color = Color{},
+      const double dash = 0);
+  // The opaque rect aligned to the device pixels is filled directly
+  // on the image surface without the cairo's path.
+  void fillRect(const double x,
+      const double y,
+      const double width,
+      const double height,
+      const Color& color);
+  void fillRoundedRect(const litehtml::position& rect,
+      const litehtml::border_radiuses& radii,
+      const Color& color);
+  // Fills the area between the outer and the inner rounded rects
+  // inside the polygon of the points x1, y1, x2, y2, ...
+  void fillFrame(const litehtml::position& outer,
+      const litehtml::border_radiuses& outerRadii,
+      const litehtml::position& inner,
+      const litehtml::border_radiuses& innerRadii,
+      const std::vector<double>& polygon,
+      const Color& color);
+  // Fills the rect with the image surface scaled to imageWidth, imageHeight
+  // at the point imageX, imageY, the image is tiled if repeat.
+  void drawImage(const SurfacePtr& image,
+      const double x,
+      const double y,
+      const double width,
+      const double height,
+      const double imageX,
+      const double imageY,
+      const double imageWidth,
+      const double imageHeight,
+      const bool repeat);
   void showGlyphs(const GlyphVector& glyphs,
       const ScaledFontPtr scaledFont,
       const double x,
@@ -96,13 +177,71 @@ public:
       const Color& color);
 
   static int formatBitsPerPixel(cairo_format_t format);
-  static ScaledFontPtr getScaledFont(
-      const FT_Face ftFace, const int ftLoadFlags, const int pixelSize);
+  // The A8 mask of the rounded rect of the size.
+  static SurfacePtr createRoundedMask(const int width,
+      const int height,
+      const litehtml::border_radiuses& radii);
+  // The draft font is not hinted and has the fast antialiasing.
+  static ScaledFontPtr getScaledFont(const FT_Face ftFace,
+      const int ftLoadFlags,
+      const int pixelSize,
+      const bool draft = false);
   static double xHeight(const ScaledFontPtr scaledFont);
 
   void rasterCopy(int diffX, int diffY);
+  void rasterBlit(const HgCairo& src,
+      const int srcX,
+      const int srcY,
+      const int dstX,
+      const int dstY,
+      const int width,
+      const int height);
+  // Draws the other image surface of the same color format scaled
+  // by the factor with the bilinear filter, the source point srcX, srcY
+  // is drawn at the point dstX, dstY. The pixels out of the source
+  // are not changed.
+  void rasterScale(const HgCairo& src,
+      const double factor,
+      const double srcX,
+      const double srcY,
+      const double dstX,
+      const double dstY);
 
 private:
+  // The clip in the device pixels while it is the rect aligned to them.
+  struct DeviceClip
+  {
+    bool mAligned;
+    int mLeft;
+    int mTop;
+    int mRight;
+    int mBottom;
+  };
+
+  // Returns false if the rect is not aligned to the device pixels.
+  bool toDeviceRect(const double x,
+      const double y,
+      const double width,
+      const double height,
+      int& left,
+      int& top,
+      int& right,
+      int& bottom) const;
+  // The image surface of the color format filled by the spans.
+  bool isSpanFormat() const;
+  bool fillDeviceSpans(const int left,
+      const int top,
+      const int right,
+      const int bottom,
+      const Color& color);
+  // The span fill of the opaque rect on the image surface,
+  // returns false if the rect needs the cairo's path.
+  bool fillDeviceRect(const double x,
+      const double y,
+      const double width,
+      const double height,
+      const Color& color);
+
   template <typename StatusFunc, typename... Args>
   static void checkStatus(const StatusFunc statusFunc, Args&&... args);
 
@@ -110,6 +249,18 @@ private:
   static void checkPtrStatus(const Ptr ptr);
 
   ContextPtr mContext;
+  Quality mQuality = fullQuality;
+  unsigned int mDraftSkips = skipNone;
+  // The clips of save() and restore(), the last one is current.
+  std::vector<DeviceClip> mClips;
+
+  struct DeferredClear
+  {
+    bool mPending = false;
+    Color mColor;
+    DeviceClip mRect;
+  };
+  DeferredClear mDeferredClear;
 };
 
 // static
@@ -135,6 +286,16 @@ inline void HgCairo::checkPtrStatus(const Ptr ptr)
   }
 }
 
+inline HgCairo::Quality HgCairo::quality() const
+{
+  return mQuality;
+}
+
+inline bool HgCairo::isSkipped(DraftSkip skip) const
+{
+  return mQuality != fullQuality && (mDraftSkips & skip) != 0;
+}
+
 }  // namespace hg
 
 #endif  // CAIROWRAPPER_HPP
@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/container/HgCairo.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+TEST(HgCairoTest, clear)
+{
+  std::vector<uint32_t> buffer(8 * 4, 0x12345678);
+  hg::HgCairo cairo(reinterpret_cast<unsigned char*>(buffer.data()),
+      CAIRO_FORMAT_ARGB32, 8, 4, 8 * 4);
+
+  cairo.clear(hg::HgCairo::Color{1, 1, 1, 1});
+  EXPECT_EQ(0xFFFFFFFF, buffer[0]);
+  EXPECT_EQ(0xFFFFFFFF, buffer[31]);
+
+  // The clip area only.
+  cairo.save();
+  cairo.clip(2, 1, 4, 2);
+  cairo.clear(hg::HgCairo::Color{0, 0, 0, 0});
+  cairo.restore();
+  EXPECT_EQ(0xFFFFFFFF, buffer[8 + 1]);
+  EXPECT_EQ(0x00000000, buffer[8 + 2]);
+  EXPECT_EQ(0x00000000, buffer[2 * 8 + 5]);
+  EXPECT_EQ(0xFFFFFFFF, buffer[2 * 8 + 6]);
+
+  std::vector<uint16_t> buffer16(4 * 2, 0);
+  hg::HgCairo cairo16(reinterpret_cast<unsigned char*>(buffer16.data()),
+      CAIRO_FORMAT_RGB16_565, 4, 2, 4 * 2);
+  cairo16.clear(hg::HgCairo::Color{1, 0, 128 / 255.0, 1});
+  EXPECT_EQ(0xF810, buffer16[0]);
+  EXPECT_EQ(0xF810, buffer16[7]);
+}
+
+TEST(HgCairoTest, clearDeferred)
+{
+  std::vector<uint32_t> buffer(8 * 4, 0x12345678);
+  {
+    hg::HgCairo cairo(reinterpret_cast<unsigned char*>(buffer.data()),
+        CAIRO_FORMAT_ARGB32, 8, 4, 8 * 4);
+
+    // The clear under the covering opaque fill is skipped.
+    cairo.clearDeferred(hg::HgCairo::Color{1, 1, 1, 1});
+    EXPECT_EQ(0x12345678, buffer[0]);
+    cairo.fillRect(0, 0, 8, 4, hg::HgCairo::Color{1, 0, 0, 1});
+    cairo.flush();
+    EXPECT_EQ(0xFFFF0000, buffer[0]);
+    EXPECT_EQ(0xFFFF0000, buffer[31]);
+
+    // The partly covered area is cleared before the fill.
+    cairo.save();
+    cairo.clip(0, 0, 4, 4);
+    cairo.clearDeferred(hg::HgCairo::Color{0, 0, 0, 0});
+    cairo.fillRect(0, 0, 2, 4, hg::HgCairo::Color{0, 1, 0, 1});
+    cairo.restore();
+    EXPECT_EQ(0xFF00FF00, buffer[0]);
+    EXPECT_EQ(0x00000000, buffer[2]);
+    EXPECT_EQ(0xFFFF0000, buffer[4]);
+
+    // The pending clear is done by the destructor.
+    cairo.clearDeferred(hg::HgCairo::Color{0, 0, 1, 1});
+  }
+  EXPECT_EQ(0xFF0000FF, buffer[9]);
+}
+
+TEST(HgCairoTest, quality)
+{
+  std::vector<uint32_t> buffer(8 * 4, 0);
+  hg::HgCairo cairo(reinterpret_cast<unsigned char*>(buffer.data()),
+      CAIRO_FORMAT_ARGB32, 8, 4, 8 * 4);
+  EXPECT_EQ(hg::HgCairo::fullQuality, cairo.quality());
+
+  // The full quality skips nothing.
+  cairo.setQuality(hg::HgCairo::fullQuality, hg::HgCairo::skipImages);
+  EXPECT_FALSE(cairo.isSkipped(hg::HgCairo::skipImages));
+
+  cairo.setQuality(hg::HgCairo::draftQuality, hg::HgCairo::skipImages);
+  EXPECT_EQ(hg::HgCairo::draftQuality, cairo.quality());
+  EXPECT_TRUE(cairo.isSkipped(hg::HgCairo::skipImages));
+  EXPECT_FALSE(cairo.isSkipped(hg::HgCairo::skipDecorations));
+
+  cairo.setQuality(hg::HgCairo::thumbnailQuality, hg::HgCairo::skipImages);
+  EXPECT_TRUE(cairo.isSkipped(hg::HgCairo::skipImages));
+}
@@ -23,17 +23,242 @@
 
 #include "hgkamva/container/HgContainer.h"
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
 #include "hgkamva/container/HgCairo.h"
-#include "hgkamva/container/HgFont.h"
-#include "hgkamva/container/HgFontLibrary.h"
 
 namespace hg
 {
+namespace
+{
+bool isVisible(const litehtml::border& border)
+{
+  return border.width > 0 && border.style != litehtml::border_style_none
+      && border.style != litehtml::border_style_hidden
+      && border.color.alpha > 0;
+}
+
+bool isDashed(const litehtml::border& border)
+{
+  return border.style == litehtml::border_style_dotted
+      || border.style == litehtml::border_style_dashed;
+}
+
+bool isSameColor(const litehtml::web_color& color1,
+    const litehtml::web_color& color2)
+{
+  return color1.red == color2.red && color1.green == color2.green
+      && color1.blue == color2.blue && color1.alpha == color2.alpha;
+}
+
+bool isRounded(const litehtml::border_radiuses& radii)
+{
+  return radii.top_left_x > 0 || radii.top_left_y > 0 || radii.top_right_x > 0
+      || radii.top_right_y > 0 || radii.bottom_right_x > 0
+      || radii.bottom_right_y > 0 || radii.bottom_left_x > 0
+      || radii.bottom_left_y > 0;
+}
+
+// The opaque borders without the radii and the dashes are the rects,
+// the meeting sides of the different colors need the diagonal joins.
+bool isRectBorders(const litehtml::borders& borders)
+{
+  if(isRounded(borders.radius)) {
+    return false;
+  }
+  const litehtml::border* sides[] = {
+      &borders.top, &borders.right, &borders.bottom, &borders.left};
+  for(int i = 0; i < 4; ++i) {
+    const litehtml::border& side = *sides[i];
+    if(!isVisible(side)) {
+      continue;
+    }
+    if(side.color.alpha != 255 || isDashed(side)) {
+      return false;
+    }
+    const litehtml::border& next = *sides[(i + 1) % 4];
+    if(isVisible(next) && !isSameColor(side.color, next.color)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int visibleWidth(const litehtml::border& border)
+{
+  return isVisible(border) ? border.width : 0;
+}
+
+bool intersects(const litehtml::position& rect1,
+    const litehtml::position& rect2)
+{
+  return rect1.left() < rect2.right() && rect2.left() < rect1.right()
+      && rect1.top() < rect2.bottom() && rect2.top() < rect1.bottom();
+}
+
+bool contains(const litehtml::position& outer, const litehtml::position& inner)
+{
+  return outer.left() <= inner.left() && inner.right() <= outer.right()
+      && outer.top() <= inner.top() && inner.bottom() <= outer.bottom();
+}
+
+bool isWhiteSpace(const litehtml::tchar_t* text)
+{
+  for(; *text; ++text) {
+    if(*text != ' ' && *text != '\t' && *text != '\n' && *text != '\r'
+        && *text != '\f') {
+      return false;
+    }
+  }
+  return true;
+}
+
+litehtml::position intersection(const litehtml::position& rect1,
+    const litehtml::position& rect2)
+{
+  int left = std::max(rect1.left(), rect2.left());
+  int top = std::max(rect1.top(), rect2.top());
+  int right = std::max(left, std::min(rect1.right(), rect2.right()));
+  int bottom = std::max(top, std::min(rect1.bottom(), rect2.bottom()));
+  return litehtml::position(left, top, right - left, bottom - top);
+}
+
+// The area is drawn without the mask if it does not touch
+// the rounded corners.
+bool touchesCorners(const litehtml::position& rect,
+    const litehtml::border_radiuses& radii,
+    const litehtml::position& area)
+{
+  const int left = rect.left();
+  const int top = rect.top();
+  const int right = rect.right();
+  const int bottom = rect.bottom();
+  const litehtml::position corners[] = {
+      litehtml::position(left, top, radii.top_left_x, radii.top_left_y),
+      litehtml::position(right - radii.top_right_x, top, radii.top_right_x,
+          radii.top_right_y),
+      litehtml::position(right - radii.bottom_right_x,
+          bottom - radii.bottom_right_y, radii.bottom_right_x,
+          radii.bottom_right_y),
+      litehtml::position(left, bottom - radii.bottom_left_y,
+          radii.bottom_left_x, radii.bottom_left_y)};
+  for(const litehtml::position& corner : corners) {
+    if(corner.width > 0 && corner.height > 0 && intersects(corner, area)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+litehtml::border_radiuses innerRadii(const litehtml::borders& borders)
+{
+  auto reduce = [](int radius, int width) {
+    return std::max(0, radius - width);
+  };
+  litehtml::border_radiuses radii = borders.radius;
+  int left = visibleWidth(borders.left);
+  int top = visibleWidth(borders.top);
+  int right = visibleWidth(borders.right);
+  int bottom = visibleWidth(borders.bottom);
+  radii.top_left_x = reduce(radii.top_left_x, left);
+  radii.top_left_y = reduce(radii.top_left_y, top);
+  radii.top_right_x = reduce(radii.top_right_x, right);
+  radii.top_right_y = reduce(radii.top_right_y, top);
+  radii.bottom_right_x = reduce(radii.bottom_right_x, right);
+  radii.bottom_right_y = reduce(radii.bottom_right_y, bottom);
+  radii.bottom_left_x = reduce(radii.bottom_left_x, left);
+  radii.bottom_left_y = reduce(radii.bottom_left_y, bottom);
+  return radii;
+}
+}  // namespace
+
+class HgContainer::ClipScope
+{
+public:
+  ClipScope(HgContainer& container,
+      const HgCairoPtr& cairo,
+      const litehtml::position& area);
+  ~ClipScope();
+
+  ClipScope(const ClipScope&) = delete;
+  ClipScope& operator=(const ClipScope&) = delete;
+
+  // Is false if the area is out of the clips and is not drawn.
+  bool isVisible() const { return mVisible; }
+
+private:
+  struct Mask
+  {
+    HgCairo::SurfacePtr mSurface;
+    litehtml::position mRect;
+  };
+
+  HgCairoPtr mCairo;
+  bool mVisible;
+  bool mSaved;
+  std::vector<Mask> mMasks;
+};
+
+HgContainer::ClipScope::ClipScope(HgContainer& container,
+    const HgCairoPtr& cairo,
+    const litehtml::position& area)
+    : mCairo{cairo}
+    , mVisible{true}
+    , mSaved{false}
+{
+  const ClipStack* clips = container.getClipStack(false);
+  if(!clips) {
+    return;
+  }
+
+  const litehtml::position& bounds = clips->back().mBounds;
+  if(area.width > 0 && area.height > 0 && !intersects(bounds, area)) {
+    mVisible = false;
+    return;
+  }
+
+  mCairo->save();
+  mSaved = true;
+  // The integer rect keeps the fast fills.
+  if(!contains(bounds, area)) {
+    mCairo->clip(bounds.x, bounds.y, bounds.width, bounds.height);
+  }
+  for(const Clip& clip : *clips) {
+    if(clip.mRounded && touchesCorners(clip.mRect, clip.mRadii, area)) {
+      HgCairo::SurfacePtr mask = container.getClipMask(*mCairo, clip);
+      if(mask) {
+        mCairo->pushGroup();
+        mMasks.push_back({mask, clip.mRect});
+      }
+    }
+  }
+}
+
+HgContainer::ClipScope::~ClipScope()
+{
+  for(auto it = mMasks.rbegin(); it != mMasks.rend(); ++it) {
+    mCairo->popGroupMasked(it->mSurface, it->mRect.x, it->mRect.y,
+        it->mRect.width, it->mRect.height);
+  }
+  if(mSaved) {
+    mCairo->restore();
+  }
+}
+
 HgContainer::HgContainer()
-    : mHgFontLibrary{std::make_shared<HgFontLibrary>()}
+    : HgContainer(std::make_shared<HgEngine>())
+{
+}
+
+HgContainer::HgContainer(HgEnginePtr engine)
+    : mEngine{engine}
+    , mImageCache{engine->getImageCache()}
+    , mClipMasks{CLIP_MASK_CACHE_SIZE}
     , mFontDefaultName{"Times New Roman"}
     , mDefaultFontSize{16}
-    , mFontTextCacheSize{1000}
     , mDeviceWidth{320}
     , mDeviceHeight{240}
     , mDeviceDpiX{96}
@@ -47,15 +272,34 @@ HgContainer::HgContainer()
 {
 }
 
+HgContainer::~HgContainer()
+{
+  // Waits for the running callback, the cache may outlive the container.
+  mImageCache->setReadyCallback(this, nullptr);
+}
+
+void HgContainer::setImageCache(HgImageCachePtr imageCache)
+{
+  mImageCache->setReadyCallback(this, nullptr);
+  mImageCache = imageCache;
+  mImageCache->setReadyCallback(this, mImageReadyCallback);
+}
+
+void HgContainer::setImageReadyCallback(HgImageCache::ReadyCallback callback)
+{
+  mImageReadyCallback = callback;
+  mImageCache->setReadyCallback(this, mImageReadyCallback);
+}
+
 bool HgContainer::parseAndLoadFontConfigFromMemory(
     const std::string& fontConfig, bool complain)
 {
-  return mHgFontLibrary->parseAndLoadConfigFromMemory(fontConfig, complain);
+  return mEngine->parseAndLoadFontConfigFromMemory(fontConfig, complain);
 }
 
 bool HgContainer::addFontDir(const hg::filesystem::path& dirPath)
 {
-  return mHgFontLibrary->addFontDir(dirPath);
+  return mEngine->addFontDir(dirPath);
 }
 
 litehtml::uint_ptr HgContainer::create_font(const litehtml::tchar_t* faceName,
@@ -69,16 +313,8 @@ litehtml::uint_ptr HgContainer::create_font(const litehtml::tchar_t* faceName,
     return nullptr;
   }
 
-  uint_least8_t result;
-  hg::filesystem::path filePath =
-      mHgFontLibrary->getFontFilePath(faceName, size, weight, italic, &result);
-  if(filePath.empty() || HgFontLibrary::FontMatches::allMatched != result) {
-    return nullptr;
-  }
-
-  HgFont* hgFont = new HgFont(mHgFontLibrary->ftLibrary(), mFontTextCacheSize);
-
-  if(!hgFont->createFtFace(filePath, size)) {
+  HgFontPtr hgFont = mEngine->getFont(faceName, size, weight, italic);
+  if(!hgFont) {
     return nullptr;
   }
 
@@ -95,30 +331,40 @@ litehtml::uint_ptr HgContainer::create_font(const litehtml::tchar_t* faceName,
     fm->draw_spaces = false;
   }
 
-  hgFont->setPixelSize(size);
-  hgFont->setStrikeout(decoration & litehtml::font_decoration_linethrough);
-  hgFont->setUnderline(decoration & litehtml::font_decoration_underline);
+  FontHandle* fontHandle = new FontHandle{hgFont,
+      static_cast<bool>(decoration & litehtml::font_decoration_linethrough),
+      static_cast<bool>(decoration & litehtml::font_decoration_underline)};
 
-  return reinterpret_cast<litehtml::uint_ptr>(hgFont);
+  return reinterpret_cast<litehtml::uint_ptr>(fontHandle);
 }
 
 void HgContainer::delete_font(litehtml::uint_ptr hFont)
 {
-  HgFont* hgFont = reinterpret_cast<HgFont*>(hFont);
-  if(hgFont) {
-    delete hgFont;
+  FontHandle* fontHandle = reinterpret_cast<FontHandle*>(hFont);
+  if(fontHandle) {
+    delete fontHandle;
+  }
+}
+
+// static
+HgFontPtr HgContainer::getFont(litehtml::uint_ptr hFont)
+{
+  FontHandle* fontHandle = reinterpret_cast<FontHandle*>(hFont);
+  if(!fontHandle) {
+    return nullptr;
   }
+  return fontHandle->mFont;
 }
 
 int HgContainer::text_width(
     const litehtml::tchar_t* text, litehtml::uint_ptr hFont)
 {
-  HgFont* hgFont = reinterpret_cast<HgFont*>(hFont);
-  if(!hgFont) {
+  FontHandle* fontHandle = reinterpret_cast<FontHandle*>(hFont);
+  if(!fontHandle) {
     return 0;
   }
 
-  HgCairo::TextExtentsPtr extents = hgFont->getTextExtents(text);
+  HgCairo::TextExtentsPtr extents = fontHandle->mFont->getTextExtents(text);
   return extents->x_advance - extents->x_bearing;
 }
 
@@ -137,8 +383,17 @@ void HgContainer::draw_text(litehtml::uint_ptr hdc,
     return;
   }
 
-  HgFont* hgFont = reinterpret_cast<HgFont*>(hFont);
-  if(!hgFont) {
+  FontHandle* fontHandle = reinterpret_cast<FontHandle*>(hFont);
+  if(!fontHandle) {
+    return;
+  }
+  HgFontPtr& hgFont = fontHandle->mFont;
+
+  // The glyphs and the lines may be out of the text box.
+  const litehtml::position area(pos.x - pos.height, pos.y - pos.height / 2,
+      pos.width + 2 * pos.height, 2 * pos.height);
+  ClipScope clipScope(*this, cairo, area);
+  if(!clipScope.isVisible()) {
     return;
   }
 
@@ -146,12 +401,18 @@ void HgContainer::draw_text(litehtml::uint_ptr hdc,
   int x = pos.left();
   int y = pos.bottom() - fontExtents.descent;
 
-  hgFont->drawText(cairo, text, x, y, color);
+  if(cairo->quality() != HgCairo::thumbnailQuality) {
+    hgFont->drawText(cairo, text, x, y, color);
+  } else if(!isWhiteSpace(text)) {
+    // The run width is laid out already, the spaces have no ink.
+    hgFont->drawTextBar(cairo, x, y, pos.width);
+  }
 
-  if(hgFont->underline() || hgFont->strikeout()) {
+  if((fontHandle->mUnderline || fontHandle->mStrikeout)
+      && !cairo->isSkipped(HgCairo::skipDecorations)) {
     int tw = text_width(text, hFont);
 
-    if(hgFont->underline()) {
+    if(fontHandle->mUnderline) {
       // TODO: set line width by font's height.
       // TODO: set line position by font's parameters.
       //cairo->drawLine(
@@ -159,7 +420,7 @@ void HgContainer::draw_text(litehtml::uint_ptr hdc,
       cairo->drawLine(x, y + 3, x + tw, y + 3, 1.5, hg::HgCairo::Color{color});
     }
 
-    if(hgFont->strikeout()) {
+    if(fontHandle->mStrikeout) {
       // TODO: set line width by font's height.
       int lnY = y - hgFont->xHeight() / 2.0;
       //cairo->drawLine(
@@ -189,21 +450,111 @@ void HgContainer::draw_list_marker(
 {
 }
 
+std::string HgContainer::resolveUrl(
+    const litehtml::tchar_t* src, const litehtml::tchar_t* baseurl) const
+{
+  return HgImageCache::resolveUrl(
+      src, baseurl && *baseurl ? std::string(baseurl) : mBaseUrl);
+}
+
 void HgContainer::load_image(const litehtml::tchar_t* src,
     const litehtml::tchar_t* baseurl,
     bool redraw_on_ready)
 {
+  if(!src || !*src) {
+    return;
+  }
+  mImageCache->load(resolveUrl(src, baseurl), redraw_on_ready);
 }
 
 void HgContainer::get_image_size(const litehtml::tchar_t* src,
     const litehtml::tchar_t* baseurl,
     litehtml::size& sz)
 {
+  sz.width = 0;
+  sz.height = 0;
+  if(!src || !*src) {
+    return;
+  }
+  mImageCache->getSize(resolveUrl(src, baseurl), sz.width, sz.height);
 }
 
 void HgContainer::draw_background(
     litehtml::uint_ptr hdc, const litehtml::background_paint& bg)
 {
+  HgCairoPtr& cairo = *(reinterpret_cast<HgCairoPtr*>(hdc));
+  if(!cairo) {
+    return;
+  }
+
+  ClipScope clipScope(*this, cairo, bg.clip_box);
+  if(!clipScope.isVisible()) {
+    return;
+  }
+
+  // The color is under the image.
+  if(bg.color.alpha > 0) {
+    HgCairo::Color color(bg.color);
+    if(isRounded(bg.border_radius)) {
+      cairo->save();
+      cairo->clip(bg.clip_box.x, bg.clip_box.y, bg.clip_box.width,
+          bg.clip_box.height);
+      cairo->fillRoundedRect(bg.border_box, bg.border_radius, color);
+      cairo->restore();
+    } else {
+      cairo->fillRect(bg.clip_box.x, bg.clip_box.y, bg.clip_box.width,
+          bg.clip_box.height, color);
+    }
+  }
+
+  if(bg.image.empty() || cairo->isSkipped(HgCairo::skipImages)) {
+    return;
+  }
+
+  // The image is decoded at the drawn size in the device pixels,
+  // it is not drawn until it is decoded.
+  double drawWidth = bg.image_size.width;
+  double drawHeight = bg.image_size.height;
+  cairo->userToDeviceDistance(drawWidth, drawHeight);
+  HgCairo::SurfacePtr image =
+      mImageCache->getSurface(resolveUrl(bg.image.c_str(), bg.baseurl.c_str()),
+          static_cast<int>(std::ceil(std::abs(drawWidth))),
+          static_cast<int>(std::ceil(std::abs(drawHeight))));
+  if(!image) {
+    return;
+  }
+
+  const litehtml::position& clip = bg.clip_box;
+  litehtml::position area(bg.position_x, bg.position_y, bg.image_size.width,
+      bg.image_size.height);
+  switch(bg.repeat) {
+    case litehtml::background_repeat_repeat:
+      area = clip;
+      break;
+    case litehtml::background_repeat_repeat_x:
+      area.x = clip.x;
+      area.width = clip.width;
+      break;
+    case litehtml::background_repeat_repeat_y:
+      area.y = clip.y;
+      area.height = clip.height;
+      break;
+    case litehtml::background_repeat_no_repeat:
+      break;
+  }
+
+  int left = std::max(area.left(), clip.left());
+  int top = std::max(area.top(), clip.top());
+  int right = std::min(area.right(), clip.right());
+  int bottom = std::min(area.bottom(), clip.bottom());
+  if(right <= left || bottom <= top) {
+    return;
+  }
+
+  cairo->drawImage(image, left, top, right - left, bottom - top,
+      bg.position_x, bg.position_y, bg.image_size.width,
+      bg.image_size.height,
+      bg.repeat != litehtml::background_repeat_no_repeat);
 }
 
 void HgContainer::draw_borders(litehtml::uint_ptr hdc,
@@ -211,11 +562,97 @@ void HgContainer::draw_borders(litehtml::uint_ptr hdc,
     const litehtml::position& draw_pos,
     bool root)
 {
+  HgCairoPtr& cairo = *(reinterpret_cast<HgCairoPtr*>(hdc));
+  if(!cairo) {
+    return;
+  }
+
+  const int left = visibleWidth(borders.left);
+  const int top = visibleWidth(borders.top);
+  const int right = visibleWidth(borders.right);
+  const int bottom = visibleWidth(borders.bottom);
+  if(left == 0 && top == 0 && right == 0 && bottom == 0) {
+    return;
+  }
+
+  ClipScope clipScope(*this, cairo, draw_pos);
+  if(!clipScope.isVisible()) {
+    return;
+  }
+
+  // The most of the borders are filled by the spans without the paths.
+  // The other styles than dotted and dashed are drawn as solid.
+  const litehtml::position& pos = draw_pos;
+  if(isRectBorders(borders)) {
+    const int sideHeight = pos.height - top - bottom;
+    if(top > 0) {
+      cairo->fillRect(pos.x, pos.y, pos.width, top,
+          HgCairo::Color(borders.top.color));
+    }
+    if(bottom > 0) {
+      cairo->fillRect(pos.x, pos.bottom() - bottom, pos.width, bottom,
+          HgCairo::Color(borders.bottom.color));
+    }
+    if(left > 0 && sideHeight > 0) {
+      cairo->fillRect(pos.x, pos.y + top, left, sideHeight,
+          HgCairo::Color(borders.left.color));
+    }
+    if(right > 0 && sideHeight > 0) {
+      cairo->fillRect(pos.right() - right, pos.y + top, right, sideHeight,
+          HgCairo::Color(borders.right.color));
+    }
+    return;
+  }
+
+  const bool rounded = isRounded(borders.radius);
+  const litehtml::position inner(pos.x + left, pos.y + top,
+      std::max(0, pos.width - left - right),
+      std::max(0, pos.height - top - bottom));
+  const litehtml::border_radiuses radii = innerRadii(borders);
+
+  // The side is the trapezoid between the outer and the inner corners.
+  auto drawSide = [&](const litehtml::border& border, double lineX1,
+                      double lineY1, double lineX2, double lineY2,
+                      const std::vector<double>& polygon) {
+    if(!isVisible(border)) {
+      return;
+    }
+    HgCairo::Color color(border.color);
+    if(isDashed(border) && !rounded) {
+      double dash = border.style == litehtml::border_style_dotted
+          ? border.width
+          : border.width * 3;
+      cairo->drawLine(
+          lineX1, lineY1, lineX2, lineY2, border.width, color, dash);
+      return;
+    }
+    cairo->fillFrame(pos, borders.radius, inner, radii, polygon, color);
+  };
+
+  const double x1 = pos.left();
+  const double y1 = pos.top();
+  const double x2 = pos.right();
+  const double y2 = pos.bottom();
+  const double innerX1 = inner.left();
+  const double innerY1 = inner.top();
+  const double innerX2 = inner.right();
+  const double innerY2 = inner.bottom();
+  drawSide(borders.top, x1, y1 + top / 2.0, x2, y1 + top / 2.0,
+      {x1, y1, x2, y1, innerX2, innerY1, innerX1, innerY1});
+  drawSide(borders.right, x2 - right / 2.0, y1, x2 - right / 2.0, y2,
+      {x2, y1, x2, y2, innerX2, innerY2, innerX2, innerY1});
+  drawSide(borders.bottom, x2, y2 - bottom / 2.0, x1, y2 - bottom / 2.0,
+      {x2, y2, x1, y2, innerX1, innerY2, innerX2, innerY2});
+  drawSide(borders.left, x1 + left / 2.0, y2, x1 + left / 2.0, y1,
+      {x1, y2, x1, y1, innerX1, innerY1, innerX1, innerY2});
 }
 
 void HgContainer::set_caption(const litehtml::tchar_t* caption) {}
 
-void HgContainer::set_base_url(const litehtml::tchar_t* base_url) {}
+void HgContainer::set_base_url(const litehtml::tchar_t* base_url)
+{
+  mBaseUrl = base_url ? base_url : "";
+}
 
 void HgContainer::link(const std::shared_ptr<litehtml::document>& ptr,
     const litehtml::element::ptr& el)
@@ -245,9 +682,103 @@ void HgContainer::set_clip(const litehtml::position& pos,
     bool valid_x,
     bool valid_y)
 {
+  // The clip is not limited on the invalid axis.
+  const int unlimited = 1 << 29;
+  Clip clip;
+  clip.mRect = pos;
+  if(!valid_x) {
+    clip.mRect.x = -unlimited;
+    clip.mRect.width = 2 * unlimited;
+  }
+  if(!valid_y) {
+    clip.mRect.y = -unlimited;
+    clip.mRect.height = 2 * unlimited;
+  }
+  clip.mRadii = bdr_radius;
+  clip.mRounded = isRounded(bdr_radius);
+
+  ClipStack* clips = getClipStack(true);
+  clip.mBounds = clips->empty()
+      ? clip.mRect
+      : intersection(clips->back().mBounds, clip.mRect);
+  clips->push_back(clip);
 }
 
-void HgContainer::del_clip() {}
+void HgContainer::del_clip()
+{
+  ClipStack* clips = getClipStack(false);
+  if(clips) {
+    clips->pop_back();
+  }
+}
+
+void HgContainer::clearClips()
+{
+  ClipStack* clips = getClipStack(false);
+  if(clips) {
+    clips->clear();
+  }
+}
+
+HgContainer::ClipStack* HgContainer::getClipStack(bool create)
+{
+  thread_local std::map<const HgContainer*, ClipStack> threadClips;
+  auto it = threadClips.find(this);
+  if(it != threadClips.end() && it->second.empty()) {
+    threadClips.erase(it);
+    it = threadClips.end();
+  }
+  if(it == threadClips.end()) {
+    if(!create) {
+      return nullptr;
+    }
+    it = threadClips.emplace(this, ClipStack()).first;
+  }
+  return &it->second;
+}
+
+HgCairo::SurfacePtr HgContainer::getClipMask(HgCairo& cairo, const Clip& clip)
+{
+  // The mask is of the device pixels of the clip.
+  double width = clip.mRect.width;
+  double height = clip.mRect.height;
+  cairo.userToDeviceDistance(width, height);
+  width = std::ceil(std::abs(width));
+  height = std::ceil(std::abs(height));
+  // The cairo's limit of the image size.
+  const double maxSize = 32767;
+  if(width < 1 || height < 1 || width > maxSize || height > maxSize) {
+    return nullptr;
+  }
+
+  const double scaleX = width / clip.mRect.width;
+  const double scaleY = height / clip.mRect.height;
+  auto scaled = [](int radius, double scale) {
+    return static_cast<int>(std::lround(radius * scale));
+  };
+  litehtml::border_radiuses radii;
+  radii.top_left_x = scaled(clip.mRadii.top_left_x, scaleX);
+  radii.top_left_y = scaled(clip.mRadii.top_left_y, scaleY);
+  radii.top_right_x = scaled(clip.mRadii.top_right_x, scaleX);
+  radii.top_right_y = scaled(clip.mRadii.top_right_y, scaleY);
+  radii.bottom_right_x = scaled(clip.mRadii.bottom_right_x, scaleX);
+  radii.bottom_right_y = scaled(clip.mRadii.bottom_right_y, scaleY);
+  radii.bottom_left_x = scaled(clip.mRadii.bottom_left_x, scaleX);
+  radii.bottom_left_y = scaled(clip.mRadii.bottom_left_y, scaleY);
+  const ClipMaskKey key = {static_cast<int>(width), static_cast<int>(height),
+      radii.top_left_x, radii.top_left_y, radii.top_right_x, radii.top_right_y,
+      radii.bottom_right_x, radii.bottom_right_y, radii.bottom_left_x,
+      radii.bottom_left_y};
+
+  std::lock_guard<std::mutex> lock(mClipMaskMutex);
+  if(mClipMasks.check(key)) {
+    return mClipMasks.fetch(key);
+  }
+  HgCairo::SurfacePtr mask =
+      HgCairo::createRoundedMask(key[0], key[1], radii);
+  mClipMasks.insert(key, mask);
+  return mask;
+}
 
 void HgContainer::get_client_rect(litehtml::position& client) const
 {
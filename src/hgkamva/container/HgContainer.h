@@ -24,12 +24,19 @@
 #ifndef HG_CONTAINER_H
 #define HG_CONTAINER_H
 
+#include <array>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
+
+#include <stlcache/stlcache.hpp>
 
 #include "litehtml.h"
 
-#include "hgkamva/container/HgFontLibrary.h"
+#include "hgkamva/container/HgEngine.h"
+#include "hgkamva/container/HgFont.h"
+#include "hgkamva/container/HgImageCache.h"
 #include "hgkamva/util/Filesystem.h"
 
 namespace hg
@@ -43,13 +50,18 @@ class HgContainer : public litehtml::document_container
 public:
   // TODO: Copy/move constructors/operators.
   explicit HgContainer();
-  virtual ~HgContainer() = default;
+  // The fonts and the font configuration are shared with the engine.
+  explicit HgContainer(HgEnginePtr engine);
+  virtual ~HgContainer();
 
   bool parseAndLoadFontConfigFromMemory(
       const std::string& fontConfig, bool complain);
   bool addFontDir(const hg::filesystem::path& dirPath);
   void setDefaultFontName(const std::string& name);
   void setDefaultFontSize(int size);
+  // Is engine-wide, see HgEngine::setFontTextCacheSize(): it changes
+  // the fonts of all documents on the engine which are created after
+  // this call, the already used fonts keep their cache size.
   void setFontTextCacheSize(int size);
 
   void setDeviceWidth(int width);
@@ -64,6 +76,17 @@ public:
   void setDeviceColorIndex(int colorIndex);
   void setDeviceMediaType(litehtml::media_type type);
 
+  // The relative image URLs are resolved against the base URL,
+  // see HgImageCache::resolveUrl().
+  void setBaseUrl(const std::string& baseUrl);
+  // The images are shared by the containers with the same cache,
+  // by default it is the cache of the engine.
+  void setImageCache(HgImageCachePtr imageCache);
+  HgImageCachePtr getImageCache() const { return mImageCache; }
+  // Is called when the image of any container sharing the cache
+  // is decoded, see HgImageCache::ReadyCallback.
+  void setImageReadyCallback(HgImageCache::ReadyCallback callback);
+
   // litehtml::document_container interface.
   virtual litehtml::uint_ptr create_font(const litehtml::tchar_t* faceName,
       int size,
@@ -127,12 +150,61 @@ public:
   //virtual litehtml::tstring resolve_color(
   //    const litehtml::tstring& color) const override;
 
+  HgEnginePtr getEngine() const { return mEngine; }
+  // The shared font of the litehtml font handle.
+  static HgFontPtr getFont(litehtml::uint_ptr hFont);
+  // Drops the clips of the calling thread, which are left
+  // if the document drawing throws between set_clip() and del_clip().
+  void clearClips();
+
+  // The rounded clip masks kept for the reuse.
+  static constexpr std::size_t CLIP_MASK_CACHE_SIZE = 64;
+
 private:
-  HgFontLibraryPtr mHgFontLibrary;
+  // The clip of set_clip(). The plain rects are intersected to the bounds,
+  // the rounded rects are drawn through the cached masks.
+  struct Clip
+  {
+    litehtml::position mRect;
+    litehtml::border_radiuses mRadii;
+    bool mRounded;
+    // The intersection of the rects of this clip and the outer ones.
+    litehtml::position mBounds;
+  };
+  using ClipStack = std::vector<Clip>;
+  // The mask size in the device pixels and the radii.
+  using ClipMaskKey = std::array<int, 10>;
+  using ClipMaskCache = stlcache::
+      cache<ClipMaskKey, HgCairo::SurfacePtr, stlcache::policy_lru>;
+
+  // Applies the clips to the drawing of the area while it is alive.
+  class ClipScope;
+
+  std::string resolveUrl(
+      const litehtml::tchar_t* src, const litehtml::tchar_t* baseurl) const;
+  // The documents may be drawn concurrently, so the clips are set
+  // for the drawing thread. Returns nullptr if there are no clips
+  // and not create.
+  ClipStack* getClipStack(bool create);
+  HgCairo::SurfacePtr getClipMask(HgCairo& cairo, const Clip& clip);
+
+  // The litehtml font handle, the font itself is shared by the engine.
+  struct FontHandle
+  {
+    HgFontPtr mFont;
+    bool mStrikeout;
+    bool mUnderline;
+  };
+
+  HgEnginePtr mEngine;
+  HgImageCachePtr mImageCache;
+  HgImageCache::ReadyCallback mImageReadyCallback;
+  std::string mBaseUrl;
+  std::mutex mClipMaskMutex;
+  ClipMaskCache mClipMasks;
 
   std::string mFontDefaultName;
   int mDefaultFontSize;
-  int mFontTextCacheSize;
 
   // (pixels) The width of the rendering surface of the output device.
   // For continuous media, this is the width of the screen.
@@ -190,7 +262,7 @@ inline void HgContainer::setDefaultFontSize(int size)
 
 inline void HgContainer::setFontTextCacheSize(int size)
 {
-  mFontTextCacheSize = size;
+  mEngine->setFontTextCacheSize(size);
 }
 
 inline void HgContainer::setDeviceWidth(int width)
@@ -243,6 +315,11 @@ inline void HgContainer::setDeviceMediaType(litehtml::media_type type)
   mDeviceMediaType = type;
 }
 
+inline void HgContainer::setBaseUrl(const std::string& baseUrl)
+{
+  mBaseUrl = baseUrl;
+}
+
 }  // namespace hg
 
 #endif  // HG_CONTAINER_H
@@ -21,6 +21,8 @@
  *    along with this program. If not, see <http://www.gnu.org/licenses/>.
  ****************************************************************************/
 
+#include <cstdint>
+#include <cstring>
 #include <string>
 
 #include "gtest/gtest.h"
@@ -29,6 +31,8 @@
 #include "hgkamva/container/HgContainer.h"
 #include "hgkamva/util/FileUtil.h"
 #include "hgkamva/util/Filesystem.h"
+#include "hgkamva/util/ImageCompare.h"
+#include "hgkamva/util/ImageWriter.h"
 
 inline hg::filesystem::path testDir;
 inline hg::filesystem::path fontDir;
@@ -158,12 +162,17 @@ TEST(HgContainerTest, draw_text)
   // Write our picture to file.
   std::string fileName1 = "HgContainer_1.ppm";
   hg::filesystem::path fileOutTest1 = testDir / fileName1;
-  hg::util::writePpmFile(
-      frameBuf.data(), frameWidth, frameHeight, BYTES_PER_PIXEL, fileOutTest1);
+  hg::util::writeImageFile(frameBuf.data(), frameWidth, frameHeight, stride,
+      hg::util::PixelFormat::argb32, hg::util::ImageFileType::ppm,
+      fileOutTest1);
 
   // Compare our file with prototype.
   hg::filesystem::path fileTest1 = dataDir / fileName1;
-  EXPECT_TRUE(hg::util::compareFiles(fileTest1, fileOutTest1));
+  hg::util::ImageCompareResult result1 =
+      hg::util::compareImageFiles(fileTest1, fileOutTest1,
+          hg::util::ImageCompareOptions::antialiasing(),
+          fileOutTest1.string() + ".diff.ppm");
+  EXPECT_TRUE(result1.mMatched) << result1;
 
   //////// Repeat tests for new text.
 
@@ -177,12 +186,17 @@ TEST(HgContainerTest, draw_text)
   // Write our picture to file.
   std::string fileName2 = "HgContainer_2.ppm";
   hg::filesystem::path fileOutTest2 = testDir / fileName2;
-  hg::util::writePpmFile(
-      frameBuf.data(), frameWidth, frameHeight, BYTES_PER_PIXEL, fileOutTest2);
+  hg::util::writeImageFile(frameBuf.data(), frameWidth, frameHeight, stride,
+      hg::util::PixelFormat::argb32, hg::util::ImageFileType::ppm,
+      fileOutTest2);
 
   // Compare our file with prototype.
   hg::filesystem::path fileTest2 = dataDir / fileName2;
-  EXPECT_TRUE(hg::util::compareFiles(fileTest2, fileOutTest2));
+  hg::util::ImageCompareResult result2 =
+      hg::util::compareImageFiles(fileTest2, fileOutTest2,
+          hg::util::ImageCompareOptions::antialiasing(),
+          fileOutTest2.string() + ".diff.ppm");
+  EXPECT_TRUE(result2.mMatched) << result2;
 
   //////// Deinit part.
 
@@ -275,10 +289,147 @@ TEST(HgContainerTest, drawHtmlDocument)
   // Write our picture to file.
   std::string fileName1 = "HtmlDocument_1.ppm";
   hg::filesystem::path fileOutTest1 = testDir / fileName1;
-  hg::util::writePpmFile(
-      frameBuf.data(), frameWidth, frameHeight, BYTES_PER_PIXEL, fileOutTest1);
+  hg::util::writeImageFile(frameBuf.data(), frameWidth, frameHeight, stride,
+      hg::util::PixelFormat::argb32, hg::util::ImageFileType::ppm,
+      fileOutTest1);
 
   // Compare our file with prototype.
   hg::filesystem::path fileTest1 = dataDir / fileName1;
-  EXPECT_TRUE(hg::util::compareFiles(fileTest1, fileOutTest1));
+  hg::util::ImageCompareResult result1 =
+      hg::util::compareImageFiles(fileTest1, fileOutTest1,
+          hg::util::ImageCompareOptions::antialiasing(),
+          fileOutTest1.string() + ".diff.ppm");
+  EXPECT_TRUE(result1.mMatched) << result1;
+}
+
+TEST(HgContainerTest, draw_borders)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const unsigned int frameWidth = 40;
+  const unsigned int frameHeight = 30;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+
+  std::vector<unsigned char> frameBuf(stride * frameHeight);
+
+  hg::HgCairoPtr cairo = std::make_shared<hg::HgCairo>(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride);
+  cairo->clear(hg::HgCairo::Color{0, 0, 0, 1});
+
+  auto getPixel = [&frameBuf, stride](int x, int y) {
+    uint32_t pixel;
+    std::memcpy(&pixel, frameBuf.data() + y * stride + x * 4, 4);
+    return pixel;
+  };
+
+  hg::HgContainer container{};
+  litehtml::uint_ptr hdc = reinterpret_cast<litehtml::uint_ptr>(&cairo);
+
+  litehtml::background_paint bg;
+  bg.color = litehtml::web_color(0, 0, 255);
+  bg.clip_box = litehtml::position(10, 5, 20, 20);
+  bg.border_box = bg.clip_box;
+  container.draw_background(hdc, bg);
+
+  litehtml::borders borders;
+  for(litehtml::border* border :
+      {&borders.left, &borders.top, &borders.right, &borders.bottom}) {
+    border->width = 1;
+    border->style = litehtml::border_style_solid;
+    border->color = litehtml::web_color(255, 0, 0);
+  }
+  borders.top.width = 2;
+  borders.bottom.width = 2;
+  container.draw_borders(hdc, borders, bg.border_box, false);
+
+  // The opaque borders are the rects.
+  EXPECT_EQ(0xFF000000, getPixel(9, 5));
+  EXPECT_EQ(0xFFFF0000, getPixel(10, 5));
+  EXPECT_EQ(0xFFFF0000, getPixel(29, 6));
+  EXPECT_EQ(0xFFFF0000, getPixel(10, 7));
+  EXPECT_EQ(0xFF0000FF, getPixel(11, 7));
+  EXPECT_EQ(0xFF0000FF, getPixel(28, 22));
+  EXPECT_EQ(0xFFFF0000, getPixel(29, 22));
+  EXPECT_EQ(0xFFFF0000, getPixel(20, 24));
+  EXPECT_EQ(0xFF000000, getPixel(20, 25));
+
+  // The translucent and the rounded ones.
+  cairo->clear(hg::HgCairo::Color{0, 0, 0, 1});
+  bg.color = litehtml::web_color(0, 0, 255, 128);
+  container.draw_background(hdc, bg);
+  EXPECT_EQ(0xFF000080, getPixel(20, 15));
+
+  borders.radius.top_left_x = 8;
+  borders.radius.top_left_y = 8;
+  container.draw_borders(hdc, borders, bg.border_box, false);
+  EXPECT_EQ(0xFF000000, getPixel(10, 5));
+  EXPECT_EQ(0xFFFF0000, getPixel(20, 5));
+  EXPECT_EQ(0xFFFF0000, getPixel(29, 5));
+  EXPECT_EQ(0xFF000080, getPixel(20, 15));
+}
+
+TEST(HgContainerTest, set_clip)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const unsigned int frameWidth = 40;
+  const unsigned int frameHeight = 30;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+
+  std::vector<unsigned char> frameBuf(stride * frameHeight);
+
+  hg::HgCairoPtr cairo = std::make_shared<hg::HgCairo>(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride);
+  cairo->clear(hg::HgCairo::Color{0, 0, 0, 1});
+
+  auto getPixel = [&frameBuf, stride](int x, int y) {
+    uint32_t pixel;
+    std::memcpy(&pixel, frameBuf.data() + y * stride + x * 4, 4);
+    return pixel;
+  };
+
+  hg::HgContainer container{};
+  litehtml::uint_ptr hdc = reinterpret_cast<litehtml::uint_ptr>(&cairo);
+
+  litehtml::background_paint bg;
+  bg.color = litehtml::web_color(0, 0, 255);
+  bg.clip_box = litehtml::position(0, 0, 40, 30);
+  bg.border_box = bg.clip_box;
+
+  // The rect clips are intersected.
+  litehtml::border_radiuses radii;
+  container.set_clip(litehtml::position(5, 5, 20, 20), radii, true, true);
+  container.set_clip(litehtml::position(10, 0, 30, 15), radii, true, true);
+  container.draw_background(hdc, bg);
+  container.del_clip();
+  container.del_clip();
+  EXPECT_EQ(0xFF000000, getPixel(9, 10));
+  EXPECT_EQ(0xFF0000FF, getPixel(10, 5));
+  EXPECT_EQ(0xFF0000FF, getPixel(24, 14));
+  EXPECT_EQ(0xFF000000, getPixel(25, 14));
+  EXPECT_EQ(0xFF000000, getPixel(24, 15));
+
+  // The invalid axis is not clipped.
+  container.set_clip(litehtml::position(5, 5, 20, 20), radii, false, true);
+  container.draw_background(hdc, bg);
+  container.del_clip();
+  EXPECT_EQ(0xFF0000FF, getPixel(0, 20));
+  EXPECT_EQ(0xFF000000, getPixel(0, 0));
+
+  // The rounded clip, the corner is masked out.
+  cairo->clear(hg::HgCairo::Color{0, 0, 0, 1});
+  radii.top_left_x = 10;
+  radii.top_left_y = 10;
+  container.set_clip(litehtml::position(10, 5, 20, 20), radii, true, true);
+  for(int i = 0; i < 2; ++i) {
+    container.draw_background(hdc, bg);
+  }
+  container.del_clip();
+  EXPECT_EQ(0xFF000000, getPixel(10, 5));
+  EXPECT_EQ(0xFF0000FF, getPixel(20, 15));
+  EXPECT_EQ(0xFF0000FF, getPixel(29, 5));
+  EXPECT_EQ(0xFF000000, getPixel(30, 15));
+
+  // No clips after del_clip().
+  cairo->clear(hg::HgCairo::Color{0, 0, 0, 1});
+  container.draw_background(hdc, bg);
+  EXPECT_EQ(0xFF0000FF, getPixel(0, 0));
 }
@@ -0,0 +1,115 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/container/HgEngine.h"
+
+namespace hg
+{
+HgEngine::HgEngine()
+    : mHgFontLibrary{std::make_shared<HgFontLibrary>()}
+    , mHtmlContext{std::make_shared<litehtml::context>()}
+    , mImageCache{std::make_shared<HgImageCache>()}
+    , mFontTextCacheSize{1000}
+{
+}
+
+bool HgEngine::parseAndLoadFontConfigFromMemory(
+    const std::string& fontConfig, bool complain)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mFontMatches.clear();
+  return mHgFontLibrary->parseAndLoadConfigFromMemory(fontConfig, complain);
+}
+
+bool HgEngine::addFontDir(const hg::filesystem::path& dirPath)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mFontMatches.clear();
+  return mHgFontLibrary->addFontDir(dirPath);
+}
+
+void HgEngine::setFontTextCacheSize(int size)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mFontTextCacheSize = size;
+}
+
+void HgEngine::loadMasterStylesheet(const std::string& css)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mHtmlContext->load_master_stylesheet(css.c_str());
+}
+
+HgFontPtr HgEngine::getFont(const std::string& faceName,
+    const int pixelSize,
+    const int weight,
+    const litehtml::font_style fontStyle)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  FontRequest request{faceName, pixelSize, weight, fontStyle};
+  auto match = mFontMatches.find(request);
+  if(match != mFontMatches.end()) {
+    return match->second;
+  }
+
+  HgFontPtr hgFont;
+
+  uint_least8_t result;
+  hg::filesystem::path filePath = mHgFontLibrary->getFontFilePath(
+      faceName, pixelSize, weight, fontStyle, &result);
+  if(!filePath.empty() && HgFontLibrary::FontMatches::allMatched == result) {
+    FaceKey faceKey{filePath.string(), pixelSize};
+    auto face = mFontFaces.find(faceKey);
+    if(face != mFontFaces.end()) {
+      hgFont = face->second;
+    } else {
+      hgFont = std::make_shared<HgFont>(
+          mHgFontLibrary->ftLibrary(), mFontTextCacheSize);
+      if(!hgFont->createFtFace(filePath, pixelSize)) {
+        return nullptr;
+      }
+      mFontFaces.emplace(faceKey, hgFont);
+    }
+  }
+
+  mFontMatches.emplace(request, hgFont);
+  return hgFont;
+}
+
+void HgEngine::releaseUnusedFonts()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  // The pool holds the font twice, in mFontMatches and in mFontFaces.
+  mFontMatches.clear();
+  for(auto it = mFontFaces.begin(); it != mFontFaces.end();) {
+    if(it->second.use_count() == 1) {
+      it = mFontFaces.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace hg
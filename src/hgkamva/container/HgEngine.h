@@ -0,0 +1,113 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_ENGINE_H
+#define HG_ENGINE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "litehtml.h"
+
+#include "hgkamva/container/HgFont.h"
+#include "hgkamva/container/HgFontLibrary.h"
+#include "hgkamva/container/HgImageCache.h"
+#include "hgkamva/util/Filesystem.h"
+
+namespace hg
+{
+class HgEngine;
+
+using HgEnginePtr = std::shared_ptr<HgEngine>;
+
+// The font library, the pool of the font faces with their shaping caches,
+// the litehtml context with the parsed master CSS and the image cache
+// with its decoding pool, shared by any number of documents.
+// All methods are thread-safe.
+//
+// The documents of the same engine or of different engines may be parsed,
+// laid out and drawn concurrently, one thread per document. The font
+// configuration and the master CSS must be loaded before the documents
+// are created, the litehtml context is read without locking.
+class HgEngine
+{
+public:
+  // TODO: Copy/move constructors/operators.
+  explicit HgEngine();
+  ~HgEngine() = default;
+
+  bool parseAndLoadFontConfigFromMemory(
+      const std::string& fontConfig, bool complain);
+  bool addFontDir(const hg::filesystem::path& dirPath);
+  // For the fonts created after this call, the pooled fonts keep
+  // their cache size.
+  void setFontTextCacheSize(int size);
+
+  void loadMasterStylesheet(const std::string& css);
+
+  // Returns the shared font for the requested face or nullptr
+  // if the font library has not exactly matched font.
+  HgFontPtr getFont(const std::string& faceName,
+      const int pixelSize,
+      const int weight,
+      const litehtml::font_style fontStyle);
+  // Releases the fonts which are not used by any document.
+  void releaseUnusedFonts();
+
+  std::shared_ptr<litehtml::context> getHtmlContext() const;
+  // The images of the documents are loaded and decoded once.
+  HgImageCachePtr getImageCache() const;
+
+private:
+  using FontRequest = std::tuple<std::string, int, int, litehtml::font_style>;
+  using FaceKey = std::tuple<std::string, int>;
+
+  std::mutex mMutex;
+
+  HgFontLibraryPtr mHgFontLibrary;
+  std::shared_ptr<litehtml::context> mHtmlContext;
+  HgImageCachePtr mImageCache;
+  int mFontTextCacheSize;
+
+  // The font matched for the request, nullptr if not matched.
+  std::map<FontRequest, HgFontPtr> mFontMatches;
+  // The font faces by file path and pixel size.
+  std::map<FaceKey, HgFontPtr> mFontFaces;
+};  // class HgEngine
+
+inline std::shared_ptr<litehtml::context> HgEngine::getHtmlContext() const
+{
+  return mHtmlContext;
+}
+
+inline HgImageCachePtr HgEngine::getImageCache() const
+{
+  return mImageCache;
+}
+
+}  // namespace hg
+
+#endif  // HG_ENGINE_H
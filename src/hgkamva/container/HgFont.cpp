@@ -23,21 +23,35 @@
 
 #include "hgkamva/container/HgFont.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <limits>
 #include <stdexcept>
 
+#include <cairo/cairo-ft.h>
+
 namespace hg
 {
+namespace
+{
+// FT_New_Face() and FT_Done_Face() must not run concurrently
+// for the same FT_Library.
+std::mutex ftFaceMutex;
+
+void doneFtFace(FT_Face ftFace)
+{
+  std::lock_guard<std::mutex> lock(ftFaceMutex);
+  FT_Done_Face(ftFace);
+}
+}  // namespace
+
 HgFont::HgFont(FtLibraryPtr ftLibrary, const int textCacheSize)
     : mFtLibrary{ftLibrary}
     , mHbBuffer{hb_buffer_create(), hb_buffer_destroy}
     , mScaledFontExtents{0.0, 0.0, 0.0, 0.0, 0.0}
     , mTextLayoutCache{std::make_shared<TextLayoutCache>(textCacheSize)}
     , mPixelSize{10}
-    , mStrikeout{false}
-    , mUnderline{false}
     , mxHeight{0.0}
 {
 }
@@ -51,11 +65,14 @@ bool HgFont::createFtFace(
   mPixelSize = pixelSize;
 
   FT_Face ftFace;
-  if(FT_New_Face(mFtLibrary.get(), fontFilePath.c_str(), 0, &ftFace)
-      != FT_Err_Ok) {
-    throw std::logic_error("FT_New_Face() != FT_Err_Ok");
+  {
+    std::lock_guard<std::mutex> lock(ftFaceMutex);
+    if(FT_New_Face(mFtLibrary.get(), fontFilePath.c_str(), 0, &ftFace)
+        != FT_Err_Ok) {
+      throw std::logic_error("FT_New_Face() != FT_Err_Ok");
+    }
   }
-  mFtFace = {ftFace, FT_Done_Face};
+  mFtFace = {ftFace, doneFtFace};
 
   //  if(FT_Set_Pixel_Sizes(mFtFace.get(), 0, mPixelSize) != FT_Err_Ok) {
   //    throw std::logic_error("FT_Set_Pixel_Sizes() != FT_Err_Ok");
@@ -73,6 +90,8 @@ bool HgFont::createFtFace(
 
   mCairoScaledFont =
       HgCairo::getScaledFont(mFtFace.get(), FT_LOAD_DEFAULT, mPixelSize);
+  mDraftScaledFont = HgCairo::getScaledFont(
+      mFtFace.get(), FT_LOAD_NO_HINTING, mPixelSize, true);
 
   //    mFtRasterParams.flags = FT_RASTER_FLAG_DIRECT | FT_RASTER_FLAG_AA;
   return true;
@@ -102,28 +121,33 @@ int HgFont::forceUcs2Charmap(FT_Face ftf)
 
 void HgFont::resetBuffer()
 {
+  std::lock_guard<std::mutex> lock(mMutex);
   hb_buffer_reset(mHbBuffer.get());
 }
 
 void HgFont::clearBuffer()
 {
+  std::lock_guard<std::mutex> lock(mMutex);
   // Clean up the buffer, but don't kill it just yet.
   hb_buffer_clear_contents(mHbBuffer.get());
 }
 
 void HgFont::setDirection(const hb_direction_t direction)
 {
+  std::lock_guard<std::mutex> lock(mMutex);
   // NOTE: see also hb_script_get_horizontal_direction()
   hb_buffer_set_direction(mHbBuffer.get(), direction);
 }
 
 void HgFont::setScript(const hb_script_t script)
 {
+  std::lock_guard<std::mutex> lock(mMutex);
   hb_buffer_set_script(mHbBuffer.get(), script);  // see hb-unicode.h
 }
 
 void HgFont::setLanguage(const std::string& language)
 {
+  std::lock_guard<std::mutex> lock(mMutex);
   // For ISO 639 Code see
   // http://www.loc.gov/standards/iso639-2/php/code_list.php
   hb_buffer_set_language(mHbBuffer.get(),
@@ -134,21 +158,28 @@ typename HgFont::TextLayoutPtr HgFont::getTextLayout(const std::string& text)
 {
   // TODO: check buffer state.
 
+  std::lock_guard<std::mutex> lock(mMutex);
+
   if(mTextLayoutCache->check(text)) {
     return mTextLayoutCache->fetch(text);
   }
 
-  clearBuffer();
+  // The public buffer setters lock the mutex, call HarfBuzz directly here.
+  hb_buffer_clear_contents(mHbBuffer.get());
 
   // TODO: set Direction, Script and Language through HgContainer's methods.
-  setDirection(HB_DIRECTION_LTR);
-  setScript(HB_SCRIPT_LATIN);
-  setLanguage("eng");
+  hb_buffer_set_direction(mHbBuffer.get(), HB_DIRECTION_LTR);
+  hb_buffer_set_script(mHbBuffer.get(), HB_SCRIPT_LATIN);
+  hb_buffer_set_language(mHbBuffer.get(), hb_language_from_string("eng", 3));
 
   // Layout the text
   hb_buffer_add_utf8(
       mHbBuffer.get(), text.c_str(), text.size(), 0, text.size());
+  // The FT face is shared with cairo which may rasterize glyphs
+  // in other threads.
+  cairo_ft_scaled_font_lock_face(mCairoScaledFont.get());
   hb_shape(mHbFont.get(), mHbBuffer.get(), nullptr, 0);
+  cairo_ft_scaled_font_unlock_face(mCairoScaledFont.get());
 
   unsigned int glyphCount;
   hb_glyph_info_t* glyphInfo =
@@ -158,9 +189,14 @@ typename HgFont::TextLayoutPtr HgFont::getTextLayout(const std::string& text)
 
   HgCairo::GlyphVectorPtr glyphs =
       std::make_shared<HgCairo::GlyphVector>(glyphCount);
+  TextPositionVector positions;
   double x = 0;
   double y = 0;
   for(unsigned int i = 0; i < glyphCount; ++i) {
+    // The text is shaped LTR, the clusters are increasing.
+    if(0 == i || glyphInfo[i].cluster != glyphInfo[i - 1].cluster) {
+      positions.push_back({glyphInfo[i].cluster, x});
+    }
     (*glyphs)[i].index = glyphInfo[i].codepoint;
     (*glyphs)[i].x =
         x + (static_cast<double>(glyphPos[i].x_offset) / FT_64_DOUBLE);
@@ -175,13 +211,17 @@ typename HgFont::TextLayoutPtr HgFont::getTextLayout(const std::string& text)
   cairo_scaled_font_glyph_extents(
       mCairoScaledFont.get(), glyphs->data(), glyphCount, textExtents.get());
 
-  TextLayoutPtr textLayout = std::make_shared<TextLayout>(glyphs, textExtents);
+  positions.push_back({text.size(), x});
+
+  TextLayoutPtr textLayout = std::make_shared<TextLayout>(
+      glyphs, textExtents, std::move(positions));
   mTextLayoutCache->insert(text, textLayout);
   return textLayout;
 }
 
 const cairo_font_extents_t& HgFont::getScaledFontExtents()
 {
+  std::lock_guard<std::mutex> lock(mMutex);
   if(mScaledFontExtents.height > 0) {
     return mScaledFontExtents;
   }
@@ -201,12 +241,57 @@ void HgFont::drawText(HgCairoPtr cairo,
     const litehtml::web_color& color)
 {
   TextLayoutPtr textLayout = getTextLayout(text);
-  cairo->showGlyphs(*textLayout->mGlyphs, mCairoScaledFont, x, y,
+
+  const HgCairo::ScaledFontPtr& scaledFont =
+      cairo->quality() == HgCairo::draftQuality ? mDraftScaledFont
+                                                : mCairoScaledFont;
+  cairo->showGlyphs(*textLayout->mGlyphs, scaledFont, x, y,
       *textLayout->mExtents, HgCairo::Color{color});
 }
 
+void HgFont::drawTextBar(
+    HgCairoPtr cairo, const double x, const double y, const double width)
+{
+  if(width <= 0) {
+    return;
+  }
+  double height = xHeight();
+  cairo->fillRect(
+      x, y - height, width, height, HgCairo::Color{0.6, 0.6, 0.6, 1.0});
+}
+
+std::size_t HgFont::textOffsetAtX(const std::string& text, const double x)
+{
+  TextLayoutPtr textLayout = getTextLayout(text);
+  const TextPositionVector& positions = textLayout->mPositions;
+  auto it = std::lower_bound(positions.begin(), positions.end(), x,
+      [](const TextPosition& pos, double x) { return pos.mX < x; });
+  if(it == positions.end()) {
+    return positions.back().mOffset;
+  }
+  if(it != positions.begin() && x - (it - 1)->mX < it->mX - x) {
+    --it;
+  }
+  return it->mOffset;
+}
+
+double HgFont::xAtTextOffset(const std::string& text, const std::size_t offset)
+{
+  TextLayoutPtr textLayout = getTextLayout(text);
+  const TextPositionVector& positions = textLayout->mPositions;
+  auto it = std::upper_bound(positions.begin(), positions.end(), offset,
+      [](std::size_t offset, const TextPosition& pos) {
+        return offset < pos.mOffset;
+      });
+  if(it != positions.begin()) {
+    --it;
+  }
+  return it->mX;
+}
+
 double HgFont::xHeight()
 {
+  std::lock_guard<std::mutex> lock(mMutex);
   if(mxHeight > 0) {
     return mxHeight;
   }
@@ -24,8 +24,12 @@
 #ifndef HG_FONT_H
 #define HG_FONT_H
 
+#include <cstddef>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -49,6 +53,10 @@ class HgFont;
 
 using HgFontPtr = std::shared_ptr<HgFont>;
 
+// Text measuring and drawing may be called concurrently from the views
+// and the documents sharing the font, the text layout cache
+// and the HarfBuzz buffer are guarded by the mutex.
+// The text decorations are set per font handle by the container.
 class HgFont
 {
 public:
@@ -74,20 +82,25 @@ public:
       const double x,
       const double y,
       const litehtml::web_color& color);
+  // The text of the thumbnail quality, the gray bar of the width
+  // and the x-height at the text origin. The text is not shaped.
+  void drawTextBar(
+      HgCairoPtr cairo, const double x, const double y, const double width);
 
   double xHeight();
 
+  // The text positions are the HarfBuzz cluster boundaries, they are cached
+  // with the text layout. The offsets are in bytes of the UTF-8 text,
+  // x is from the text origin.
+  // The offset of the text position nearest to x.
+  std::size_t textOffsetAtX(const std::string& text, const double x);
+  // The x of the text position at or before the offset.
+  double xAtTextOffset(const std::string& text, const std::size_t offset);
+
   static FT_F26Dot6 intToF26Dot6(int pixelSize);
   static int f26Dot6ToInt(FT_F26Dot6 f26Dot6Pixels);
 
-  // TODO: get size, strikeout and underline from FT structs if possible,
-  // TODO: remove it here.
-  void setPixelSize(int pixelSize) { mPixelSize = pixelSize; }
-  void setUnderline(bool underline) { mUnderline = underline; }
-  void setStrikeout(bool strikeout) { mStrikeout = strikeout; }
-  int pixelSize() { return mPixelSize; }
-  bool underline() { return mUnderline; }
-  bool strikeout() { return mStrikeout; }
+  int pixelSize() const { return mPixelSize; }
 
 private:
   static constexpr int FT_64_INT = 64;
@@ -97,17 +110,29 @@ private:
   using HbBufferPtr = std::shared_ptr<hb_buffer_t>;
   using HbFontPtr = std::shared_ptr<hb_font_t>;
 
+  struct TextPosition
+  {
+    std::size_t mOffset;
+    double mX;
+  };
+
+  using TextPositionVector = std::vector<TextPosition>;
+
   struct TextLayout
   {
-    explicit TextLayout(
-        HgCairo::GlyphVectorPtr glyphs, HgCairo::TextExtentsPtr textExtents)
+    explicit TextLayout(HgCairo::GlyphVectorPtr glyphs,
+        HgCairo::TextExtentsPtr textExtents,
+        TextPositionVector&& positions)
         : mGlyphs{glyphs}
         , mExtents{textExtents}
+        , mPositions{std::move(positions)}
     {
     }
 
     HgCairo::GlyphVectorPtr mGlyphs;
     HgCairo::TextExtentsPtr mExtents;
+    // Ordered by the offset and by x, the last one is the text end.
+    TextPositionVector mPositions;
     // TODO:
     //hb_direction_t mDirection;
     //hb_script_t mScript;
@@ -122,6 +147,8 @@ private:
   static int forceUcs2Charmap(FT_Face ftf);
   TextLayoutPtr getTextLayout(const std::string& text);
 
+  std::mutex mMutex;
+
   FtLibraryPtr mFtLibrary;
   FtFacePtr mFtFace;
 
@@ -129,13 +156,13 @@ private:
   HbFontPtr mHbFont;
 
   HgCairo::ScaledFontPtr mCairoScaledFont;
+  // For the draft quality, it has its own glyph cache.
+  HgCairo::ScaledFontPtr mDraftScaledFont;
   cairo_font_extents_t mScaledFontExtents;
 
   TextLayoutCachePtr mTextLayoutCache;
 
   int mPixelSize;
-  bool mStrikeout;
-  bool mUnderline;
   double mxHeight;
 };  // class HgFont
 
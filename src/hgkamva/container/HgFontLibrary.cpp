@@ -39,13 +39,14 @@ bool HgFontLibrary::parseAndLoadConfigFromMemory(
     const std::string& fontConfig, const bool complain)
 {
   const FcChar8* config = reinterpret_cast<const FcChar8*>(fontConfig.c_str());
-  return FcConfigParseAndLoadFromMemory(mFcConfig.get(), config, complain)
-      && FcConfigSetCurrent(mFcConfig.get());
+  std::lock_guard<std::mutex> lock(mMutex);
+  return FcConfigParseAndLoadFromMemory(mFcConfig.get(), config, complain);
 }
 
 bool HgFontLibrary::addFontDir(const hg::filesystem::path& dirPath)
 {
   const FcChar8* dir = reinterpret_cast<const FcChar8*>(dirPath.c_str());
+  std::lock_guard<std::mutex> lock(mMutex);
   return FcConfigAppFontAddDir(mFcConfig.get(), dir);
 }
 
@@ -77,6 +78,8 @@ hg::filesystem::path HgFontLibrary::getFontFilePath(const std::string& names,
   FcPatternAddInteger(pat.get(), FC_PIXEL_SIZE, pixelSize);
   FcPatternAddInteger(pat.get(), FC_WEIGHT, fcWeight);
 
+  std::lock_guard<std::mutex> lock(mMutex);
+
   FcConfigSubstitute(mFcConfig.get(), pat.get(), FcMatchPattern);
   FcDefaultSubstitute(pat.get());
 
@@ -25,6 +25,7 @@
 #define HG_FONT_LIBRARY_H
 
 #include <cstdint>
+#include <mutex>
 #include <string>
 
 #include <fontconfig/fontconfig.h>
@@ -46,6 +47,9 @@ using FcConfigPtr = std::shared_ptr<FcConfig>;
 using FcPatternPtr = std::shared_ptr<FcPattern>;
 using FtLibraryPtr = std::shared_ptr<FT_LibraryRec_>;
 
+// Owns the fontconfig configuration and the FreeType library.
+// The methods are thread-safe, the configuration is used only
+// by this library and is never set as the process current one.
 class HgFontLibrary
 {
 public:
@@ -79,6 +83,8 @@ private:
   int fontStyleToFcSlant(const litehtml::font_style fontStyle) const;
 
 private:
+  mutable std::mutex mMutex;
+
   FcConfigPtr mFcConfig;
   FtLibraryPtr mFtLibrary;
 };  // class HgFontLibrary
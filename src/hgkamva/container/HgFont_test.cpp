@@ -34,6 +34,8 @@
 #include "hgkamva/container/HgFontLibrary.h"
 #include "hgkamva/util/FileUtil.h"
 #include "hgkamva/util/Filesystem.h"
+#include "hgkamva/util/ImageCompare.h"
+#include "hgkamva/util/ImageWriter.h"
 #include "hgkamva/util/StringUtil.h"
 
 inline hg::filesystem::path testDir;
@@ -149,12 +151,17 @@ TEST(HgFontTest, HgFontTest)
   // Write our picture to file.
   std::string fileName1 = "HgFontTest_1.ppm";
   hg::filesystem::path fileOutTest1 = testDir / fileName1;
-  hg::util::writePpmFile(
-      frameBuf.data(), frameWidth, frameHeight, BYTES_PER_PIXEL, fileOutTest1);
+  hg::util::writeImageFile(frameBuf.data(), frameWidth, frameHeight, stride,
+      hg::util::PixelFormat::argb32, hg::util::ImageFileType::ppm,
+      fileOutTest1);
 
   // Compare our file with prototype.
   hg::filesystem::path fileTest1 = dataDir / fileName1;
-  EXPECT_TRUE(hg::util::compareFiles(fileTest1, fileOutTest1));
+  hg::util::ImageCompareResult result1 =
+      hg::util::compareImageFiles(fileTest1, fileOutTest1,
+          hg::util::ImageCompareOptions::antialiasing(),
+          fileOutTest1.string() + ".diff.ppm");
+  EXPECT_TRUE(result1.mMatched) << result1;
 
   //////// Repeat tests for new text.
 
@@ -184,14 +191,53 @@ TEST(HgFontTest, HgFontTest)
   // Write our picture to file.
   std::string fileName2 = "HgFontTest_2.ppm";
   hg::filesystem::path fileOutTest2 = testDir / fileName2;
-  hg::util::writePpmFile(frameBuf.data(), frameWidth, frameHeight,
-      BYTES_PER_PIXEL, fileOutTest2.c_str());
+  hg::util::writeImageFile(frameBuf.data(), frameWidth, frameHeight, stride,
+      hg::util::PixelFormat::argb32, hg::util::ImageFileType::ppm,
+      fileOutTest2);
 
   // Compare our file with prototype.
   hg::filesystem::path fileTest2 = dataDir / fileName2;
-  EXPECT_TRUE(hg::util::compareFiles(fileTest2, fileOutTest2));
+  hg::util::ImageCompareResult result2 =
+      hg::util::compareImageFiles(fileTest2, fileOutTest2,
+          hg::util::ImageCompareOptions::antialiasing(),
+          fileOutTest2.string() + ".diff.ppm");
+  EXPECT_TRUE(result2.mMatched) << result2;
 
   //////// Test HgFont::xHeight().
 
   EXPECT_DOUBLE_EQ(hgFont.xHeight(), 8.0);
 }
+
+TEST(HgFontTest, textPositions)
+{
+  hg::HgFontLibrary hgFontLibrary;
+  std::string fontConfig = hg::util::readFile(fontDir / "fonts.conf");
+  ASSERT_TRUE(hgFontLibrary.parseAndLoadConfigFromMemory(fontConfig, true));
+  ASSERT_TRUE(hgFontLibrary.addFontDir(fontDir));
+
+  uint_least8_t result;
+  hg::filesystem::path filePath = hgFontLibrary.getFontFilePath(
+      "Tinos", 16, 400, litehtml::font_style::fontStyleNormal, &result);
+  hg::HgFont hgFont(hgFontLibrary.ftLibrary(), 1000);
+  ASSERT_TRUE(hgFont.createFtFace(filePath, 16));
+
+  std::string text = "Some text";
+  double width = hgFont.getTextExtents(text)->x_advance;
+
+  EXPECT_EQ(0u, hgFont.textOffsetAtX(text, -10));
+  EXPECT_EQ(0u, hgFont.textOffsetAtX(text, 0));
+  EXPECT_EQ(text.size(), hgFont.textOffsetAtX(text, width));
+  EXPECT_EQ(text.size(), hgFont.textOffsetAtX(text, width + 10));
+
+  EXPECT_DOUBLE_EQ(0, hgFont.xAtTextOffset(text, 0));
+  EXPECT_DOUBLE_EQ(width, hgFont.xAtTextOffset(text, text.size()));
+
+  // Every position maps back to its offset.
+  for(std::size_t offset = 0; offset <= text.size(); ++offset) {
+    double x = hgFont.xAtTextOffset(text, offset);
+    EXPECT_EQ(offset, hgFont.textOffsetAtX(text, x));
+    if(offset > 0) {
+      EXPECT_GT(x, hgFont.xAtTextOffset(text, offset - 1));
+    }
+  }
+}
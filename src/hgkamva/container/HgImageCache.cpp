@@ -0,0 +1,474 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/container/HgImageCache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "hgkamva/util/Filesystem.h"
+#include "hgkamva/util/MappedFile.h"
+#include "hgkamva/util/PngReader.h"
+
+namespace hg
+{
+namespace
+{
+const std::string FILE_SCHEME = "file://";
+
+// The owner of the ready callback running on the thread.
+thread_local const void* callingOwner = nullptr;
+
+std::string removeFileScheme(const std::string& url)
+{
+  if(url.compare(0, FILE_SCHEME.size(), FILE_SCHEME) == 0) {
+    return url.substr(FILE_SCHEME.size());
+  }
+  return url;
+}
+
+bool loadFile(const std::string& url, std::size_t maxBytes, std::string& data)
+{
+  util::MappedFile file(url);
+  if(!file.isOpen() || file.size() == 0) {
+    return false;
+  }
+  std::size_t size = file.size();
+  if(maxBytes > 0) {
+    size = std::min(size, maxBytes);
+  }
+  data.assign(reinterpret_cast<const char*>(file.data()), size);
+  return true;
+}
+
+HgCairo::SurfacePtr createSurface(int width, int height)
+{
+  cairo_surface_t* surface =
+      cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+  if(cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(surface);
+    return nullptr;
+  }
+  cairo_surface_flush(surface);
+  return HgCairo::SurfacePtr(surface, cairo_surface_destroy);
+}
+
+// The memory of the level decoding: the reduced image and the decoded rows,
+// all rows of the interlaced image.
+uint64_t decodeBytes(const util::PngReader::Header& header, int level)
+{
+  unsigned factor = 1u << level;
+  uint64_t rowBytes = static_cast<uint64_t>(header.mWidth) * 4;
+  uint64_t rows = header.mInterlaced ? header.mHeight : 1;
+  return rowBytes * (rows + 1)
+      + static_cast<uint64_t>(
+            util::BoxReducer::reducedSize(header.mWidth, factor))
+      * util::BoxReducer::reducedSize(header.mHeight, factor) * 4;
+}
+
+HgCairo::SurfacePtr decodePng(
+    const std::string& data, int level, int width, int height)
+{
+  unsigned factor = 1u << level;
+  HgCairo::SurfacePtr surface =
+      createSurface(util::BoxReducer::reducedSize(width, factor),
+          util::BoxReducer::reducedSize(height, factor));
+  if(!surface
+      || !util::PngReader::read(
+          reinterpret_cast<const unsigned char*>(data.data()), data.size(),
+          factor, cairo_image_surface_get_data(surface.get()),
+          cairo_image_surface_get_stride(surface.get()))) {
+    return nullptr;
+  }
+  cairo_surface_mark_dirty(surface.get());
+  return surface;
+}
+
+HgCairo::SurfacePtr reduceSurface(
+    const HgCairo::SurfacePtr& source, unsigned factor)
+{
+  int width = cairo_image_surface_get_width(source.get());
+  int height = cairo_image_surface_get_height(source.get());
+  HgCairo::SurfacePtr surface =
+      createSurface(util::BoxReducer::reducedSize(width, factor),
+          util::BoxReducer::reducedSize(height, factor));
+  if(!surface) {
+    return nullptr;
+  }
+  util::reduceImage(cairo_image_surface_get_data(source.get()), width, height,
+      cairo_image_surface_get_stride(source.get()), factor,
+      cairo_image_surface_get_data(surface.get()),
+      cairo_image_surface_get_stride(surface.get()));
+  cairo_surface_mark_dirty(surface.get());
+  return surface;
+}
+}  // namespace
+
+HgImageCache::HgImageCache(std::size_t byteBudget)
+    : mLoader(loadFile)
+    , mByteBudget(byteBudget)
+    , mDecodedBytes(0)
+    , mDecodingCount(0)
+    , mVersion(0)
+{
+}
+
+HgImageCache::~HgImageCache()
+{
+  waitDecoded();
+}
+
+void HgImageCache::setLoader(Loader loader)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mLoader = loader;
+}
+
+void HgImageCache::setReadyCallback(const void* owner, ReadyCallback callback)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  if(callback) {
+    mReadyCallbacks[owner] = callback;
+    return;
+  }
+  mReadyCallbacks.erase(owner);
+
+  // The callback removing itself does not wait for itself.
+  const std::size_t selfCount = callingOwner == owner ? 1 : 0;
+  mDecodedCondition.wait(lock, [this, owner, selfCount]() {
+    auto it = mCallingCounts.find(owner);
+    return it == mCallingCounts.end() || it->second <= selfCount;
+  });
+}
+
+void HgImageCache::setThreadPool(std::shared_ptr<util::ThreadPool> threadPool)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mThreadPool = threadPool;
+}
+
+void HgImageCache::setByteBudget(std::size_t byteBudget)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mByteBudget = byteBudget;
+  trim();
+}
+
+std::string HgImageCache::resolveUrl(
+    const std::string& src, const std::string& baseUrl)
+{
+  std::string path = removeFileScheme(src);
+  if(path.empty() || baseUrl.empty()
+      || hg::filesystem::path(path).is_absolute()) {
+    return path;
+  }
+  return (hg::filesystem::path(removeFileScheme(baseUrl)) / path).string();
+}
+
+int HgImageCache::mipLevel(
+    int width, int height, int drawWidth, int drawHeight)
+{
+  int level = 0;
+  if(drawWidth <= 0 || drawHeight <= 0) {
+    return level;
+  }
+  const int maxSize = std::max(width, height);
+  while(level < 30 && (2 << level) <= maxSize
+      && static_cast<int>(util::BoxReducer::reducedSize(width, 2u << level))
+          >= drawWidth
+      && static_cast<int>(util::BoxReducer::reducedSize(height, 2u << level))
+          >= drawHeight) {
+    ++level;
+  }
+  return level;
+}
+
+std::size_t HgImageCache::surfaceBytes(const HgCairo::SurfacePtr& surface)
+{
+  return static_cast<std::size_t>(
+             cairo_image_surface_get_stride(surface.get()))
+      * cairo_image_surface_get_height(surface.get());
+}
+
+void HgImageCache::load(const std::string& url, bool redrawOnReady)
+{
+  Loader loader;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(url);
+    if(it != mEntries.end()) {
+      Entry& entry = it->second;
+      entry.mRedrawOnReady = entry.mRedrawOnReady || redrawOnReady;
+      return;
+    }
+    mEntries[url].mRedrawOnReady = redrawOnReady;
+    loader = mLoader;
+  }
+
+  // The size is known for the layout after the return, the image
+  // is read by the decoding.
+  std::string data;
+  util::PngReader::Header header;
+  bool loaded = loader(url, util::PngReader::HEADER_SIZE, data)
+      && util::PngReader::readHeader(
+          reinterpret_cast<const unsigned char*>(data.data()), data.size(),
+          header);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  Entry& entry = mEntries[url];
+  // The damaged header of the huge size is not decoded.
+  if(!loaded
+      || decodeBytes(header,
+             mipLevel(static_cast<int>(header.mWidth),
+                 static_cast<int>(header.mHeight), 1, 1))
+          > mByteBudget) {
+    entry.mFailed = true;
+    return;
+  }
+  entry.mWidth = static_cast<int>(header.mWidth);
+  entry.mHeight = static_cast<int>(header.mHeight);
+  entry.mInterlaced = header.mInterlaced;
+}
+
+bool HgImageCache::getSize(const std::string& url, int& width, int& height)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto it = mEntries.find(url);
+  if(it == mEntries.end() || it->second.mWidth <= 0) {
+    return false;
+  }
+  width = it->second.mWidth;
+  height = it->second.mHeight;
+  return true;
+}
+
+HgCairo::SurfacePtr HgImageCache::getSurface(
+    const std::string& url, int drawWidth, int drawHeight)
+{
+  HgCairo::SurfacePtr surface;
+  std::shared_ptr<util::ThreadPool> threadPool;
+  int level;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(url);
+    if(it == mEntries.end() || it->second.mFailed
+        || it->second.mWidth <= 0) {
+      return nullptr;
+    }
+    Entry& entry = it->second;
+    level = mipLevel(entry.mWidth, entry.mHeight, drawWidth, drawHeight);
+    // The coarser level is decoded in the budget.
+    util::PngReader::Header header;
+    header.mWidth = static_cast<unsigned>(entry.mWidth);
+    header.mHeight = static_cast<unsigned>(entry.mHeight);
+    header.mInterlaced = entry.mInterlaced;
+    const int maxLevel = mipLevel(entry.mWidth, entry.mHeight, 1, 1);
+    while(level < maxLevel && decodeBytes(header, level) > mByteBudget) {
+      ++level;
+    }
+
+    if(!entry.mLevels.empty()) {
+      mLru.splice(mLru.begin(), mLru, entry.mLruPos);
+      // The nearest finer level is scaled down by the drawing,
+      // else the nearest coarser one is scaled up.
+      auto levelIt = entry.mLevels.lower_bound(level);
+      if(levelIt != entry.mLevels.end() && levelIt->first == level) {
+        return levelIt->second;
+      }
+      if(levelIt != entry.mLevels.begin()) {
+        --levelIt;
+      }
+      surface = levelIt->second;
+    }
+
+    if(!entry.mDecodingLevels.insert(level).second) {
+      return surface;
+    }
+    ++mDecodingCount;
+    if(!mThreadPool) {
+      mThreadPool = std::make_shared<util::ThreadPool>();
+    }
+    threadPool = mThreadPool;
+  }
+
+  threadPool->submit([this, url, level]() { decode(url, level); });
+  return surface;
+}
+
+HgCairo::SurfacePtr HgImageCache::getSurface(const std::string& url)
+{
+  return getSurface(url, 0, 0);
+}
+
+void HgImageCache::decode(const std::string& url, int level)
+{
+  HgCairo::SurfacePtr surface;
+  bool reduced = false;
+  try {
+    surface = decodeLevel(url, level, reduced);
+  } catch(...) {
+    // E.g. bad_alloc, the image is failed.
+    surface.reset();
+    reduced = false;
+  }
+
+  std::vector<std::pair<const void*, ReadyCallback>> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Entry& entry = mEntries[url];
+    entry.mDecodingLevels.erase(level);
+    if(surface) {
+      addLevel(url, entry, level, surface);
+      ++mVersion;
+      if(entry.mRedrawOnReady) {
+        for(const auto& ownerCallback : mReadyCallbacks) {
+          callbacks.push_back(ownerCallback);
+          ++mCallingCounts[ownerCallback.first];
+        }
+      }
+    } else if(!reduced) {
+      entry.mFailed = true;
+    }
+  }
+
+  for(const auto& ownerCallback : callbacks) {
+    const void* owner = ownerCallback.first;
+    callingOwner = owner;
+    try {
+      ownerCallback.second(url);
+    } catch(...) {
+      // The pool drops it anyway, the decoding is finished below.
+    }
+    callingOwner = nullptr;
+
+    // The owner removing its callback waits for it.
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mCallingCounts.find(owner);
+    if(--it->second == 0) {
+      mCallingCounts.erase(it);
+    }
+    mDecodedCondition.notify_all();
+  }
+
+  // The destructor may continue after the unlocking.
+  std::lock_guard<std::mutex> lock(mMutex);
+  --mDecodingCount;
+  mDecodedCondition.notify_all();
+}
+
+HgCairo::SurfacePtr HgImageCache::decodeLevel(
+    const std::string& url, int level, bool& reduced)
+{
+  int width;
+  int height;
+  int sourceLevel = 0;
+  HgCairo::SurfacePtr source;
+  Loader loader;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Entry& entry = mEntries[url];
+    width = entry.mWidth;
+    height = entry.mHeight;
+    // The nearest finer level is reduced without the decoding.
+    auto levelIt = entry.mLevels.lower_bound(level);
+    if(levelIt != entry.mLevels.begin()) {
+      --levelIt;
+      sourceLevel = levelIt->first;
+      source = levelIt->second;
+    } else {
+      loader = mLoader;
+    }
+  }
+
+  if(source) {
+    reduced = true;
+    return reduceSurface(source, 1u << (level - sourceLevel));
+  }
+  std::string data;
+  if(!loader(url, 0, data)) {
+    return nullptr;
+  }
+  return decodePng(data, level, width, height);
+}
+
+void HgImageCache::addLevel(const std::string& url,
+    Entry& entry,
+    int level,
+    HgCairo::SurfacePtr surface)
+{
+  if(entry.mLevels.empty()) {
+    mLru.push_front(url);
+    entry.mLruPos = mLru.begin();
+  } else {
+    mLru.splice(mLru.begin(), mLru, entry.mLruPos);
+  }
+
+  HgCairo::SurfacePtr& levelSurface = entry.mLevels[level];
+  if(levelSurface) {
+    mDecodedBytes -= surfaceBytes(levelSurface);
+  }
+  levelSurface = surface;
+  mDecodedBytes += surfaceBytes(surface);
+
+  // The level farthest from the new one is released.
+  while(entry.mLevels.size() > MAX_LEVELS) {
+    auto farthest = std::max_element(entry.mLevels.begin(),
+        entry.mLevels.end(), [level](const auto& first, const auto& second) {
+          return std::abs(first.first - level) < std::abs(second.first - level);
+        });
+    mDecodedBytes -= surfaceBytes(farthest->second);
+    entry.mLevels.erase(farthest);
+  }
+
+  trim();
+}
+
+void HgImageCache::trim()
+{
+  // The last image is kept even if it is over the budget alone.
+  while(mDecodedBytes > mByteBudget && mLru.size() > 1) {
+    Entry& entry = mEntries[mLru.back()];
+    for(const auto& levelSurface : entry.mLevels) {
+      mDecodedBytes -= surfaceBytes(levelSurface.second);
+    }
+    entry.mLevels.clear();
+    mLru.pop_back();
+  }
+}
+
+void HgImageCache::waitDecoded()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mDecodedCondition.wait(lock, [this]() { return mDecodingCount == 0; });
+}
+
+std::size_t HgImageCache::decodedBytes() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mDecodedBytes;
+}
+
+}  // namespace hg
@@ -0,0 +1,176 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_IMAGE_CACHE_H
+#define HG_IMAGE_CACHE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "hgkamva/container/HgCairo.h"
+#include "hgkamva/util/ThreadPool.h"
+
+namespace hg
+{
+class HgImageCache;
+
+using HgImageCachePtr = std::shared_ptr<HgImageCache>;
+
+// The images of the documents by URL. Only the PNG header is read
+// on the calling thread for the image size, so the layout does not wait
+// for the loading and the decoding. The pixels are decoded on the thread pool
+// at the drawn size: the mip level, the image reduced by the power of 2
+// with the box filter while the rows are decoded, so the memory follows
+// the drawn pixels and not the source ones. The coarser levels for the zoom
+// are reduced from the finer ones without the decoding.
+// The decoded images are kept up to the byte budget, the least recently
+// used ones are released first and decoded again on the next use.
+// The level is not decoded if its decoding memory is over the budget,
+// the image is failed if no level is in the budget.
+// All methods are thread-safe.
+class HgImageCache
+{
+public:
+  // Reads up to maxBytes of the encoded image of the URL, all of it
+  // if maxBytes is 0, returns false if it is not found. Is called
+  // for the header on the calling thread of load() and for the decoding
+  // on the pool threads. The default loader reads the local files.
+  using Loader = std::function<bool(
+      const std::string& url, std::size_t maxBytes, std::string& data)>;
+  // Is called on the pool thread when the image loaded with redrawOnReady
+  // is decoded. The callbacks of all owners sharing the cache are called.
+  using ReadyCallback = std::function<void(const std::string& url)>;
+
+  static constexpr std::size_t DEFAULT_BYTE_BUDGET = 64 << 20;
+  // The levels kept for one image.
+  static constexpr std::size_t MAX_LEVELS = 3;
+
+  explicit HgImageCache(std::size_t byteBudget = DEFAULT_BYTE_BUDGET);
+  // Waits for the started decodings.
+  ~HgImageCache();
+
+  HgImageCache(const HgImageCache&) = delete;
+  HgImageCache& operator=(const HgImageCache&) = delete;
+
+  void setLoader(Loader loader);
+  // The callback of the owner, e.g. of the container, the empty one
+  // is removed. The removal waits for the running callbacks of the owner,
+  // so the owner may be destroyed after it. The callback may remove itself.
+  void setReadyCallback(const void* owner, ReadyCallback callback);
+  // The pool is created on the first decoding if it is not set.
+  void setThreadPool(std::shared_ptr<util::ThreadPool> threadPool);
+  void setByteBudget(std::size_t byteBudget);
+
+  // The base URL is the directory of the document, the "file://" scheme
+  // is removed.
+  static std::string resolveUrl(
+      const std::string& src, const std::string& baseUrl);
+  // The coarsest level of the image size which is not smaller
+  // than the drawn size, 0 is the full size.
+  static int mipLevel(int width, int height, int drawWidth, int drawHeight);
+
+  // Reads the image size, the decoding is started by getSurface().
+  void load(const std::string& url, bool redrawOnReady);
+  // The intrinsic size, returns false if the image is not loaded.
+  bool getSize(const std::string& url, int& width, int& height);
+  // Returns the image for the drawing at the size in the device pixels,
+  // or nullptr if no level is decoded yet. If the level of the size
+  // is not decoded, its decoding is started and the nearest decoded level
+  // is returned meanwhile.
+  HgCairo::SurfacePtr getSurface(
+      const std::string& url, int drawWidth, int drawHeight);
+  // The full size image.
+  HgCairo::SurfacePtr getSurface(const std::string& url);
+  // Waits for the started decodings.
+  void waitDecoded();
+
+  // Is changed by every decoded image.
+  unsigned int version() const;
+  std::size_t decodedBytes() const;
+
+private:
+  struct Entry
+  {
+    bool mFailed = false;
+    int mWidth = 0;
+    int mHeight = 0;
+    bool mInterlaced = false;
+    bool mRedrawOnReady = false;
+    std::map<int, HgCairo::SurfacePtr> mLevels;
+    std::set<int> mDecodingLevels;
+    // Is valid if the levels are not empty.
+    std::list<std::string>::iterator mLruPos;
+  };
+
+  static std::size_t surfaceBytes(const HgCairo::SurfacePtr& surface);
+
+  // The decoding is finished if decodeLevel() or the callback throws,
+  // else the waiting for it never ends.
+  void decode(const std::string& url, int level);
+  // Returns nullptr if the level is not decoded, reduced is true
+  // if it is reduced from the decoded level.
+  HgCairo::SurfacePtr decodeLevel(
+      const std::string& url, int level, bool& reduced);
+  // Adds the decoded level, the mutex is locked.
+  void addLevel(const std::string& url,
+      Entry& entry,
+      int level,
+      HgCairo::SurfacePtr surface);
+  // Releases the least recently used images over the budget,
+  // the mutex is locked.
+  void trim();
+
+  mutable std::mutex mMutex;
+  // Is notified by the finished decodings and callbacks.
+  std::condition_variable mDecodedCondition;
+  Loader mLoader;
+  std::map<const void*, ReadyCallback> mReadyCallbacks;
+  // The running callbacks by the owner.
+  std::map<const void*, std::size_t> mCallingCounts;
+  std::shared_ptr<util::ThreadPool> mThreadPool;
+  std::size_t mByteBudget;
+  std::size_t mDecodedBytes;
+  std::size_t mDecodingCount;
+  std::atomic<unsigned int> mVersion;
+
+  std::map<std::string, Entry> mEntries;
+  // The images with the decoded levels, the most recently used first.
+  std::list<std::string> mLru;
+};  // class HgImageCache
+
+inline unsigned int HgImageCache::version() const
+{
+  return mVersion;
+}
+
+}  // namespace hg
+
+#endif  // HG_IMAGE_CACHE_H
@@ -0,0 +1,317 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/container/HgImageCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "hgkamva/util/FileUtil.h"
+#include "hgkamva/util/Filesystem.h"
+
+namespace
+{
+// The opaque image of the color.
+std::string writeImage(const std::string& fileName,
+    int width,
+    int height,
+    uint32_t color = 0xFF336699)
+{
+  std::vector<uint32_t> pixels(width * height, color);
+  hg::filesystem::path path = hg::filesystem::temp_directory_path() / fileName;
+  hg::util::writePngFile(reinterpret_cast<const unsigned char*>(pixels.data()),
+      width, height, width * 4, true, path);
+  return path.string();
+}
+
+uint32_t getPixel(const hg::HgCairo::SurfacePtr& surface, int x, int y)
+{
+  const unsigned char* data = cairo_image_surface_get_data(surface.get());
+  int stride = cairo_image_surface_get_stride(surface.get());
+  uint32_t pixel;
+  std::memcpy(&pixel, data + y * stride + x * 4, 4);
+  return pixel;
+}
+}  // namespace
+
+TEST(HgImageCacheTest, resolveUrl)
+{
+  EXPECT_EQ("a.png", hg::HgImageCache::resolveUrl("a.png", ""));
+  EXPECT_EQ((hg::filesystem::path("dir") / "a.png").string(),
+      hg::HgImageCache::resolveUrl("a.png", "file://dir"));
+  std::string absolute =
+      (hg::filesystem::temp_directory_path() / "a.png").string();
+  EXPECT_EQ(absolute, hg::HgImageCache::resolveUrl(absolute, "dir"));
+  EXPECT_EQ(absolute, hg::HgImageCache::resolveUrl("file://" + absolute, ""));
+}
+
+TEST(HgImageCacheTest, mipLevel)
+{
+  EXPECT_EQ(0, hg::HgImageCache::mipLevel(16, 8, 0, 0));
+  EXPECT_EQ(0, hg::HgImageCache::mipLevel(16, 8, 16, 8));
+  EXPECT_EQ(0, hg::HgImageCache::mipLevel(16, 8, 20, 4));
+  EXPECT_EQ(1, hg::HgImageCache::mipLevel(16, 8, 8, 4));
+  EXPECT_EQ(1, hg::HgImageCache::mipLevel(16, 8, 5, 3));
+  EXPECT_EQ(4, hg::HgImageCache::mipLevel(16, 8, 1, 1));
+  EXPECT_EQ(3, hg::HgImageCache::mipLevel(100, 1, 10, 1));
+}
+
+TEST(HgImageCacheTest, load)
+{
+  std::string url = writeImage("HgImageCache_1.png", 5, 3);
+
+  hg::HgImageCache cache;
+  std::atomic<int> readyCount(0);
+  cache.setReadyCallback(
+      &readyCount, [&readyCount](const std::string&) { ++readyCount; });
+  unsigned int version = cache.version();
+
+  // The size is known before the decoding.
+  cache.load(url, true);
+  int width = 0;
+  int height = 0;
+  EXPECT_TRUE(cache.getSize(url, width, height));
+  EXPECT_EQ(5, width);
+  EXPECT_EQ(3, height);
+  EXPECT_EQ(0u, cache.decodedBytes());
+
+  // The decoding is started by the drawing.
+  EXPECT_FALSE(cache.getSurface(url));
+  cache.waitDecoded();
+  EXPECT_EQ(1, readyCount);
+  EXPECT_NE(version, cache.version());
+  hg::HgCairo::SurfacePtr surface = cache.getSurface(url);
+  ASSERT_TRUE(surface);
+  EXPECT_EQ(5, cairo_image_surface_get_width(surface.get()));
+  EXPECT_EQ(0xFF336699, getPixel(surface, 4, 2));
+  EXPECT_EQ(
+      static_cast<std::size_t>(cairo_image_surface_get_stride(surface.get()))
+          * 3,
+      cache.decodedBytes());
+
+  // The decoded image is not loaded again.
+  cache.load(url, true);
+  EXPECT_TRUE(cache.getSurface(url));
+  cache.waitDecoded();
+  EXPECT_EQ(1, readyCount);
+
+  // The missing and the not PNG files.
+  std::string missing =
+      (hg::filesystem::temp_directory_path() / "HgImageCache_no.png").string();
+  cache.load(missing, true);
+  EXPECT_FALSE(cache.getSize(missing, width, height));
+  EXPECT_FALSE(cache.getSurface(missing));
+  cache.waitDecoded();
+  EXPECT_EQ(1, readyCount);
+}
+
+TEST(HgImageCacheTest, levels)
+{
+  std::string url = writeImage("HgImageCache_4.png", 16, 8);
+
+  hg::HgImageCache cache;
+  cache.load(url, false);
+
+  // The image is decoded at the drawn size.
+  EXPECT_FALSE(cache.getSurface(url, 8, 4));
+  cache.waitDecoded();
+  hg::HgCairo::SurfacePtr surface = cache.getSurface(url, 8, 4);
+  ASSERT_TRUE(surface);
+  EXPECT_EQ(8, cairo_image_surface_get_width(surface.get()));
+  EXPECT_EQ(4, cairo_image_surface_get_height(surface.get()));
+  EXPECT_EQ(0xFF336699, getPixel(surface, 7, 3));
+  EXPECT_EQ(128u, cache.decodedBytes());
+
+  // The nearest level is drawn while the drawn size is decoded.
+  EXPECT_EQ(surface, cache.getSurface(url, 4, 2));
+  cache.waitDecoded();
+  hg::HgCairo::SurfacePtr reduced = cache.getSurface(url, 4, 2);
+  ASSERT_TRUE(reduced);
+  EXPECT_EQ(4, cairo_image_surface_get_width(reduced.get()));
+  EXPECT_EQ(0xFF336699, getPixel(reduced, 3, 1));
+  EXPECT_EQ(surface, cache.getSurface(url, 16, 8));
+  cache.waitDecoded();
+  hg::HgCairo::SurfacePtr full = cache.getSurface(url, 16, 8);
+  ASSERT_TRUE(full);
+  EXPECT_EQ(16, cairo_image_surface_get_width(full.get()));
+  EXPECT_EQ(512u + 128u + 32u, cache.decodedBytes());
+
+  // The level farthest from the new one is released.
+  EXPECT_EQ(reduced, cache.getSurface(url, 2, 1));
+  cache.waitDecoded();
+  EXPECT_EQ(128u + 32u + 8u, cache.decodedBytes());
+  EXPECT_EQ(surface, cache.getSurface(url, 16, 8));
+  cache.waitDecoded();
+}
+
+TEST(HgImageCacheTest, byteBudget)
+{
+  std::string url1 = writeImage("HgImageCache_2.png", 4, 4);
+  std::string url2 = writeImage("HgImageCache_3.png", 4, 4, 0xFF000000);
+
+  int headerCount = 0;
+  int loadCount = 0;
+  hg::HgImageCache cache(100);
+  cache.setLoader([&](const std::string& url, std::size_t maxBytes,
+                      std::string& data) {
+    ++(maxBytes > 0 ? headerCount : loadCount);
+    data = hg::util::readFile(url);
+    if(maxBytes > 0 && data.size() > maxBytes) {
+      data.resize(maxBytes);
+    }
+    return !data.empty();
+  });
+
+  // Only the header is read for the size, the decoding reads the image.
+  cache.load(url1, false);
+  cache.load(url2, false);
+  EXPECT_EQ(2, headerCount);
+  EXPECT_EQ(0, loadCount);
+  EXPECT_FALSE(cache.getSurface(url1));
+  cache.waitDecoded();
+  EXPECT_FALSE(cache.getSurface(url2));
+  cache.waitDecoded();
+  EXPECT_EQ(2, loadCount);
+  EXPECT_EQ(64u, cache.decodedBytes());
+
+  // The least recently used image is released and loaded again.
+  EXPECT_TRUE(cache.getSurface(url2));
+  EXPECT_FALSE(cache.getSurface(url1));
+  cache.waitDecoded();
+  EXPECT_EQ(3, loadCount);
+  EXPECT_TRUE(cache.getSurface(url1));
+  EXPECT_FALSE(cache.getSurface(url2));
+  cache.waitDecoded();
+  EXPECT_EQ(4, loadCount);
+  EXPECT_EQ(2, headerCount);
+
+  // The size is kept for the released image.
+  int width = 0;
+  int height = 0;
+  EXPECT_TRUE(cache.getSize(url1, width, height));
+  EXPECT_EQ(4, width);
+
+  cache.setByteBudget(1000);
+  EXPECT_FALSE(cache.getSurface(url1));
+  cache.waitDecoded();
+  EXPECT_TRUE(cache.getSurface(url1));
+  EXPECT_TRUE(cache.getSurface(url2));
+  EXPECT_EQ(128u, cache.decodedBytes());
+}
+
+TEST(HgImageCacheTest, decodeBudget)
+{
+  std::string url = writeImage("HgImageCache_4.png", 64, 64);
+
+  // The full size decoding is over the budget, the next level is decoded.
+  hg::HgImageCache cache(5000);
+  cache.load(url, false);
+  EXPECT_FALSE(cache.getSurface(url));
+  cache.waitDecoded();
+  hg::HgCairo::SurfacePtr surface = cache.getSurface(url);
+  ASSERT_TRUE(surface);
+  EXPECT_EQ(32, cairo_image_surface_get_width(surface.get()));
+
+  // The damaged header of the huge interlaced image.
+  std::string hugeUrl = "huge.png";
+  cache.setLoader([&url](const std::string&, std::size_t, std::string& data) {
+    data = hg::util::readFile(url);
+    const char size[] = {0x7F, -1, -1, -1};
+    data.replace(16, 4, size, 4);
+    data.replace(20, 4, size, 4);
+    data[28] = 1;
+    return true;
+  });
+  cache.load(hugeUrl, false);
+  int width = 0;
+  int height = 0;
+  EXPECT_FALSE(cache.getSize(hugeUrl, width, height));
+  EXPECT_FALSE(cache.getSurface(hugeUrl));
+  cache.waitDecoded();
+}
+
+TEST(HgImageCacheTest, throwingCallback)
+{
+  std::string url = writeImage("HgImageCache_5.png", 4, 4);
+
+  hg::HgImageCache cache;
+  cache.setReadyCallback(&cache,
+      [](const std::string&) { throw std::runtime_error("callback"); });
+  cache.load(url, true);
+  EXPECT_FALSE(cache.getSurface(url));
+  // The decoding is finished anyway.
+  cache.waitDecoded();
+  EXPECT_TRUE(cache.getSurface(url));
+}
+
+TEST(HgImageCacheTest, removeCallback)
+{
+  std::string url = writeImage("HgImageCache_6.png", 4, 4);
+  std::string url2 = writeImage("HgImageCache_7.png", 4, 4);
+
+  hg::HgImageCache cache;
+  std::promise<void> started;
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::atomic<bool> finished(false);
+  cache.setReadyCallback(&cache, [&](const std::string&) {
+    started.set_value();
+    released.wait();
+    finished = true;
+  });
+  cache.load(url, true);
+  EXPECT_FALSE(cache.getSurface(url));
+  started.get_future().wait();
+
+  // The removal waits for the running callback.
+  bool removedAfterCallback = false;
+  std::thread remover([&]() {
+    cache.setReadyCallback(&cache, nullptr);
+    removedAfterCallback = finished;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  release.set_value();
+  remover.join();
+  EXPECT_TRUE(removedAfterCallback);
+  cache.waitDecoded();
+
+  // The callback removing itself does not wait for itself.
+  int readyCount = 0;
+  cache.setReadyCallback(&readyCount, [&](const std::string&) {
+    ++readyCount;
+    cache.setReadyCallback(&readyCount, nullptr);
+  });
+  cache.load(url2, true);
+  EXPECT_FALSE(cache.getSurface(url2));
+  cache.waitDecoded();
+  EXPECT_EQ(1, readyCount);
+}
@@ -23,20 +23,32 @@
 
 #include "hgkamva/hg_kamva_api.h"
 
+#include <algorithm>
 #include <cassert>
 #include <memory>
+#include <vector>
 
 #include <cairo/cairo.h>
 
 #include "litehtml.h"
 
 #include "hgkamva/container/HgContainer.h"
+#include "hgkamva/container/HgEngine.h"
+#include "hgkamva/renderer/HgHtmlPager.h"
 #include "hgkamva/renderer/HgHtmlRenderer.h"
+#include "hgkamva/renderer/HgHtmlView.h"
 
 using namespace hg;
 
 // Internal functions.
 
+inline HgEnginePtr& getHgEngine(HgHtmlEnginePtr engine)
+{
+  HgEnginePtr* hgEngine = static_cast<HgEnginePtr*>(engine);
+  assert(hgEngine && *hgEngine);
+  return *hgEngine;
+}
+
 inline HgHtmlRenderer* getHgHtmlRenderer(HgHtmlRendererPtr renderer)
 {
   HgHtmlRenderer* hgRenderer = static_cast<HgHtmlRenderer*>(renderer);
@@ -44,6 +56,37 @@ inline HgHtmlRenderer* getHgHtmlRenderer(HgHtmlRendererPtr renderer)
   return hgRenderer;
 }
 
+inline HgHtmlView* getHgHtmlView(HgViewPtr view)
+{
+  HgHtmlView* hgView = static_cast<HgHtmlView*>(view);
+  assert(hgView);
+  return hgView;
+}
+
+inline HgHtmlPager* getHgHtmlPager(HgPagerPtr pager)
+{
+  HgHtmlPager* hgPager = static_cast<HgHtmlPager*>(pager);
+  assert(hgPager);
+  return hgPager;
+}
+
+inline litehtml::element::ptr getElement(void* element)
+{
+  litehtml::element* htmlElement = static_cast<litehtml::element*>(element);
+  assert(htmlElement);
+  return htmlElement->shared_from_this();
+}
+
+inline void setHgRect(const litehtml::position& pos, HgRect* rect)
+{
+  if(rect) {
+    rect->x = pos.x;
+    rect->y = pos.y;
+    rect->width = pos.width;
+    rect->height = pos.height;
+  }
+}
+
 inline std::shared_ptr<HgContainer> getHgContainer(HgHtmlRendererPtr renderer)
 {
   return getHgHtmlRenderer(renderer)->getHgContainer();
@@ -68,6 +111,45 @@ int hgColorFormatToBitsPerPixel(hgColorFormat format)
   return HgCairo::formatBitsPerPixel(static_cast<cairo_format_t>(format));
 }
 
+// HgEngine methods.
+
+HgHtmlEnginePtr hgNewEngine()
+{
+  return new HgEnginePtr(std::make_shared<HgEngine>());
+}
+
+void hgDeleteEngine(HgHtmlEnginePtr engine)
+{
+  delete static_cast<HgEnginePtr*>(engine);
+}
+
+HgBool hgEngine_parseAndLoadFontConfigFromMemory(
+    HgHtmlEnginePtr engine, const char* fontConfig, HgBool complain)
+{
+  return getHgEngine(engine)->parseAndLoadFontConfigFromMemory(
+      fontConfig, complain);
+}
+
+HgBool hgEngine_addFontDir(HgHtmlEnginePtr engine, const char* dirPath)
+{
+  return getHgEngine(engine)->addFontDir(dirPath);
+}
+
+void hgEngine_setFontTextCacheSize(HgHtmlEnginePtr engine, int size)
+{
+  getHgEngine(engine)->setFontTextCacheSize(size);
+}
+
+void hgEngine_loadMasterStylesheet(HgHtmlEnginePtr engine, const char* str)
+{
+  getHgEngine(engine)->loadMasterStylesheet(str);
+}
+
+void hgEngine_releaseUnusedFonts(HgHtmlEnginePtr engine)
+{
+  getHgEngine(engine)->releaseUnusedFonts();
+}
+
 // HgHtmlRenderer methods.
 
 HgHtmlRendererPtr hgNewHtmlRenderer()
@@ -75,6 +157,11 @@ HgHtmlRendererPtr hgNewHtmlRenderer()
   return new HgHtmlRenderer();
 }
 
+HgHtmlRendererPtr hgNewHtmlRendererWithEngine(HgHtmlEnginePtr engine)
+{
+  return new HgHtmlRenderer(getHgEngine(engine));
+}
+
 void hgDeleteHtmlRenderer(HgHtmlRendererPtr renderer)
 {
   delete getHgHtmlRenderer(renderer);
@@ -86,6 +173,18 @@ void hgHtmlRenderer_createHtmlDocumentFromUtf8(
   return getHgHtmlRenderer(renderer)->createHtmlDocumentFromUtf8(htmlText);
 }
 
+void hgHtmlRenderer_createHtmlDocumentFromUtf8Length(
+    HgHtmlRendererPtr renderer, const char* htmlText, size_t length)
+{
+  getHgHtmlRenderer(renderer)->createHtmlDocumentFromUtf8(htmlText, length);
+}
+
+HgBool hgHtmlRenderer_createHtmlDocumentFromFile(
+    HgHtmlRendererPtr renderer, const char* filePath)
+{
+  return getHgHtmlRenderer(renderer)->createHtmlDocumentFromFile(filePath);
+}
+
 int hgHtmlRenderer_renderHtml(HgHtmlRendererPtr renderer, int width, int height)
 {
   return getHgHtmlRenderer(renderer)->renderHtml(width, height);
@@ -115,6 +214,306 @@ void hgHtmlRenderer_setBackgroundColor(HgHtmlRendererPtr renderer,
       litehtml::web_color(red, green, blue, alpha));
 }
 
+void hgHtmlRenderer_setImageReadyCallback(
+    HgHtmlRendererPtr renderer, HgImageReadyCallback callback, void* userData)
+{
+  HgImageCache::ReadyCallback readyCallback;
+  if(callback) {
+    readyCallback = [callback, userData](const std::string&) {
+      callback(userData);
+    };
+  }
+  getHgContainer(renderer)->setImageReadyCallback(readyCallback);
+}
+
+void hgHtmlRenderer_setImageCacheBudget(
+    HgHtmlRendererPtr renderer, size_t byteBudget)
+{
+  getHgContainer(renderer)->getImageCache()->setByteBudget(byteBudget);
+}
+
+void hgHtmlRenderer_setOverscanMargin(HgHtmlRendererPtr renderer, int margin)
+{
+  return getHgHtmlRenderer(renderer)->setOverscanMargin(margin);
+}
+
+HgBool hgHtmlRenderer_prerenderOverscan(HgHtmlRendererPtr renderer)
+{
+  return getHgHtmlRenderer(renderer)->prerenderOverscan();
+}
+
+void hgHtmlRenderer_setOverlay(HgHtmlRendererPtr renderer,
+    hgOverlayLayer layer,
+    const HgRect* rects,
+    int rectCount,
+    HgByte red,
+    HgByte green,
+    HgByte blue,
+    HgByte alpha)
+{
+  std::vector<litehtml::position> positions;
+  for(int i = 0; i < rectCount; ++i) {
+    positions.emplace_back(
+        rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+  }
+  getHgHtmlRenderer(renderer)->setOverlay(
+      static_cast<HgHtmlRenderer::OverlayLayer>(layer), positions,
+      litehtml::web_color(red, green, blue, alpha));
+}
+
+void hgHtmlRenderer_setOverlayVisible(
+    HgHtmlRendererPtr renderer, hgOverlayLayer layer, HgBool visible)
+{
+  getHgHtmlRenderer(renderer)->setOverlayVisible(
+      static_cast<HgHtmlRenderer::OverlayLayer>(layer), visible);
+}
+
+void hgHtmlRenderer_setZoom(
+    HgHtmlRendererPtr renderer, double zoom, HgBool textZoom)
+{
+  getHgHtmlRenderer(renderer)->setZoom(zoom, textZoom);
+}
+
+void hgHtmlRenderer_setZoomPreview(
+    HgHtmlRendererPtr renderer, double zoom, int focusX, int focusY)
+{
+  getHgHtmlRenderer(renderer)->setZoomPreview(zoom, focusX, focusY);
+}
+
+void hgHtmlRenderer_endZoomPreview(
+    HgHtmlRendererPtr renderer, HgBool textZoom, int* htmlX, int* htmlY)
+{
+  assert(htmlX && htmlY);
+  getHgHtmlRenderer(renderer)->endZoomPreview(textZoom, *htmlX, *htmlY);
+}
+
+HgBool hgHtmlRenderer_hitTest(
+    HgHtmlRendererPtr renderer, int x, int y, HgHitTestResult* result)
+{
+  assert(result);
+  HgHtmlRenderer* hgRenderer = getHgHtmlRenderer(renderer);
+  HgTextIndex::HitTestResult hitTest;
+  if(!hgRenderer->hitTest(x, y, hitTest)) {
+    return false;
+  }
+
+  const HgTextIndex& textIndex = hgRenderer->getDocument()->textIndex();
+  result->element = textIndex.runs()[hitTest.mRunIndex].mElement.get();
+  result->runIndex = static_cast<int>(hitTest.mRunIndex);
+  result->charOffset = static_cast<int>(hitTest.mCharOffset);
+  result->textOffset = static_cast<int>(hitTest.mTextOffset);
+  result->caretX = hitTest.mCaret.x;
+  result->caretY = hitTest.mCaret.y;
+  result->caretHeight = hitTest.mCaret.height;
+  return true;
+}
+
+int hgHtmlRenderer_findAll(HgHtmlRendererPtr renderer,
+    const char* query,
+    HgBool caseSensitive,
+    HgTextMatch* matches,
+    int maxMatches)
+{
+  if(maxMatches <= 0) {
+    return 0;
+  }
+  HgTextIndex::TextMatchVector found = getHgHtmlRenderer(renderer)->findAll(
+      query, caseSensitive, static_cast<std::size_t>(maxMatches));
+  if(matches) {
+    for(std::size_t i = 0; i < found.size(); ++i) {
+      // The match has at least one rect.
+      const std::vector<litehtml::position>& rects = found[i].mRects;
+      int left = rects.front().left();
+      int top = rects.front().top();
+      int right = rects.front().right();
+      int bottom = rects.front().bottom();
+      for(const auto& rect : rects) {
+        left = std::min(left, rect.left());
+        top = std::min(top, rect.top());
+        right = std::max(right, rect.right());
+        bottom = std::max(bottom, rect.bottom());
+      }
+      litehtml::position bounds(left, top, right - left, bottom - top);
+      matches[i].textOffset = static_cast<int>(found[i].mTextOffset);
+      matches[i].length = static_cast<int>(found[i].mLength);
+      setHgRect(bounds, &matches[i].bounds);
+    }
+  }
+  return static_cast<int>(found.size());
+}
+
+int hgHtmlRenderer_highlightText(HgHtmlRendererPtr renderer,
+    const char* query,
+    HgBool caseSensitive,
+    HgByte red,
+    HgByte green,
+    HgByte blue,
+    HgByte alpha)
+{
+  HgHtmlRenderer* hgRenderer = getHgHtmlRenderer(renderer);
+  HgTextIndex::TextMatchVector found =
+      hgRenderer->findAll(query, caseSensitive);
+  hgRenderer->highlightMatches(
+      found, litehtml::web_color(red, green, blue, alpha));
+  return static_cast<int>(found.size());
+}
+
+void hgHtmlRenderer_setText(HgHtmlRendererPtr renderer,
+    void* element,
+    const char* text,
+    HgRect* damage)
+{
+  setHgRect(
+      getHgHtmlRenderer(renderer)->setText(getElement(element), text), damage);
+}
+
+void hgHtmlRenderer_insertText(HgHtmlRendererPtr renderer,
+    void* textElement,
+    int charOffset,
+    const char* text,
+    HgRect* damage)
+{
+  setHgRect(getHgHtmlRenderer(renderer)->insertText(
+                getElement(textElement), charOffset, text),
+      damage);
+}
+
+void hgHtmlRenderer_deleteText(HgHtmlRendererPtr renderer,
+    void* textElement,
+    int charOffset,
+    int length,
+    HgRect* damage)
+{
+  setHgRect(getHgHtmlRenderer(renderer)->deleteText(
+                getElement(textElement), charOffset, length),
+      damage);
+}
+
+void hgHtmlRenderer_removeElement(
+    HgHtmlRendererPtr renderer, void* element, HgRect* damage)
+{
+  setHgRect(
+      getHgHtmlRenderer(renderer)->removeElement(getElement(element)), damage);
+}
+
+void hgHtmlRenderer_setAttribute(HgHtmlRendererPtr renderer,
+    void* element,
+    const char* name,
+    const char* value,
+    HgRect* damage)
+{
+  setHgRect(getHgHtmlRenderer(renderer)->setAttribute(
+                getElement(element), name, value),
+      damage);
+}
+
+
+// HgHtmlView methods.
+
+HgViewPtr hgNewHtmlView(HgHtmlRendererPtr renderer)
+{
+  return new HgHtmlView(getHgHtmlRenderer(renderer)->getDocument());
+}
+
+void hgDeleteHtmlView(HgViewPtr view)
+{
+  delete getHgHtmlView(view);
+}
+
+void hgHtmlView_drawHtml(HgViewPtr view,
+    unsigned char* buffer,
+    const hgColorFormat colorFormat,
+    const int width,
+    const int height,
+    const int stride,
+    const int htmlX,
+    const int htmlY)
+{
+  return getHgHtmlView(view)->drawHtml(buffer,
+      static_cast<cairo_format_t>(colorFormat), width, height, stride, htmlX,
+      htmlY);
+}
+
+void hgHtmlView_setBackgroundColor(
+    HgViewPtr view, HgByte red, HgByte green, HgByte blue, HgByte alpha)
+{
+  return getHgHtmlView(view)->setBackgroundColor(
+      litehtml::web_color(red, green, blue, alpha));
+}
+
+void hgHtmlView_setOverscanMargin(HgViewPtr view, int margin)
+{
+  return getHgHtmlView(view)->setOverscanMargin(margin);
+}
+
+HgBool hgHtmlView_prerenderOverscan(HgViewPtr view)
+{
+  return getHgHtmlView(view)->prerenderOverscan();
+}
+
+int hgHtmlRenderer_exportPdf(HgHtmlRendererPtr renderer,
+    const char* filePath,
+    int pageWidth,
+    int pageHeight,
+    HgBool fullLength)
+{
+  std::shared_ptr<HgHtmlExporter> exporter =
+      getHgHtmlRenderer(renderer)->newExporter();
+  exporter->setPageSize(pageWidth, pageHeight);
+  exporter->setFullLength(fullLength);
+  return exporter->exportPdf(filePath) ? exporter->pageCount() : -1;
+}
+
+int hgHtmlRenderer_exportPng(HgHtmlRendererPtr renderer,
+    const char* filePrefix,
+    int pageWidth,
+    int pageHeight,
+    HgBool fullLength)
+{
+  std::shared_ptr<HgHtmlExporter> exporter =
+      getHgHtmlRenderer(renderer)->newExporter();
+  exporter->setPageSize(pageWidth, pageHeight);
+  exporter->setFullLength(fullLength);
+  return exporter->exportPng(filePrefix) ? exporter->pageCount() : -1;
+}
+
+HgPagerPtr hgNewHtmlPager(HgHtmlRendererPtr renderer)
+{
+  return new HgHtmlPager(getHgHtmlRenderer(renderer)->getDocument());
+}
+
+void hgDeleteHtmlPager(HgPagerPtr pager)
+{
+  delete getHgHtmlPager(pager);
+}
+
+void hgHtmlPager_paginate(HgPagerPtr pager, int pageWidth, int pageHeight)
+{
+  getHgHtmlPager(pager)->paginate(pageWidth, pageHeight);
+}
+
+int hgHtmlPager_pageCount(HgPagerPtr pager)
+{
+  return getHgHtmlPager(pager)->pageCount();
+}
+
+HgBool hgHtmlPager_isPaginated(HgPagerPtr pager)
+{
+  return getHgHtmlPager(pager)->isPaginated();
+}
+
+HgBool hgHtmlPager_drawPage(HgPagerPtr pager,
+    int page,
+    unsigned char* buffer,
+    const hgColorFormat colorFormat,
+    const int width,
+    const int height,
+    const int stride)
+{
+  return getHgHtmlPager(pager)->drawPage(page, buffer,
+      static_cast<cairo_format_t>(colorFormat), width, height, stride);
+}
+
 
 // HgContainer methods.
 
@@ -24,21 +24,80 @@
 #ifndef HG_KAMVA_API_H
 #define HG_KAMVA_API_H
 
+#include <stddef.h>
+
 #include "hgkamva/hg_kamva_codes.h"
 #include "hgkamva/hg_kamva_common.h"
 
+typedef void* HgHtmlEnginePtr;
 typedef void* HgHtmlRendererPtr;
+typedef void* HgViewPtr;
+typedef void* HgPagerPtr;
 typedef unsigned char HgBool;
 typedef unsigned char HgByte;
+typedef void (*HgImageReadyCallback)(void* userData);
+
+typedef struct
+{
+  int x;
+  int y;
+  int width;
+  int height;
+} HgRect;
+
+/* The text position found by the hit-test. */
+typedef struct
+{
+  void* element; /* The text element of litehtml. */
+  int runIndex; /* The text run in the document order. */
+  int charOffset; /* In characters from the run start. */
+  int textOffset; /* In characters from the document text start. */
+  /* The caret line in the document coordinates. */
+  int caretX;
+  int caretY;
+  int caretHeight;
+} HgHitTestResult;
+
+/* The text match found by the search. */
+typedef struct
+{
+  int textOffset; /* In characters from the document text start. */
+  int length; /* In characters. */
+  /* The bounding rect of the match in the document coordinates. */
+  HgRect bounds;
+} HgTextMatch;
 
 HG_KAMVA_EXTERNC int hgColorFormatToBitsPerPixel(hgColorFormat pixFmtId);
 
+/* The engine shares the fonts, the font configuration and the master CSS
+   between the renderers, it is kept alive by the renderers created with it
+   and may be deleted before them. */
+HG_KAMVA_EXTERNC HgHtmlEnginePtr hgNewEngine();
+HG_KAMVA_EXTERNC void hgDeleteEngine(HgHtmlEnginePtr engine);
+HG_KAMVA_EXTERNC HgBool hgEngine_parseAndLoadFontConfigFromMemory(
+    HgHtmlEnginePtr engine, const char* fontConfig, HgBool complain);
+HG_KAMVA_EXTERNC HgBool hgEngine_addFontDir(
+    HgHtmlEnginePtr engine, const char* dirPath);
+HG_KAMVA_EXTERNC void hgEngine_setFontTextCacheSize(
+    HgHtmlEnginePtr engine, int size);
+HG_KAMVA_EXTERNC void hgEngine_loadMasterStylesheet(
+    HgHtmlEnginePtr engine, const char* str);
+HG_KAMVA_EXTERNC void hgEngine_releaseUnusedFonts(HgHtmlEnginePtr engine);
+
 HG_KAMVA_EXTERNC HgHtmlRendererPtr hgNewHtmlRenderer();
+HG_KAMVA_EXTERNC HgHtmlRendererPtr hgNewHtmlRendererWithEngine(
+    HgHtmlEnginePtr engine);
 
 HG_KAMVA_EXTERNC void hgDeleteHtmlRenderer(HgHtmlRendererPtr renderer);
 
 HG_KAMVA_EXTERNC void hgHtmlRenderer_createHtmlDocumentFromUtf8(
     HgHtmlRendererPtr renderer, const char* htmlText);
+/* The text of the length is not required to be null terminated. */
+HG_KAMVA_EXTERNC void hgHtmlRenderer_createHtmlDocumentFromUtf8Length(
+    HgHtmlRendererPtr renderer, const char* htmlText, size_t length);
+/* The file is mapped to the memory and parsed without the copy. */
+HG_KAMVA_EXTERNC HgBool hgHtmlRenderer_createHtmlDocumentFromFile(
+    HgHtmlRendererPtr renderer, const char* filePath);
 HG_KAMVA_EXTERNC int hgHtmlRenderer_renderHtml(
     HgHtmlRendererPtr renderer, int width, int height);
 HG_KAMVA_EXTERNC void hgHtmlRenderer_drawHtml(HgHtmlRendererPtr renderer,
@@ -55,11 +114,152 @@ HG_KAMVA_EXTERNC void hgHtmlRenderer_setBackgroundColor(
     HgByte green,
     HgByte blue,
     HgByte alpha = 255);
+/* The images are decoded on the background threads. The callback is called
+   on those threads when a decoded image needs the redraw, the next
+   drawHtml() draws it. The decoded images are kept up to the byte budget.
+   The image cache is shared by the renderers of the engine, the callback
+   is called for the images of any of them and the budget is for all. */
+HG_KAMVA_EXTERNC void hgHtmlRenderer_setImageReadyCallback(
+    HgHtmlRendererPtr renderer, HgImageReadyCallback callback, void* userData);
+HG_KAMVA_EXTERNC void hgHtmlRenderer_setImageCacheBudget(
+    HgHtmlRendererPtr renderer, size_t byteBudget);
+HG_KAMVA_EXTERNC void hgHtmlRenderer_setOverscanMargin(
+    HgHtmlRendererPtr renderer, int margin);
+HG_KAMVA_EXTERNC HgBool hgHtmlRenderer_prerenderOverscan(
+    HgHtmlRendererPtr renderer);
+/* The overlays are drawn over the document raster by the next drawHtml(),
+   the rects are in the document coordinates. */
+HG_KAMVA_EXTERNC void hgHtmlRenderer_setOverlay(HgHtmlRendererPtr renderer,
+    hgOverlayLayer layer,
+    const HgRect* rects,
+    int rectCount,
+    HgByte red,
+    HgByte green,
+    HgByte blue,
+    HgByte alpha);
+HG_KAMVA_EXTERNC void hgHtmlRenderer_setOverlayVisible(
+    HgHtmlRendererPtr renderer, hgOverlayLayer layer, HgBool visible);
+
+/* The pinch zoom. During the gesture the last drawn raster is scaled
+   around the viewport point focusX, focusY, the end sets the new zoom
+   and the scroll position which keeps the focus. With textZoom
+   the document is laid out again to wrap the zoomed text. */
+HG_KAMVA_EXTERNC void hgHtmlRenderer_setZoom(
+    HgHtmlRendererPtr renderer, double zoom, HgBool textZoom);
+HG_KAMVA_EXTERNC void hgHtmlRenderer_setZoomPreview(
+    HgHtmlRendererPtr renderer, double zoom, int focusX, int focusY);
+HG_KAMVA_EXTERNC void hgHtmlRenderer_endZoomPreview(
+    HgHtmlRendererPtr renderer, HgBool textZoom, int* htmlX, int* htmlY);
+
+/* Finds the text position nearest to the document point x, y.
+   Returns false if the document has no text. */
+HG_KAMVA_EXTERNC HgBool hgHtmlRenderer_hitTest(
+    HgHtmlRendererPtr renderer, int x, int y, HgHitTestResult* result);
+
+/* Finds up to maxMatches occurrences of the UTF-8 query in the document
+   text without the relayout, puts them to matches if it is not NULL.
+   Returns the number of the found matches. */
+HG_KAMVA_EXTERNC int hgHtmlRenderer_findAll(HgHtmlRendererPtr renderer,
+    const char* query,
+    HgBool caseSensitive,
+    HgTextMatch* matches,
+    int maxMatches);
+/* Finds all occurrences of the query and puts them to the search overlay.
+   Returns the number of the found matches. */
+HG_KAMVA_EXTERNC int hgHtmlRenderer_highlightText(HgHtmlRendererPtr renderer,
+    const char* query,
+    HgBool caseSensitive,
+    HgByte red,
+    HgByte green,
+    HgByte blue,
+    HgByte alpha);
+
+/* The edits of the rendered document, the element is the litehtml element
+   from HgHitTestResult. The damaged area in the document coordinates
+   is set to damage if it is not NULL. The edited text element is replaced,
+   take the new one with the next hit-test. */
+HG_KAMVA_EXTERNC void hgHtmlRenderer_setText(HgHtmlRendererPtr renderer,
+    void* element,
+    const char* text,
+    HgRect* damage);
+HG_KAMVA_EXTERNC void hgHtmlRenderer_insertText(HgHtmlRendererPtr renderer,
+    void* textElement,
+    int charOffset,
+    const char* text,
+    HgRect* damage);
+HG_KAMVA_EXTERNC void hgHtmlRenderer_deleteText(HgHtmlRendererPtr renderer,
+    void* textElement,
+    int charOffset,
+    int length,
+    HgRect* damage);
+HG_KAMVA_EXTERNC void hgHtmlRenderer_removeElement(
+    HgHtmlRendererPtr renderer, void* element, HgRect* damage);
+HG_KAMVA_EXTERNC void hgHtmlRenderer_setAttribute(HgHtmlRendererPtr renderer,
+    void* element,
+    const char* name,
+    const char* value,
+    HgRect* damage);
+
+/* Additional views of the renderer's document, they share the parsed
+   and laid out document and may draw concurrently. */
+HG_KAMVA_EXTERNC HgViewPtr hgNewHtmlView(HgHtmlRendererPtr renderer);
+HG_KAMVA_EXTERNC void hgDeleteHtmlView(HgViewPtr view);
+HG_KAMVA_EXTERNC void hgHtmlView_drawHtml(HgViewPtr view,
+    unsigned char* buffer,
+    const hgColorFormat colorFormat,
+    const int width,
+    const int height,
+    const int stride,
+    const int htmlX,
+    const int htmlY);
+HG_KAMVA_EXTERNC void hgHtmlView_setBackgroundColor(HgViewPtr view,
+    HgByte red,
+    HgByte green,
+    HgByte blue,
+    HgByte alpha = 255);
+HG_KAMVA_EXTERNC void hgHtmlView_setOverscanMargin(
+    HgViewPtr view, int margin);
+HG_KAMVA_EXTERNC HgBool hgHtmlView_prerenderOverscan(HgViewPtr view);
+
+/* The export of the renderer's document, it is laid out at the page width.
+   With fullLength the document is one page of its height. The PNG pages
+   are written concurrently to filePrefix-1.png, filePrefix-2.png
+   and so on. Return the number of the pages or -1 on the error. */
+HG_KAMVA_EXTERNC int hgHtmlRenderer_exportPdf(HgHtmlRendererPtr renderer,
+    const char* filePath,
+    int pageWidth,
+    int pageHeight,
+    HgBool fullLength);
+HG_KAMVA_EXTERNC int hgHtmlRenderer_exportPng(HgHtmlRendererPtr renderer,
+    const char* filePrefix,
+    int pageWidth,
+    int pageHeight,
+    HgBool fullLength);
+
+/* The paged mode of the renderer's document. The document is laid out
+   at the page width, the pages are found and prerendered on the background
+   thread. The page count grows while the pages are found. */
+HG_KAMVA_EXTERNC HgPagerPtr hgNewHtmlPager(HgHtmlRendererPtr renderer);
+HG_KAMVA_EXTERNC void hgDeleteHtmlPager(HgPagerPtr pager);
+HG_KAMVA_EXTERNC void hgHtmlPager_paginate(
+    HgPagerPtr pager, int pageWidth, int pageHeight);
+HG_KAMVA_EXTERNC int hgHtmlPager_pageCount(HgPagerPtr pager);
+HG_KAMVA_EXTERNC HgBool hgHtmlPager_isPaginated(HgPagerPtr pager);
+/* Returns false if the page is not found yet. */
+HG_KAMVA_EXTERNC HgBool hgHtmlPager_drawPage(HgPagerPtr pager,
+    int page,
+    unsigned char* buffer,
+    const hgColorFormat colorFormat,
+    const int width,
+    const int height,
+    const int stride);
 
 HG_KAMVA_EXTERNC HgBool hgContainer_parseAndLoadFontConfigFromMemory(
     HgHtmlRendererPtr renderer, const char* fontConfig, HgBool complain);
 HG_KAMVA_EXTERNC HgBool hgContainer_addFontDir(
     HgHtmlRendererPtr renderer, const char* dirPath);
+// Is engine-wide like hgEngine_setFontTextCacheSize(), only the fonts
+// created after the call have the new cache size.
 HG_KAMVA_EXTERNC void hgContainer_setFontTextCacheSize(
     HgHtmlRendererPtr renderer, int size);
 HG_KAMVA_EXTERNC void hgContainer_setDefaultFontName(
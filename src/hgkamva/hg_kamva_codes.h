@@ -52,4 +52,11 @@ enum hgLitehtmlMediaType
   media_type_tv,
 };
 
+enum hgOverlayLayer
+{
+  HG_OVERLAY_SEARCH = 0,
+  HG_OVERLAY_SELECTION = 1,
+  HG_OVERLAY_CARET = 2,
+};  // == hg::HgHtmlView::OverlayLayer
+
 #endif /* HG_KAMVA_CODES_H */
@@ -0,0 +1,460 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/renderer/HgHtmlDocument.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "litehtml/el_space.h"
+#include "litehtml/el_text.h"
+
+#include "hgkamva/util/MappedFile.h"
+#include "hgkamva/util/StringUtil.h"
+
+namespace hg
+{
+namespace
+{
+bool isBlock(const litehtml::element::ptr& element)
+{
+  litehtml::element_display display = element->get_display();
+  return display == litehtml::display_block
+      || display == litehtml::display_list_item;
+}
+
+// The parents which give their content width to the block children.
+bool isBlockContainer(const litehtml::element::ptr& element)
+{
+  return isBlock(element)
+      || element->get_display() == litehtml::display_table_cell;
+}
+
+// The blocks placed one after another by their parent.
+bool isInFlowBlock(const litehtml::element::ptr& element)
+{
+  litehtml::element_position position = element->get_element_position();
+  return isBlock(element) && element->get_float() == litehtml::float_none
+      && position != litehtml::element_position_absolute
+      && position != litehtml::element_position_fixed;
+}
+
+// The nearest block formatting context containing the element.
+litehtml::element::ptr floatsHolder(litehtml::element::ptr element)
+{
+  while(element->parent() && !element->is_floats_holder()) {
+    element = element->parent();
+  }
+  return element;
+}
+
+// Moves the in-flow blocks following the element by delta and grows
+// the element's ancestors up to the root. Returns the ancestor
+// with the fixed height which stops the move, or null at the root.
+litehtml::element::ptr moveFollowing(litehtml::element::ptr element, int delta)
+{
+  for(litehtml::element::ptr parent = element->parent(); parent;
+      element = parent, parent = parent->parent()) {
+    // Only the following children are visited.
+    for(std::size_t i = parent->get_children_count(); i-- > 0;) {
+      litehtml::element::ptr child = parent->get_child(static_cast<int>(i));
+      if(child == element) {
+        break;
+      }
+      if(isInFlowBlock(child)) {
+        child->get_position().y += delta;
+      }
+    }
+    if(!parent->get_css_height().is_predefined()) {
+      return parent;
+    }
+    parent->get_position().height += delta;
+  }
+  return nullptr;
+}
+
+// The bottom of the children in the document coordinates,
+// they may overflow the element.
+int childrenBottom(const litehtml::element::ptr& element)
+{
+  litehtml::position box = element->get_placement();
+  int bottom = box.bottom();
+  for(std::size_t i = 0; i < element->get_children_count(); ++i) {
+    bottom = std::max(bottom,
+        box.y + element->get_child(static_cast<int>(i))->bottom());
+  }
+  return bottom;
+}
+
+litehtml::position unite(
+    const litehtml::position& rect1, const litehtml::position& rect2)
+{
+  if(rect1.width <= 0 || rect1.height <= 0) {
+    return rect2;
+  }
+  if(rect2.width <= 0 || rect2.height <= 0) {
+    return rect1;
+  }
+  int left = std::min(rect1.left(), rect2.left());
+  int top = std::min(rect1.top(), rect2.top());
+  int right = std::max(rect1.right(), rect2.right());
+  int bottom = std::max(rect1.bottom(), rect2.bottom());
+  return litehtml::position(left, top, right - left, bottom - top);
+}
+
+// Clears the clips of the drawing thread before and after the drawing,
+// so a throwing drawing does not leave them to the next one.
+class ClipsGuard
+{
+public:
+  explicit ClipsGuard(HgContainer& container)
+      : mContainer{container}
+  {
+    mContainer.clearClips();
+  }
+  ~ClipsGuard() { mContainer.clearClips(); }
+
+  ClipsGuard(const ClipsGuard&) = delete;
+  ClipsGuard& operator=(const ClipsGuard&) = delete;
+
+private:
+  HgContainer& mContainer;
+};
+}  // namespace
+
+HgHtmlDocument::HgHtmlDocument()
+    : HgHtmlDocument(std::make_shared<HgEngine>())
+{
+}
+
+HgHtmlDocument::HgHtmlDocument(HgEnginePtr engine)
+    : mHgContainer{std::make_shared<HgContainer>(engine)}
+    , mHtmlContext{engine->getHtmlContext()}
+    , mHtmlDocument(nullptr)
+    , mRenderWidth(0)
+    , mTextIndexValid(false)
+    , mLayoutVersion(0)
+    , mFullLayoutVersion(0)
+{
+}
+
+void HgHtmlDocument::createHtmlDocumentFromUtf8(const std::string& htmlText)
+{
+  createHtmlDocumentFromUtf8(htmlText.c_str());
+}
+
+void HgHtmlDocument::createHtmlDocumentFromUtf8(
+    const char* htmlText, std::size_t length)
+{
+  createHtmlDocumentFromUtf8(std::string(htmlText, length).c_str());
+}
+
+bool HgHtmlDocument::createHtmlDocumentFromFile(
+    const hg::filesystem::path& fileName)
+{
+  hg::util::MappedFile file(fileName, true);
+  if(!file.isOpen()) {
+    return false;
+  }
+  // The images are relative to the document.
+  mHgContainer->setBaseUrl(fileName.parent_path().string());
+  // litehtml does not keep the source text after the parsing.
+  createHtmlDocumentFromUtf8(reinterpret_cast<const char*>(file.data()));
+  return true;
+}
+
+void HgHtmlDocument::createHtmlDocumentFromUtf8(const char* htmlText)
+{
+  mHtmlDocument = litehtml::document::createFromUTF8(
+      htmlText, mHgContainer.get(), mHtmlContext.get());
+  mSize = litehtml::size();
+  mTextIndex.clear();
+  mTextIndexValid = false;
+  mFullLayoutVersion = ++mLayoutVersion;
+  mDamages.clear();
+}
+
+int HgHtmlDocument::renderHtml(int width, int height)
+{
+  mHgContainer->setDeviceWidth(width);
+  mHgContainer->setDeviceHeight(height);
+  mHgContainer->setDisplayAreaWidth(width);
+  mHgContainer->setDisplayAreaHeight(height);
+
+  // Render HTML document.
+  int bestWidth = mHtmlDocument->render(width);
+  assert(bestWidth != 0);
+  mRenderWidth = width;
+  mSize.width = mHtmlDocument->width();
+  mSize.height = mHtmlDocument->height();
+  mTextIndexValid = false;
+  mFullLayoutVersion = ++mLayoutVersion;
+  mDamages.clear();
+  return bestWidth;
+}
+
+void HgHtmlDocument::draw(HgCairoPtr& cairo,
+    const litehtml::position& clip,
+    const int htmlX,
+    const int htmlY) const
+{
+  litehtml::uint_ptr hdcCairo = reinterpret_cast<litehtml::uint_ptr>(&cairo);
+  ClipsGuard clipsGuard{*mHgContainer};
+  mHtmlDocument->draw(hdcCairo, -htmlX, -htmlY, &clip);
+}
+
+litehtml::position HgHtmlDocument::setText(
+    const litehtml::element::ptr& element, const std::string& text)
+{
+  litehtml::elements_vector children;
+  for(std::size_t i = 0; i < element->get_children_count(); ++i) {
+    children.push_back(element->get_child(static_cast<int>(i)));
+  }
+  for(const auto& child : children) {
+    element->removeChild(child);
+  }
+  for(const auto& child : createTextElements(text)) {
+    element->appendChild(child);
+    child->parse_styles();
+  }
+  return relayout(element);
+}
+
+litehtml::position HgHtmlDocument::insertText(
+    const litehtml::element::ptr& textElement,
+    const std::size_t charOffset,
+    const std::string& text)
+{
+  std::string runText;
+  textElement->get_text(runText);
+  runText.insert(util::utf8ByteOffset(runText, charOffset), text);
+
+  litehtml::element::ptr parent = textElement->parent();
+  replaceChild(parent, textElement, createTextElements(runText));
+  return relayout(parent);
+}
+
+litehtml::position HgHtmlDocument::deleteText(
+    const litehtml::element::ptr& textElement,
+    const std::size_t charOffset,
+    const std::size_t length)
+{
+  std::string runText;
+  textElement->get_text(runText);
+  std::size_t begin = util::utf8ByteOffset(runText, charOffset);
+  std::size_t end = util::utf8ByteOffset(runText, charOffset + length);
+  runText.erase(begin, end - begin);
+
+  litehtml::element::ptr parent = textElement->parent();
+  replaceChild(parent, textElement, createTextElements(runText));
+  return relayout(parent);
+}
+
+litehtml::position HgHtmlDocument::removeElement(
+    const litehtml::element::ptr& element)
+{
+  litehtml::element::ptr parent = element->parent();
+  parent->removeChild(element);
+  return relayout(parent);
+}
+
+litehtml::position HgHtmlDocument::setAttribute(
+    const litehtml::element::ptr& element,
+    const std::string& name,
+    const std::string& value)
+{
+  element->set_attr(name.c_str(), value.c_str());
+  element->parse_styles(true);
+  return relayout(element);
+}
+
+const HgTextIndex& HgHtmlDocument::textIndex() const
+{
+  std::lock_guard<std::mutex> lock(mTextIndexMutex);
+  if(!mTextIndexValid) {
+    mTextIndex.build(mHtmlDocument);
+    mTextIndexValid = true;
+  }
+  return mTextIndex;
+}
+
+bool HgHtmlDocument::getDamage(
+    unsigned int sinceVersion, litehtml::position& damage) const
+{
+  if(sinceVersion < mFullLayoutVersion) {
+    return false;
+  }
+  if(sinceVersion == mLayoutVersion) {
+    damage.clear();
+    return true;
+  }
+  // Is older than the kept damages.
+  if(mDamages.empty() || mDamages.front().first > sinceVersion + 1) {
+    return false;
+  }
+
+  damage.clear();
+  for(const auto& versionDamage : mDamages) {
+    if(versionDamage.first > sinceVersion) {
+      damage = unite(damage, versionDamage.second);
+    }
+  }
+  return true;
+}
+
+void HgHtmlDocument::replaceChild(const litehtml::element::ptr& parent,
+    const litehtml::element::ptr& oldChild,
+    const litehtml::elements_vector& newChildren)
+{
+  // litehtml can only append the children, rebuild the children list.
+  litehtml::elements_vector children;
+  for(std::size_t i = 0; i < parent->get_children_count(); ++i) {
+    children.push_back(parent->get_child(static_cast<int>(i)));
+  }
+  for(const auto& child : children) {
+    parent->removeChild(child);
+  }
+
+  for(const auto& child : children) {
+    if(child != oldChild) {
+      parent->appendChild(child);
+      continue;
+    }
+    for(const auto& newChild : newChildren) {
+      parent->appendChild(newChild);
+      newChild->parse_styles();
+    }
+  }
+}
+
+// Splits the text to the word and the space elements
+// like litehtml::document does.
+litehtml::elements_vector HgHtmlDocument::createTextElements(
+    const std::string& text)
+{
+  litehtml::elements_vector elements;
+  std::string word;
+  for(char c : text) {
+    if(c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f') {
+      if(!word.empty()) {
+        elements.push_back(
+            std::make_shared<litehtml::el_text>(word.c_str(), mHtmlDocument));
+        word.clear();
+      }
+      const litehtml::tchar_t space[] = {c, 0};
+      elements.push_back(
+          std::make_shared<litehtml::el_space>(space, mHtmlDocument));
+    } else {
+      word += c;
+    }
+  }
+  if(!word.empty()) {
+    elements.push_back(
+        std::make_shared<litehtml::el_text>(word.c_str(), mHtmlDocument));
+  }
+  return elements;
+}
+
+litehtml::position HgHtmlDocument::relayout(
+    const litehtml::element::ptr& element)
+{
+  ++mLayoutVersion;
+
+  // The block containing the changed element.
+  litehtml::element::ptr block = element;
+  while(block->parent() && !isBlock(block)) {
+    block = block->parent();
+  }
+  // The block height change is moved through the block containers
+  // up to the ancestor with the fixed height. The floats and the other
+  // layouts are laid out again by their block formatting context.
+  for(litehtml::element::ptr child = block; child->parent();) {
+    litehtml::element::ptr parent = child->parent();
+    if(!isInFlowBlock(child) || !isBlockContainer(parent)
+        || parent->get_floats_height() > 0) {
+      block = child = floatsHolder(parent);
+      continue;
+    }
+    if(!parent->get_css_height().is_predefined()) {
+      break;
+    }
+    child = parent;
+  }
+  litehtml::element::ptr parent = block->parent();
+
+  litehtml::position damage;
+  if(parent) {
+    // The margin box in the document coordinates.
+    litehtml::position parentBox = parent->get_placement();
+    litehtml::position oldBox(parentBox.x + block->left(),
+        parentBox.y + block->top(), block->width(), block->height());
+
+    block->render(block->left(), block->top(), parentBox.width);
+    block->render_positioned();
+
+    litehtml::position newBox(parentBox.x + block->left(),
+        parentBox.y + block->top(), block->width(), block->height());
+    int delta = newBox.height - oldBox.height;
+    litehtml::element::ptr stop;
+    if(delta == 0) {
+      damage = unite(oldBox, newBox);
+    } else {
+      // The blocks below are moved without their layout.
+      int oldHeight = mSize.height;
+      stop = moveFollowing(block, delta);
+      int bottom = 0;
+      if(stop) {
+        bottom = childrenBottom(stop);
+        bottom = std::max(bottom, bottom - delta);
+      } else {
+        // The block content may overflow the document end.
+        mSize.height = std::max(oldHeight + delta, childrenBottom(block));
+        bottom = std::max(oldHeight, mSize.height);
+      }
+      damage = litehtml::position(0, oldBox.y,
+          std::max(mRenderWidth, mSize.width), bottom - oldBox.y);
+    }
+
+    std::lock_guard<std::mutex> lock(mTextIndexMutex);
+    if(mTextIndexValid) {
+      mTextIndexValid = mTextIndex.update(block, oldBox, delta, stop);
+    }
+
+  } else {
+    mTextIndexValid = false;
+    litehtml::size oldSize = mSize;
+    mHtmlDocument->render(mRenderWidth);
+    mSize.width = mHtmlDocument->width();
+    mSize.height = mHtmlDocument->height();
+    damage = litehtml::position(0, 0, std::max(oldSize.width, mSize.width),
+        std::max(oldSize.height, mSize.height));
+  }
+
+  mDamages.emplace_back(mLayoutVersion, damage);
+  if(mDamages.size() > MAX_DAMAGES) {
+    mDamages.pop_front();
+  }
+  return damage;
+}
+
+}  // namespace hg
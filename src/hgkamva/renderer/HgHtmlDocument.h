@@ -0,0 +1,209 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_HTML_DOCUMENT_H
+#define HG_HTML_DOCUMENT_H
+
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "litehtml.h"
+
+#include "hgkamva/container/HgCairo.h"
+#include "hgkamva/container/HgContainer.h"
+#include "hgkamva/container/HgEngine.h"
+#include "hgkamva/renderer/HgTextIndex.h"
+#include "hgkamva/util/Filesystem.h"
+
+namespace hg
+{
+class HgHtmlDocument;
+
+using HgHtmlDocumentPtr = std::shared_ptr<HgHtmlDocument>;
+using HgHtmlDocumentConstPtr = std::shared_ptr<const HgHtmlDocument>;
+
+// The parsed and laid out HTML document shared by any number of views.
+// The const methods may be called concurrently, the others must not run
+// concurrently with any other method.
+class HgHtmlDocument
+{
+public:
+  // TODO: Copy/move constructors/operators.
+  explicit HgHtmlDocument();
+  // The fonts and the master CSS are shared with the engine.
+  explicit HgHtmlDocument(HgEnginePtr engine);
+  ~HgHtmlDocument() = default;
+
+  void createHtmlDocumentFromUtf8(const std::string& htmlText);
+  // The null terminated text is parsed without the copy.
+  void createHtmlDocumentFromUtf8(const char* htmlText);
+  // The text is copied once to terminate it.
+  void createHtmlDocumentFromUtf8(const char* htmlText, std::size_t length);
+  // The file is mapped to the memory and parsed without the copy.
+  bool createHtmlDocumentFromFile(const hg::filesystem::path& fileName);
+  int renderHtml(int width, int height);
+
+  // Draws the document area clip (in the cairo's coordinates)
+  // at the document position htmlX, htmlY.
+  void draw(HgCairoPtr& cairo,
+      const litehtml::position& clip,
+      const int htmlX,
+      const int htmlY) const;
+
+  // The edits of the rendered document. Only the block containing
+  // the changed element is laid out again, the blocks below it are
+  // moved if the block height is changed.
+  // The offsets are in characters. Return the damaged area
+  // in the document coordinates.
+
+  // Replaces the content of the element with the text.
+  litehtml::position setText(
+      const litehtml::element::ptr& element, const std::string& text);
+  // The text element is replaced, the text elements are the runs
+  // of the text index.
+  litehtml::position insertText(const litehtml::element::ptr& textElement,
+      const std::size_t charOffset,
+      const std::string& text);
+  litehtml::position deleteText(const litehtml::element::ptr& textElement,
+      const std::size_t charOffset,
+      const std::size_t length);
+  litehtml::position removeElement(const litehtml::element::ptr& element);
+  // The attribute is applied through the element's styles parsing,
+  // the CSS selectors are not matched again.
+  litehtml::position setAttribute(const litehtml::element::ptr& element,
+      const std::string& name,
+      const std::string& value);
+
+  // Hit-tests the text at the document point x, y.
+  bool hitTest(int x, int y, HgTextIndex::HitTestResult& result) const;
+  // Finds the text matches, see HgTextIndex::findAll().
+  HgTextIndex::TextMatchVector findAll(const std::string& query,
+      bool caseSensitive = true,
+      std::size_t maxMatches = std::numeric_limits<std::size_t>::max()) const;
+  // Is built on the first use after the layout.
+  const HgTextIndex& textIndex() const;
+
+  bool isEmpty() const;
+  int width() const;
+  int height() const;
+  // Is changed by every new document, every new layout and every edit.
+  unsigned int layoutVersion() const;
+  // Is changed by every decoded image, the drawn rasters are stale.
+  // May be called concurrently with any method.
+  unsigned int imageVersion() const;
+
+  // The union of the areas damaged by the edits after the layout version
+  // sinceVersion. Returns false if all is changed since it.
+  bool getDamage(unsigned int sinceVersion, litehtml::position& damage) const;
+
+  HgContainerPtr getHgContainer() const;
+  std::shared_ptr<litehtml::context> getHtmlContext() const;
+  litehtml::document::ptr getHtmlDocument() const;
+
+private:
+  // The kept damages for the views which skipped some versions.
+  static constexpr std::size_t MAX_DAMAGES = 64;
+
+  void replaceChild(const litehtml::element::ptr& parent,
+      const litehtml::element::ptr& oldChild,
+      const litehtml::elements_vector& newChildren);
+  litehtml::elements_vector createTextElements(const std::string& text);
+  litehtml::position relayout(const litehtml::element::ptr& element);
+
+  HgContainerPtr mHgContainer;
+  std::shared_ptr<litehtml::context> mHtmlContext;
+  litehtml::document::ptr mHtmlDocument;
+  int mRenderWidth;
+  // litehtml::document keeps the size of its last full layout only.
+  litehtml::size mSize;
+
+  mutable std::mutex mTextIndexMutex;
+  mutable HgTextIndex mTextIndex;
+  mutable bool mTextIndexValid;
+
+  unsigned int mLayoutVersion;
+  // The version of the last full layout.
+  unsigned int mFullLayoutVersion;
+  std::deque<std::pair<unsigned int, litehtml::position>> mDamages;
+};  // class HgHtmlDocument
+
+inline bool HgHtmlDocument::hitTest(
+    int x, int y, HgTextIndex::HitTestResult& result) const
+{
+  return textIndex().hitTest(x, y, result);
+}
+
+inline HgTextIndex::TextMatchVector HgHtmlDocument::findAll(
+    const std::string& query, bool caseSensitive, std::size_t maxMatches) const
+{
+  return textIndex().findAll(query, caseSensitive, maxMatches);
+}
+
+inline bool HgHtmlDocument::isEmpty() const
+{
+  return !mHtmlDocument;
+}
+
+inline int HgHtmlDocument::width() const
+{
+  return mSize.width;
+}
+
+inline int HgHtmlDocument::height() const
+{
+  return mSize.height;
+}
+
+inline unsigned int HgHtmlDocument::layoutVersion() const
+{
+  return mLayoutVersion;
+}
+
+inline unsigned int HgHtmlDocument::imageVersion() const
+{
+  return mHgContainer->getImageCache()->version();
+}
+
+inline HgContainerPtr HgHtmlDocument::getHgContainer() const
+{
+  return mHgContainer;
+}
+
+inline std::shared_ptr<litehtml::context> HgHtmlDocument::getHtmlContext() const
+{
+  return mHtmlContext;
+}
+
+inline litehtml::document::ptr HgHtmlDocument::getHtmlDocument() const
+{
+  return mHtmlDocument;
+}
+
+}  // namespace hg
+
+#endif  // HG_HTML_DOCUMENT_H
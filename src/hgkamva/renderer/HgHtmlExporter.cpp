@@ -0,0 +1,222 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/renderer/HgHtmlExporter.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <future>
+#include <stdexcept>
+#include <string>
+
+#include <cairo/cairo-pdf.h>
+#include <cairo/cairo.h>
+
+#include "hgkamva/renderer/HgHtmlPager.h"
+#include "hgkamva/util/FileUtil.h"
+#include "hgkamva/util/PngWriter.h"
+
+namespace hg
+{
+namespace
+{
+// The CSS pixel is 1/96 inch, the PDF point is 1/72 inch.
+constexpr double PDF_POINTS_PER_PIXEL = 72.0 / 96.0;
+constexpr int DEFAULT_BAND_HEIGHT = 256;
+}  // namespace
+
+HgHtmlExporter::HgHtmlExporter(HgHtmlDocumentPtr document)
+    : mDocument(document)
+    , mPageWidth(0)
+    , mPageHeight(0)
+    , mFullLength(false)
+    , mBackgroundColor(255, 255, 255)
+    , mBandHeight(DEFAULT_BAND_HEIGHT)
+    , mPageCount(0)
+{
+}
+
+std::vector<litehtml::position> HgHtmlExporter::layoutPages()
+{
+  if(mPageWidth <= 0 || mPageHeight <= 0) {
+    throw std::logic_error("HgHtmlExporter, empty page size");
+  }
+
+  std::vector<litehtml::position> pages;
+  if(mFullLength) {
+    mDocument->renderHtml(mPageWidth, mPageHeight);
+    pages.emplace_back(0, 0, mPageWidth, std::max(mDocument->height(), 1));
+
+  } else {
+    HgHtmlPager pager(mDocument);
+    pager.setPrefetchRadius(0);
+    pager.paginate(mPageWidth, mPageHeight);
+    pager.waitPaginated();
+    pages.resize(pager.pageCount());
+    for(int i = 0; i < pager.pageCount(); ++i) {
+      pager.getPageRect(i, pages[i]);
+    }
+  }
+
+  mPageCount = static_cast<int>(pages.size());
+  return pages;
+}
+
+void HgHtmlExporter::drawPage(
+    HgCairoPtr& cairo, const litehtml::position& rect) const
+{
+  // The next page content under the page break is not drawn.
+  cairo->clearDeferred(HgCairo::Color{mBackgroundColor});
+  cairo->save();
+  cairo->clip(0, 0, rect.width, rect.height);
+  litehtml::position clip(0, 0, rect.width, rect.height);
+  mDocument->draw(cairo, clip, rect.x, rect.y);
+  cairo->restore();
+  cairo->flush();
+}
+
+bool HgHtmlExporter::exportPdf(const filesystem::path& filePath)
+{
+  std::vector<litehtml::position> pages = layoutPages();
+
+  // The page height is kept for the short last page of the paged mode.
+  const int pageHeight = mFullLength ? pages.front().height : mPageHeight;
+  HgCairo::SurfacePtr surface = {
+      cairo_pdf_surface_create(filePath.c_str(),
+          mPageWidth * PDF_POINTS_PER_PIXEL,
+          pageHeight * PDF_POINTS_PER_PIXEL),
+      cairo_surface_destroy};
+  if(cairo_surface_status(surface.get()) != CAIRO_STATUS_SUCCESS) {
+    return false;
+  }
+
+  HgCairoPtr cairo = std::make_shared<HgCairo>(surface.get());
+  cairo->scale(PDF_POINTS_PER_PIXEL);
+  for(const auto& rect : pages) {
+    drawPage(cairo, rect);
+    cairo->showPage();
+  }
+  cairo.reset();
+
+  cairo_surface_finish(surface.get());
+  return cairo_surface_status(surface.get()) == CAIRO_STATUS_SUCCESS;
+}
+
+bool HgHtmlExporter::exportPng(const filesystem::path& filePrefix)
+{
+  std::vector<litehtml::position> pages = layoutPages();
+  if(!mThreadPool) {
+    mThreadPool = std::make_shared<util::ThreadPool>();
+  }
+
+  // The document is drawn concurrently, its const methods are thread-safe.
+  if(mFullLength) {
+    return writePngBands(
+        pages.front(), filePrefix.string() + "-1.png");
+  }
+
+  std::vector<std::future<bool>> results;
+  for(std::size_t i = 0; i < pages.size(); ++i) {
+    filesystem::path filePath =
+        filePrefix.string() + "-" + std::to_string(i + 1) + ".png";
+    const litehtml::position rect = pages[i];
+    results.push_back(
+        mThreadPool->submit([this, rect, filePath]() {
+          const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+          int stride = cairo_format_stride_for_width(colorFormat, rect.width);
+          std::vector<unsigned char> buffer(
+              static_cast<std::size_t>(stride) * mPageHeight);
+          HgCairoPtr cairo = std::make_shared<HgCairo>(
+              buffer.data(), colorFormat, rect.width, mPageHeight, stride);
+          drawPage(cairo, rect);
+          cairo.reset();
+          return util::writePngFile(
+              buffer.data(), rect.width, mPageHeight, stride, true, filePath);
+        }));
+  }
+
+  bool written = true;
+  for(auto& result : results) {
+    written = result.get() && written;
+  }
+  return written;
+}
+
+bool HgHtmlExporter::writePngBands(
+    const litehtml::position& rect, const filesystem::path& filePath)
+{
+  util::PngWriter writer;
+  if(!writer.open(filePath, rect.width, rect.height, true)) {
+    return false;
+  }
+
+  struct Band
+  {
+    std::vector<unsigned char> mBuffer;
+    HgCairoPtr mCairo;
+    int mHeight = 0;
+  };
+
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int stride = cairo_format_stride_for_width(colorFormat, rect.width);
+  const int bandHeight = std::max(std::min(mBandHeight, rect.height), 1);
+  const int bandCount = (rect.height + bandHeight - 1) / bandHeight;
+
+  Band bands[2];
+  for(auto& band : bands) {
+    band.mBuffer.resize(static_cast<std::size_t>(stride) * bandHeight);
+    band.mCairo = std::make_shared<HgCairo>(
+        band.mBuffer.data(), colorFormat, rect.width, bandHeight, stride);
+  }
+
+  auto drawBand = [this, &rect, &bands, bandHeight](int index) {
+    Band& band = bands[index % 2];
+    int top = index * bandHeight;
+    band.mHeight = std::min(bandHeight, rect.height - top);
+    drawPage(band.mCairo,
+        litehtml::position(rect.x, rect.y + top, rect.width, band.mHeight));
+  };
+
+  // The band is drawn while the previous one is written.
+  std::future<void> drawn = mThreadPool->submit([&drawBand]() { drawBand(0); });
+  bool written = true;
+  for(int i = 0; i < bandCount; ++i) {
+    drawn.get();
+    if(i + 1 < bandCount) {
+      drawn = mThreadPool->submit([&drawBand, i]() { drawBand(i + 1); });
+    }
+    const Band& band = bands[i % 2];
+    if(!writer.writeRows(band.mBuffer.data(), band.mHeight, stride)) {
+      written = false;
+      break;
+    }
+  }
+  // The band buffers are used until the drawing is done.
+  if(drawn.valid()) {
+    drawn.wait();
+  }
+
+  return writer.close() && written;
+}
+
+}  // namespace hg
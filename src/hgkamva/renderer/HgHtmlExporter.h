@@ -0,0 +1,128 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_HTML_EXPORTER_H
+#define HG_HTML_EXPORTER_H
+
+#include <memory>
+#include <vector>
+
+#include "litehtml.h"
+
+#include "hgkamva/container/HgCairo.h"
+#include "hgkamva/renderer/HgHtmlDocument.h"
+#include "hgkamva/util/Filesystem.h"
+#include "hgkamva/util/ThreadPool.h"
+
+namespace hg
+{
+// Writes the document to the PDF file or to the PNG file per page.
+// The document is laid out at the page width by the export, in the paged
+// mode the pages are broken as by HgHtmlPager, in the full length mode
+// the document is one page of its height.
+class HgHtmlExporter
+{
+public:
+  HgHtmlExporter() = delete;
+
+  // TODO: Copy/move constructors/operators.
+  explicit HgHtmlExporter(HgHtmlDocumentPtr document);
+  ~HgHtmlExporter() = default;
+
+  // In the CSS pixels.
+  void setPageSize(int pageWidth, int pageHeight);
+  void setFullLength(bool fullLength);
+  void setBackgroundColor(const litehtml::web_color& color);
+  // The PNG pages are drawn by the pool, it may be shared by the exporters.
+  // A pool of the hardware threads is created by default. The export waits
+  // for the pool tasks, do not run it by a task of the same pool.
+  void setThreadPool(std::shared_ptr<util::ThreadPool> threadPool);
+
+  // The pages are drawn one by one to the same PDF surface, so the fonts
+  // are embedded once for all pages. Returns false if the file
+  // is not written.
+  bool exportPdf(const filesystem::path& filePath);
+  // Writes the pages concurrently to the files filePrefix-1.png,
+  // filePrefix-2.png and so on. Returns false if any file is not written.
+  // The full length document is drawn by the bands into two reused band
+  // buffers, the next band is drawn by the pool while the previous one
+  // is compressed, so the memory does not depend on the document height.
+  bool exportPng(const filesystem::path& filePrefix);
+  // The band height for the full length PNG, in pixels.
+  void setBandHeight(int bandHeight);
+
+  // The pages of the last export.
+  int pageCount() const;
+
+private:
+  std::vector<litehtml::position> layoutPages();
+  void drawPage(HgCairoPtr& cairo, const litehtml::position& rect) const;
+  bool writePngBands(
+      const litehtml::position& rect, const filesystem::path& filePath);
+
+  HgHtmlDocumentPtr mDocument;
+  int mPageWidth;
+  int mPageHeight;
+  bool mFullLength;
+  litehtml::web_color mBackgroundColor;
+  std::shared_ptr<util::ThreadPool> mThreadPool;
+  int mBandHeight;
+  int mPageCount;
+};  // class HgHtmlExporter
+
+inline void HgHtmlExporter::setPageSize(int pageWidth, int pageHeight)
+{
+  mPageWidth = pageWidth;
+  mPageHeight = pageHeight;
+}
+
+inline void HgHtmlExporter::setFullLength(bool fullLength)
+{
+  mFullLength = fullLength;
+}
+
+inline void HgHtmlExporter::setBackgroundColor(
+    const litehtml::web_color& color)
+{
+  mBackgroundColor = color;
+}
+
+inline void HgHtmlExporter::setThreadPool(
+    std::shared_ptr<util::ThreadPool> threadPool)
+{
+  mThreadPool = threadPool;
+}
+
+inline void HgHtmlExporter::setBandHeight(int bandHeight)
+{
+  mBandHeight = bandHeight;
+}
+
+inline int HgHtmlExporter::pageCount() const
+{
+  return mPageCount;
+}
+
+}  // namespace hg
+
+#endif  // HG_HTML_EXPORTER_H
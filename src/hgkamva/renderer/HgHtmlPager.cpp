@@ -0,0 +1,347 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/renderer/HgHtmlPager.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace hg
+{
+HgHtmlPager::HgHtmlPager(HgHtmlDocumentPtr document)
+    : mDocument(document)
+    , mPageWidth(0)
+    , mPageHeight(0)
+    , mBackgroundColor(255, 255, 255)
+    , mPrefetchRadius(1)
+    , mLastDrawPrefetched(false)
+    , mStopping(true)
+    , mPaginated(false)
+    , mPrefetchCenter(-1)
+    , mPrefetchFormat(CAIRO_FORMAT_INVALID)
+    , mPrefetchStride(0)
+{
+}
+
+HgHtmlPager::~HgHtmlPager()
+{
+  stop();
+}
+
+void HgHtmlPager::paginate(int pageWidth, int pageHeight)
+{
+  if(pageWidth <= 0 || pageHeight <= 0) {
+    throw std::logic_error("HgHtmlPager::paginate(), empty page size");
+  }
+
+  stop();
+  mDocument->renderHtml(pageWidth, pageHeight);
+  mPageWidth = pageWidth;
+  mPageHeight = pageHeight;
+
+  mPageBreaks.clear();
+  mPaginated = false;
+  mPrefetchQueue.clear();
+  mPrefetchCenter = -1;
+  mRasters.clear();
+  start();
+}
+
+void HgHtmlPager::start()
+{
+  mStopping = false;
+  mThread = std::thread(&HgHtmlPager::run, this);
+}
+
+void HgHtmlPager::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mCondition.notify_all();
+  if(mThread.joinable()) {
+    mThread.join();
+  }
+}
+
+int HgHtmlPager::pageCount() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return static_cast<int>(mPageBreaks.size());
+}
+
+bool HgHtmlPager::isPaginated() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mPaginated;
+}
+
+void HgHtmlPager::waitPaginated() const
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mCondition.wait(lock, [this]() { return mPaginated || mStopping; });
+}
+
+bool HgHtmlPager::getPageRect(int page, litehtml::position& rect) const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  if(page < 0 || page >= static_cast<int>(mPageBreaks.size())) {
+    return false;
+  }
+  rect = pageRect(page);
+  return true;
+}
+
+litehtml::position HgHtmlPager::pageRect(int page) const
+{
+  int top = page > 0 ? mPageBreaks[page - 1] : 0;
+  return litehtml::position(0, top, mPageWidth, mPageBreaks[page] - top);
+}
+
+void HgHtmlPager::run()
+{
+  breakPages();
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  while(true) {
+    mCondition.wait(
+        lock, [this]() { return mStopping || !mPrefetchQueue.empty(); });
+    if(mStopping) {
+      return;
+    }
+
+    PageRaster raster;
+    raster.mPage = mPrefetchQueue.front();
+    raster.mColorFormat = mPrefetchFormat;
+    raster.mStride = mPrefetchStride;
+    raster.mImageVersion = mDocument->imageVersion();
+    mPrefetchQueue.pop_front();
+    if(raster.mPage >= static_cast<int>(mPageBreaks.size())) {
+      continue;
+    }
+
+    bool ready = std::any_of(
+        mRasters.begin(), mRasters.end(), [&raster](const PageRaster& r) {
+          return r.mPage == raster.mPage
+              && r.mColorFormat == raster.mColorFormat
+              && r.mStride == raster.mStride
+              && r.mImageVersion == raster.mImageVersion;
+        });
+    if(ready) {
+      continue;
+    }
+    mRasters.erase(std::remove_if(mRasters.begin(), mRasters.end(),
+                       [&raster](const PageRaster& r) {
+                         return r.mPage == raster.mPage;
+                       }),
+        mRasters.end());
+
+    litehtml::position rect = pageRect(raster.mPage);
+    litehtml::web_color color = mBackgroundColor;
+    lock.unlock();
+
+    raster.mBuffer.resize(static_cast<std::size_t>(raster.mStride)
+        * mPageHeight);
+    HgCairoPtr cairo = std::make_shared<HgCairo>(raster.mBuffer.data(),
+        raster.mColorFormat, mPageWidth, mPageHeight, raster.mStride);
+    drawPageArea(cairo, rect, color);
+    cairo.reset();
+
+    lock.lock();
+    // The background or the drawn page could be changed meanwhile.
+    bool actual = color.red == mBackgroundColor.red
+        && color.green == mBackgroundColor.green
+        && color.blue == mBackgroundColor.blue
+        && color.alpha == mBackgroundColor.alpha
+        && std::abs(raster.mPage - mPrefetchCenter) <= mPrefetchRadius;
+    if(actual) {
+      mRasters.push_back(std::move(raster));
+    }
+  }
+}
+
+void HgHtmlPager::breakPages()
+{
+  // The vertical ranges of the lines and the images
+  // which must not be split by the page breaks.
+  std::vector<std::pair<int, int>> lines;
+  litehtml::document::ptr document = mDocument->getHtmlDocument();
+  if(document && document->root()) {
+    addLines(document->root(), lines);
+  }
+  std::sort(lines.begin(), lines.end());
+
+  const int documentHeight = std::max(mDocument->height(), 1);
+  std::size_t first = 0;
+  int top = 0;
+  while(top < documentHeight) {
+    int bottom = std::min(top + mPageHeight, documentHeight);
+
+    // The page is ended before the first line which is cut by it,
+    // the lines higher than the page are cut.
+    int pageBreak = bottom;
+    for(std::size_t i = first; i < lines.size() && lines[i].first < bottom;
+        ++i) {
+      if(lines[i].first > top && lines[i].second > bottom) {
+        pageBreak = std::min(pageBreak, lines[i].first);
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if(mStopping) {
+        return;
+      }
+      mPageBreaks.push_back(pageBreak);
+    }
+    mCondition.notify_all();
+
+    top = pageBreak;
+    while(first < lines.size() && lines[first].first < top) {
+      ++first;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPaginated = true;
+  }
+  mCondition.notify_all();
+}
+
+void HgHtmlPager::addLines(const litehtml::element::ptr& element,
+    std::vector<std::pair<int, int>>& lines) const
+{
+  if(element->get_display() == litehtml::display_none) {
+    return;
+  }
+
+  std::size_t childCount = element->get_children_count();
+  if(childCount > 0) {
+    for(std::size_t i = 0; i < childCount; ++i) {
+      addLines(element->get_child(static_cast<int>(i)), lines);
+    }
+    return;
+  }
+
+  // The text runs and the replaced elements are the leaves.
+  litehtml::position box = element->get_placement();
+  if(box.height > 0) {
+    lines.emplace_back(box.top(), box.bottom());
+  }
+}
+
+bool HgHtmlPager::drawPage(int page,
+    unsigned char* buffer,
+    const cairo_format_t colorFormat,
+    const int width,
+    const int height,
+    const int stride)
+{
+  litehtml::position rect;
+  litehtml::web_color color;
+  bool prefetched = false;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(page < 0 || page >= static_cast<int>(mPageBreaks.size())) {
+      return false;
+    }
+    rect = pageRect(page);
+    color = mBackgroundColor;
+
+    if(width == mPageWidth && height == mPageHeight) {
+      for(const auto& raster : mRasters) {
+        if(raster.mPage == page && raster.mColorFormat == colorFormat
+            && raster.mStride == stride
+            && raster.mImageVersion == mDocument->imageVersion()) {
+          std::copy(raster.mBuffer.begin(), raster.mBuffer.end(), buffer);
+          prefetched = true;
+          break;
+        }
+      }
+    }
+  }
+
+  if(!prefetched) {
+    HgCairoPtr cairo =
+        std::make_shared<HgCairo>(buffer, colorFormat, width, height, stride);
+    drawPageArea(cairo, rect, color);
+  }
+  mLastDrawPrefetched = prefetched;
+
+  if(width == mPageWidth && height == mPageHeight) {
+    schedulePrefetch(page, colorFormat, stride);
+  }
+  return true;
+}
+
+void HgHtmlPager::drawPageArea(HgCairoPtr& cairo,
+    const litehtml::position& rect,
+    const litehtml::web_color& color) const
+{
+  // The next page content under the page break is not drawn.
+  cairo->clearDeferred(HgCairo::Color{color});
+  cairo->save();
+  cairo->clip(0, 0, rect.width, rect.height);
+  litehtml::position clip(0, 0, rect.width, rect.height);
+  mDocument->draw(cairo, clip, rect.x, rect.y);
+  cairo->restore();
+  cairo->flush();
+}
+
+void HgHtmlPager::schedulePrefetch(
+    int page, cairo_format_t colorFormat, int stride)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(colorFormat != mPrefetchFormat || stride != mPrefetchStride) {
+      mRasters.clear();
+    }
+    mPrefetchFormat = colorFormat;
+    mPrefetchStride = stride;
+    mPrefetchCenter = page;
+
+    mRasters.erase(std::remove_if(mRasters.begin(), mRasters.end(),
+                       [this](const PageRaster& raster) {
+                         return std::abs(raster.mPage - mPrefetchCenter)
+                             > mPrefetchRadius;
+                       }),
+        mRasters.end());
+
+    // The next pages first, the pages are turned forward mostly.
+    mPrefetchQueue.clear();
+    for(int i = 1; i <= mPrefetchRadius; ++i) {
+      if(page + i < static_cast<int>(mPageBreaks.size()) || !mPaginated) {
+        mPrefetchQueue.push_back(page + i);
+      }
+      if(page - i >= 0) {
+        mPrefetchQueue.push_back(page - i);
+      }
+    }
+  }
+  mCondition.notify_all();
+}
+
+}  // namespace hg
@@ -0,0 +1,171 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_HTML_PAGER_H
+#define HG_HTML_PAGER_H
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <cairo/cairo.h>
+
+#include "litehtml.h"
+
+#include "hgkamva/container/HgCairo.h"
+#include "hgkamva/renderer/HgHtmlDocument.h"
+
+namespace hg
+{
+class HgHtmlPager;
+
+using HgHtmlPagerPtr = std::shared_ptr<HgHtmlPager>;
+
+// The paged mode of the document for the printing and the e-readers.
+// The document is laid out once at the page width, the page breaks are
+// found on the background thread, which also prerenders the pages around
+// the last drawn one. The document must not be changed while it is paged.
+class HgHtmlPager
+{
+public:
+  HgHtmlPager() = delete;
+
+  // TODO: Copy/move constructors/operators.
+  explicit HgHtmlPager(HgHtmlDocumentPtr document);
+  ~HgHtmlPager();
+
+  // Lays out the document at the page width and starts the page breaking.
+  // Set the print media type of the container before it for the print CSS.
+  void paginate(int pageWidth, int pageHeight);
+
+  // Grows while the page breaking proceeds.
+  int pageCount() const;
+  // True if all page breaks are found.
+  bool isPaginated() const;
+  void waitPaginated() const;
+  // The document area of the page, false if it is not found yet.
+  bool getPageRect(int page, litehtml::position& rect) const;
+
+  // Draws the page at the top left corner of the buffer, returns false
+  // if the page is not found yet. Does not wait for the background thread,
+  // the prerendered page is copied if it is ready.
+  bool drawPage(int page,
+      unsigned char* buffer,
+      const cairo_format_t colorFormat,
+      const int width,
+      const int height,
+      const int stride);
+  // True if the last drawn page was prerendered.
+  bool lastDrawPrefetched() const;
+
+  void setBackgroundColor(const litehtml::web_color& color);
+  // The number of the pages prerendered before and after the drawn one,
+  // is 1 by default, 0 disables the prerendering.
+  void setPrefetchRadius(int radius);
+
+  int pageWidth() const;
+  int pageHeight() const;
+
+private:
+  struct PageRaster
+  {
+    int mPage = -1;
+    cairo_format_t mColorFormat = CAIRO_FORMAT_INVALID;
+    int mStride = 0;
+    // The images decoded after the drawing make the raster stale.
+    unsigned int mImageVersion = 0;
+    std::vector<unsigned char> mBuffer;
+  };
+
+  void start();
+  void stop();
+  void run();
+  // Is run on the background thread.
+  void breakPages();
+  void addLines(const litehtml::element::ptr& element,
+      std::vector<std::pair<int, int>>& lines) const;
+  void drawPageArea(HgCairoPtr& cairo,
+      const litehtml::position& rect,
+      const litehtml::web_color& color) const;
+  // Must be called with the locked mMutex.
+  litehtml::position pageRect(int page) const;
+  void schedulePrefetch(int page, cairo_format_t colorFormat, int stride);
+
+  HgHtmlDocumentPtr mDocument;
+  int mPageWidth;
+  int mPageHeight;
+  litehtml::web_color mBackgroundColor;
+  int mPrefetchRadius;
+  bool mLastDrawPrefetched;
+
+  // Guards the members below.
+  mutable std::mutex mMutex;
+  mutable std::condition_variable mCondition;
+  std::thread mThread;
+  // Is true if the thread is not run.
+  bool mStopping;
+  // The page bottoms in the document coordinates.
+  std::vector<int> mPageBreaks;
+  bool mPaginated;
+  std::deque<int> mPrefetchQueue;
+  int mPrefetchCenter;
+  cairo_format_t mPrefetchFormat;
+  int mPrefetchStride;
+  std::vector<PageRaster> mRasters;
+};  // class HgHtmlPager
+
+inline bool HgHtmlPager::lastDrawPrefetched() const
+{
+  return mLastDrawPrefetched;
+}
+
+inline void HgHtmlPager::setBackgroundColor(const litehtml::web_color& color)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mBackgroundColor = color;
+  mRasters.clear();
+}
+
+inline void HgHtmlPager::setPrefetchRadius(int radius)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mPrefetchRadius = radius;
+}
+
+inline int HgHtmlPager::pageWidth() const
+{
+  return mPageWidth;
+}
+
+inline int HgHtmlPager::pageHeight() const
+{
+  return mPageHeight;
+}
+
+}  // namespace hg
+
+#endif  // HG_HTML_PAGER_H
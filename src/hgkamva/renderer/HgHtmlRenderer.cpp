@@ -23,45 +23,22 @@
 
 #include "hgkamva/renderer/HgHtmlRenderer.h"
 
-#include <cassert>
-#include <cstdlib>
-
-//#include <chrono>
-//#include <iostream>
+#include <stdexcept>
 
 namespace hg
 {
 HgHtmlRenderer::HgHtmlRenderer()
-    : mBackgroundColor(255, 255, 255)
-    , mHgContainer{std::make_shared<HgContainer>()}
-    , mHtmlContext{std::make_shared<litehtml::context>()}
-    , mHtmlDocument(nullptr)
-    , mBuffer(nullptr)
-    , mBufferWidth(0)
-    , mBufferHeight(0)
-    , mBufferStride(0)
-    , mHtmlX(0)
-    , mHtmlY(0)
+    : HgHtmlRenderer(std::make_shared<HgEngine>())
 {
 }
 
-void HgHtmlRenderer::createHtmlDocumentFromUtf8(const std::string& htmlText)
+HgHtmlRenderer::HgHtmlRenderer(HgEnginePtr engine)
+    : mDocument{std::make_shared<HgHtmlDocument>(engine)}
+    , mView{std::make_shared<HgHtmlView>(mDocument)}
+    , mRenderWidth(0)
+    , mRenderHeight(0)
+    , mTextZoom(1.0)
 {
-  mHtmlDocument = litehtml::document::createFromUTF8(
-      htmlText.c_str(), mHgContainer.get(), mHtmlContext.get());
-}
-
-int HgHtmlRenderer::renderHtml(int width, int height)
-{
-  mHgContainer->setDeviceWidth(width);
-  mHgContainer->setDeviceHeight(height);
-  mHgContainer->setDisplayAreaWidth(width);
-  mHgContainer->setDisplayAreaHeight(height);
-
-  // Render HTML document.
-  int bestWidth = mHtmlDocument->render(width);
-  assert(bestWidth != 0);
-  return bestWidth;
 }
 
 void HgHtmlRenderer::drawHtml(unsigned char* buffer,
@@ -72,104 +49,79 @@ void HgHtmlRenderer::drawHtml(unsigned char* buffer,
     const int htmlX,
     const int htmlY)
 {
-  // https://stackoverflow.com/a/18685338
-  //auto start = std::chrono::steady_clock::now();
-
-  litehtml::uint_ptr hdcCairo = reinterpret_cast<litehtml::uint_ptr>(&mCairo);
-
-  bool fullDraw = buffer != mBuffer || width != mBufferWidth
-      || height != mBufferHeight || stride != mBufferStride
-      || abs(mHtmlX - htmlX) >= width || abs(mHtmlY - htmlY) >= height;
-
-  if(fullDraw) {
-    mCairo =
-        std::make_shared<HgCairo>(buffer, colorFormat, width, height, stride);
-
-    mCairo->save();
-    mCairo->clear(HgCairo::Color{mBackgroundColor});
-    litehtml::position testClip(0, 0, width, height);
-    mHtmlDocument->draw(hdcCairo, -htmlX, -htmlY, &testClip);
-    mCairo->restore();
-
-  } else {
-    int diffX = htmlX - mHtmlX;
-    int diffY = htmlY - mHtmlY;
+  mView->drawHtml(buffer, colorFormat, width, height, stride, htmlX, htmlY);
+}
 
-    mCairo->rasterCopy(diffX, diffY);
+bool HgHtmlRenderer::drawHtmlUntil(unsigned char* buffer,
+    const cairo_format_t colorFormat,
+    const int width,
+    const int height,
+    const int stride,
+    const int htmlX,
+    const int htmlY,
+    const Clock::time_point deadline)
+{
+  return mView->drawHtmlUntil(
+      buffer, colorFormat, width, height, stride, htmlX, htmlY, deadline);
+}
 
-    int x1 = 0;
-    int y1 = 0;
-    int x2 = width;
-    int y2 = height;
+void HgHtmlRenderer::drawThumbnail(unsigned char* buffer,
+    const cairo_format_t colorFormat,
+    const int width,
+    const int height,
+    const int stride,
+    const double scale) const
+{
+  if(scale <= 0) {
+    throw std::logic_error("HgHtmlRenderer::drawThumbnail(), scale <= 0");
+  }
 
-    if(diffX != 0) {
-      if(diffX > 0) {
-        x1 = x2 - diffX;
-      } else {
-        x2 = -diffX;  // x2 = x1 - diffX, but x1 == 0;
-      }
-      if(x1 != x2) {
-        int clipWidth = x2 - x1;
-        int clipHeight = y2 - y1;
-        mCairo->save();
-        mCairo->clip(x1, y1, clipWidth, clipHeight);
-        mCairo->clear(HgCairo::Color{mBackgroundColor});
-        litehtml::position textClip(x1, y1, clipWidth, clipHeight);
-        mHtmlDocument->draw(hdcCairo, -htmlX, -htmlY, &textClip);
-        mCairo->restore();
-      }
-    }
+  HgCairoPtr cairo =
+      std::make_shared<HgCairo>(buffer, colorFormat, width, height, stride);
+  cairo->setQuality(HgCairo::thumbnailQuality, HgCairo::skipDecorations);
+  // The clear is skipped under the opaque background of the document.
+  cairo->clearDeferred(HgCairo::Color{mView->backgroundColor()});
+  if(!mDocument->isEmpty()) {
+    cairo->scale(scale);
+    litehtml::position clip(0, 0, static_cast<int>(std::ceil(width / scale)),
+        static_cast<int>(std::ceil(height / scale)));
+    mDocument->draw(cairo, clip, 0, 0);
+  }
+  cairo->flush();
+}
 
-    if(diffY != 0) {
-      if(width == x2 && 0 != x1) {
-        x2 = x1;
-        x1 = 0;
-      } else if(0 == x1 && width != x2) {
-        x1 = x2;
-        x2 = width;
-      }
+void HgHtmlRenderer::setZoom(double zoom, bool textZoom)
+{
+  mView->setZoom(zoom);
+  relayoutForZoom(textZoom);
+}
 
-      if(diffY > 0) {
-        y1 = y2 - diffY;
-      } else {
-        y2 = -diffY;  // y2 = y1 - diffY, but y1 == 0;
-      }
-      if(y1 != y2) {
-        int clipWidth = x2 - x1;
-        int clipHeight = y2 - y1;
-        mCairo->save();
-        mCairo->clip(x1, y1, clipWidth, clipHeight);
-        mCairo->clear(HgCairo::Color{mBackgroundColor});
-        litehtml::position textClip(x1, y1, clipWidth, clipHeight);
-        mHtmlDocument->draw(hdcCairo, -htmlX, -htmlY, &textClip);
-        mCairo->restore();
-      }
-    }
-  }
+void HgHtmlRenderer::endZoomPreview(bool textZoom, int& htmlX, int& htmlY)
+{
+  mView->endZoomPreview(htmlX, htmlY);
+  relayoutForZoom(textZoom);
+}
 
-  if(buffer != mBuffer) {
-    mBuffer = buffer;
-  }
-  if(width != mBufferWidth) {
-    mBufferWidth = width;
-  }
-  if(height != mBufferHeight) {
-    mBufferHeight = height;
-  }
-  if(stride != mBufferStride) {
-    mBufferStride = stride;
-  }
-  if(htmlX != mHtmlX) {
-    mHtmlX = htmlX;
+void HgHtmlRenderer::relayoutForZoom(bool textZoom)
+{
+  if(!textZoom || mView->zoom() == mTextZoom) {
+    return;
   }
-  if(htmlY != mHtmlY) {
-    mHtmlY = htmlY;
+  mTextZoom = mView->zoom();
+  if(!mDocument->isEmpty() && mRenderWidth > 0) {
+    renderHtml(mRenderWidth, mRenderHeight);
   }
+}
 
-  //auto finish = std::chrono::steady_clock::now();
-  //auto elapsed =
-  //    std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
-  //std::cout << "HgHtmlRenderer::drawHtml: " << elapsed.count() << "\n";
+void HgHtmlRenderer::highlightMatches(
+    const HgTextIndex::TextMatchVector& matches,
+    const litehtml::web_color& color)
+{
+  std::vector<litehtml::position> rects;
+  for(const auto& match : matches) {
+    rects.insert(rects.end(), match.mRects.begin(), match.mRects.end());
+  }
+  mView->setOverlay(HgHtmlView::searchLayer, rects, color);
 }
 
 }  // namespace hg
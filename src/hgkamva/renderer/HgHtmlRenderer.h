@@ -24,24 +24,44 @@
 #ifndef HG_HTML_RENDERER_H
 #define HG_HTML_RENDERER_H
 
+#include <cmath>
+#include <cstddef>
+#include <limits>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "litehtml.h"
 
 #include "hgkamva/container/HgCairo.h"
 #include "hgkamva/container/HgContainer.h"
+#include "hgkamva/container/HgEngine.h"
+#include "hgkamva/renderer/HgHtmlDocument.h"
+#include "hgkamva/renderer/HgHtmlExporter.h"
+#include "hgkamva/renderer/HgHtmlPager.h"
+#include "hgkamva/renderer/HgHtmlView.h"
 
 namespace hg
 {
+// The document with its main view.
+// More views of the same document are created with newView().
 class HgHtmlRenderer
 {
 public:
+  using Clock = HgHtmlView::Clock;
+  using DrawStats = HgHtmlView::DrawStats;
+  using OverlayLayer = HgHtmlView::OverlayLayer;
+
   // TODO: Copy/move constructors/operators.
   explicit HgHtmlRenderer();
+  // The renderers with the same engine share the fonts and the master CSS.
+  explicit HgHtmlRenderer(HgEnginePtr engine);
   virtual ~HgHtmlRenderer() = default;
 
   void createHtmlDocumentFromUtf8(const std::string& htmlText);
+  void createHtmlDocumentFromUtf8(const char* htmlText);
+  void createHtmlDocumentFromUtf8(const char* htmlText, std::size_t length);
+  bool createHtmlDocumentFromFile(const hg::filesystem::path& fileName);
   int renderHtml(int width, int height);
   virtual void drawHtml(unsigned char* buffer,
       const cairo_format_t colorFormat,
@@ -50,47 +70,292 @@ public:
       const int stride,
       const int htmlX,
       const int htmlY);
+  // The frame budgeted drawing of the main view, see HgHtmlView.
+  bool drawHtmlUntil(unsigned char* buffer,
+      const cairo_format_t colorFormat,
+      const int width,
+      const int height,
+      const int stride,
+      const int htmlX,
+      const int htmlY,
+      const Clock::time_point deadline);
+  std::vector<litehtml::position> staleRects() const;
+
+  // Draws the top of the document scaled by the factor with the current
+  // layout, the background is of the main view. The text is drawn
+  // as the bars without the glyph rasterization, the images are decoded
+  // at the drawn size, see HgCairo::thumbnailQuality. The main view
+  // is not changed.
+  void drawThumbnail(unsigned char* buffer,
+      const cairo_format_t colorFormat,
+      const int width,
+      const int height,
+      const int stride,
+      const double scale) const;
 
   void setBackgroundColor(const litehtml::web_color& color);
+  void setPlaceholderColor(const litehtml::web_color& color);
+
+  void setOverscanMargin(int margin);
+  bool prerenderOverscan();
+
+  // The draft quality of the scrolling and the full quality refinement
+  // of the main view, see HgHtmlView.
+  void setDraftQuality(bool draft, unsigned int draftSkips);
+  bool refine();
+
+  // The caret, the selection and the search matches of the main view.
+  void setOverlay(OverlayLayer layer,
+      const std::vector<litehtml::position>& rects,
+      const litehtml::web_color& color);
+  void setOverlayVisible(OverlayLayer layer, bool visible);
 
+  const DrawStats& lastDrawStats() const;
+
+  // The pinch zoom of the main view, see HgHtmlView. With the text zoom
+  // the document is laid out again for the view size divided by the zoom,
+  // so the zoomed text is wrapped to the view width. Otherwise the cached
+  // layout is drawn with the scale transform.
+  void setZoom(double zoom, bool textZoom);
+  void setZoomPreview(double zoom, int focusX, int focusY);
+  void endZoomPreview(bool textZoom, int& htmlX, int& htmlY);
+  double zoom() const;
+
+  // Hit-tests the text at the document point x, y,
+  // the view point divided by the zoom.
+  bool hitTest(int x, int y, HgTextIndex::HitTestResult& result) const;
+
+  // Finds the text matches, see HgTextIndex::findAll().
+  HgTextIndex::TextMatchVector findAll(const std::string& query,
+      bool caseSensitive = true,
+      std::size_t maxMatches = std::numeric_limits<std::size_t>::max()) const;
+  // Puts the match rects to the search overlay of the main view.
+  void highlightMatches(const HgTextIndex::TextMatchVector& matches,
+      const litehtml::web_color& color);
+
+  // The edits, see HgHtmlDocument.
+  litehtml::position setText(
+      const litehtml::element::ptr& element, const std::string& text);
+  litehtml::position insertText(const litehtml::element::ptr& textElement,
+      const std::size_t charOffset,
+      const std::string& text);
+  litehtml::position deleteText(const litehtml::element::ptr& textElement,
+      const std::size_t charOffset,
+      const std::size_t length);
+  litehtml::position removeElement(const litehtml::element::ptr& element);
+  litehtml::position setAttribute(const litehtml::element::ptr& element,
+      const std::string& name,
+      const std::string& value);
+
+  HgHtmlViewPtr newView() const;
+  // The paged mode of the document, the pager lays out the document
+  // at the page width.
+  HgHtmlPagerPtr newPager();
+  // The export of the document, it lays out the document at the page width.
+  std::shared_ptr<HgHtmlExporter> newExporter();
+
+  HgHtmlDocumentPtr getDocument();
+  HgHtmlViewPtr getView();
   HgContainerPtr getHgContainer();
   std::shared_ptr<litehtml::context> getHtmlContext();
   litehtml::document::ptr getHtmlDocument();
 
 private:
-  litehtml::web_color mBackgroundColor;
-
-  HgContainerPtr mHgContainer;
-  std::shared_ptr<litehtml::context> mHtmlContext;
-  litehtml::document::ptr mHtmlDocument;
+  void relayoutForZoom(bool textZoom);
 
-  HgCairoPtr mCairo;
+private:
+  HgHtmlDocumentPtr mDocument;
+  HgHtmlViewPtr mView;
 
-  unsigned char* mBuffer;
-  int mBufferWidth;
-  int mBufferHeight;
-  int mBufferStride;
-  int mHtmlX;
-  int mHtmlY;
+  int mRenderWidth;
+  int mRenderHeight;
+  // The zoom of the layout.
+  double mTextZoom;
 };
 
+inline void HgHtmlRenderer::createHtmlDocumentFromUtf8(
+    const std::string& htmlText)
+{
+  mDocument->createHtmlDocumentFromUtf8(htmlText);
+}
+
+inline void HgHtmlRenderer::createHtmlDocumentFromUtf8(const char* htmlText)
+{
+  mDocument->createHtmlDocumentFromUtf8(htmlText);
+}
+
+inline void HgHtmlRenderer::createHtmlDocumentFromUtf8(
+    const char* htmlText, std::size_t length)
+{
+  mDocument->createHtmlDocumentFromUtf8(htmlText, length);
+}
+
+inline bool HgHtmlRenderer::createHtmlDocumentFromFile(
+    const hg::filesystem::path& fileName)
+{
+  return mDocument->createHtmlDocumentFromFile(fileName);
+}
+
+inline int HgHtmlRenderer::renderHtml(int width, int height)
+{
+  mRenderWidth = width;
+  mRenderHeight = height;
+  return mDocument->renderHtml(
+      static_cast<int>(std::lround(width / mTextZoom)),
+      static_cast<int>(std::lround(height / mTextZoom)));
+}
+
 inline void HgHtmlRenderer::setBackgroundColor(const litehtml::web_color& color)
 {
-  mBackgroundColor = color;
+  mView->setBackgroundColor(color);
+}
+
+inline std::vector<litehtml::position> HgHtmlRenderer::staleRects() const
+{
+  return mView->staleRects();
+}
+
+inline void HgHtmlRenderer::setPlaceholderColor(
+    const litehtml::web_color& color)
+{
+  mView->setPlaceholderColor(color);
+}
+
+inline void HgHtmlRenderer::setOverscanMargin(int margin)
+{
+  mView->setOverscanMargin(margin);
+}
+
+inline bool HgHtmlRenderer::prerenderOverscan()
+{
+  return mView->prerenderOverscan();
+}
+
+inline void HgHtmlRenderer::setDraftQuality(
+    bool draft, unsigned int draftSkips)
+{
+  mView->setDraftQuality(draft, draftSkips);
+}
+
+inline bool HgHtmlRenderer::refine()
+{
+  return mView->refine();
+}
+
+inline const HgHtmlRenderer::DrawStats& HgHtmlRenderer::lastDrawStats() const
+{
+  return mView->lastDrawStats();
+}
+
+inline void HgHtmlRenderer::setOverlay(OverlayLayer layer,
+    const std::vector<litehtml::position>& rects,
+    const litehtml::web_color& color)
+{
+  mView->setOverlay(layer, rects, color);
+}
+
+inline void HgHtmlRenderer::setOverlayVisible(OverlayLayer layer, bool visible)
+{
+  mView->setOverlayVisible(layer, visible);
+}
+
+inline void HgHtmlRenderer::setZoomPreview(
+    double zoom, int focusX, int focusY)
+{
+  mView->setZoomPreview(zoom, focusX, focusY);
+}
+
+inline double HgHtmlRenderer::zoom() const
+{
+  return mView->zoom();
+}
+
+inline bool HgHtmlRenderer::hitTest(
+    int x, int y, HgTextIndex::HitTestResult& result) const
+{
+  return mDocument->hitTest(x, y, result);
+}
+
+inline HgTextIndex::TextMatchVector HgHtmlRenderer::findAll(
+    const std::string& query, bool caseSensitive, std::size_t maxMatches) const
+{
+  return mDocument->findAll(query, caseSensitive, maxMatches);
+}
+
+inline litehtml::position HgHtmlRenderer::setText(
+    const litehtml::element::ptr& element, const std::string& text)
+{
+  return mDocument->setText(element, text);
+}
+
+inline litehtml::position HgHtmlRenderer::insertText(
+    const litehtml::element::ptr& textElement,
+    const std::size_t charOffset,
+    const std::string& text)
+{
+  return mDocument->insertText(textElement, charOffset, text);
+}
+
+inline litehtml::position HgHtmlRenderer::deleteText(
+    const litehtml::element::ptr& textElement,
+    const std::size_t charOffset,
+    const std::size_t length)
+{
+  return mDocument->deleteText(textElement, charOffset, length);
+}
+
+inline litehtml::position HgHtmlRenderer::removeElement(
+    const litehtml::element::ptr& element)
+{
+  return mDocument->removeElement(element);
+}
+
+inline litehtml::position HgHtmlRenderer::setAttribute(
+    const litehtml::element::ptr& element,
+    const std::string& name,
+    const std::string& value)
+{
+  return mDocument->setAttribute(element, name, value);
+}
+
+inline HgHtmlViewPtr HgHtmlRenderer::newView() const
+{
+  return std::make_shared<HgHtmlView>(mDocument);
+}
+
+inline HgHtmlPagerPtr HgHtmlRenderer::newPager()
+{
+  return std::make_shared<HgHtmlPager>(mDocument);
+}
+
+inline std::shared_ptr<HgHtmlExporter> HgHtmlRenderer::newExporter()
+{
+  return std::make_shared<HgHtmlExporter>(mDocument);
+}
+
+inline HgHtmlDocumentPtr HgHtmlRenderer::getDocument()
+{
+  return mDocument;
+}
+
+inline HgHtmlViewPtr HgHtmlRenderer::getView()
+{
+  return mView;
 }
 
 inline HgContainerPtr HgHtmlRenderer::getHgContainer()
 {
-  return mHgContainer;
+  return mDocument->getHgContainer();
 }
+
 inline std::shared_ptr<litehtml::context> HgHtmlRenderer::getHtmlContext()
 {
-  return mHtmlContext;
+  return mDocument->getHtmlContext();
 }
 
 inline litehtml::document::ptr HgHtmlRenderer::getHtmlDocument()
 {
-  return mHtmlDocument;
+  return mDocument->getHtmlDocument();
 }
 
 }  // namespace hg
@@ -21,16 +21,30 @@
  *    along with this program. If not, see <http://www.gnu.org/licenses/>.
  ****************************************************************************/
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <cairo/cairo.h>
 
 #include "gtest/gtest.h"
 
 #include "hgkamva/container/HgCairo.h"
+#include "hgkamva/container/HgEngine.h"
+#include "hgkamva/container/HgImageCache.h"
 #include "hgkamva/renderer/HgHtmlRenderer.h"
+#include "hgkamva/renderer/HgHtmlView.h"
 #include "hgkamva/util/FileUtil.h"
 #include "hgkamva/util/Filesystem.h"
+#include "hgkamva/util/ImageCompare.h"
+#include "hgkamva/util/ImageWriter.h"
 
 inline hg::filesystem::path testDir;
 inline hg::filesystem::path fontDir;
@@ -161,10 +175,1070 @@ TEST(HgHtmlRenderer, drawHtml)
   // Write our picture to file.
   std::string fileName1 = "hgHtmlRenderer_1.ppm";
   hg::filesystem::path fileOutTest1 = testDir / fileName1;
-  hg::util::writePpmFile(frameBuf.data(), frameWidth, frameHeight,
-      BYTES_PER_PIXEL, fileOutTest1.c_str());
+  hg::util::writeImageFile(frameBuf.data(), frameWidth, frameHeight, stride,
+      hg::util::PixelFormat::argb32, hg::util::ImageFileType::ppm,
+      fileOutTest1);
 
   // Compare our file with prototype.
   hg::filesystem::path fileTest1 = dataDir / "HtmlDocument_1.ppm";
-  EXPECT_TRUE(hg::util::compareFiles(fileTest1, fileOutTest1));
+  hg::util::ImageCompareResult result1 =
+      hg::util::compareImageFiles(fileTest1, fileOutTest1,
+          hg::util::ImageCompareOptions::antialiasing(),
+          fileOutTest1.string() + ".diff.ppm");
+  EXPECT_TRUE(result1.mMatched) << result1;
+}
+
+// Common part of the renderer set up for the tests below.
+void initHgHtmlRenderer(hg::HgHtmlRenderer& hgHtmlRenderer)
+{
+  hg::HgContainerPtr hgContainer = hgHtmlRenderer.getHgContainer();
+
+  std::string fontConfig = hg::util::readFile(fontDir / "fonts.conf");
+  ASSERT_FALSE(fontConfig.empty());
+  ASSERT_TRUE(hgContainer->parseAndLoadFontConfigFromMemory(fontConfig, true));
+
+  hgContainer->setFontTextCacheSize(1000);
+  hgContainer->setDefaultFontName("Tinos");
+  hgContainer->setDefaultFontSize(24);
+  ASSERT_TRUE(hgContainer->addFontDir(fontDir));
+
+  hgContainer->setDeviceDpiX(96);
+  hgContainer->setDeviceDpiY(96);
+  hgContainer->setDeviceMediaType(litehtml::media_type_screen);
+
+  std::string masterCss = hg::util::readFile(dataDir / "master.css");
+  ASSERT_FALSE(masterCss.empty());
+  hgHtmlRenderer.getHtmlContext()->load_master_stylesheet(masterCss.c_str());
+}
+
+TEST(HgHtmlRenderer, lastDrawStats)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+  std::vector<unsigned char> frameBuf(stride * frameHeight);
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+
+  std::string htmlText = hg::util::readFile(dataDir / "test.html");
+  ASSERT_FALSE(htmlText.empty());
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(htmlText);
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+
+  // Full draw.
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  const auto& stats = hgHtmlRenderer.lastDrawStats();
+  EXPECT_EQ(stats.mDrawCalls, 1);
+  EXPECT_EQ(stats.mCopiedBytes, 0u);
+  EXPECT_EQ(stats.mDrawnBytes, std::size_t(frameWidth * frameHeight * 4));
+
+  // Scroll down by 10 pixels, only the exposed strip is drawn.
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 10);
+  EXPECT_EQ(stats.mDrawCalls, 1);
+  EXPECT_EQ(
+      stats.mCopiedBytes, std::size_t(frameWidth * (frameHeight - 10) * 4));
+  EXPECT_EQ(stats.mDrawnBytes, std::size_t(frameWidth * 10 * 4));
+
+  // Nothing changed, nothing is drawn.
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 10);
+  EXPECT_EQ(stats.mDrawCalls, 0);
+  EXPECT_EQ(stats.mCopiedBytes + stats.mDrawnBytes, 0u);
+}
+
+TEST(HgHtmlRenderer, prerenderOverscan)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+  std::vector<unsigned char> frameBuf(stride * frameHeight);
+  std::vector<unsigned char> etalonBuf(stride * frameHeight);
+
+  std::string htmlText = hg::util::readFile(dataDir / "test.html");
+  ASSERT_FALSE(htmlText.empty());
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(htmlText);
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+  hgHtmlRenderer.setOverscanMargin(256);
+
+  hg::HgHtmlRenderer etalonRenderer;
+  initHgHtmlRenderer(etalonRenderer);
+  etalonRenderer.createHtmlDocumentFromUtf8(htmlText);
+  etalonRenderer.renderHtml(frameWidth, frameHeight);
+
+  // Nothing to prerender without the motion.
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_FALSE(hgHtmlRenderer.prerenderOverscan());
+
+  const auto& stats = hgHtmlRenderer.lastDrawStats();
+  for(int htmlY = 20; htmlY <= 200; htmlY += 20) {
+    hgHtmlRenderer.drawHtml(frameBuf.data(), colorFormat, frameWidth,
+        frameHeight, stride, 0, htmlY);
+    if(htmlY > 20) {
+      // The exposed strip is taken from the overscan.
+      EXPECT_EQ(stats.mDrawCalls, 0);
+      EXPECT_EQ(stats.mOverscanBytes, std::size_t(frameWidth * 20 * 4));
+    }
+    EXPECT_TRUE(hgHtmlRenderer.prerenderOverscan());
+
+    etalonRenderer.drawHtml(etalonBuf.data(), colorFormat, frameWidth,
+        frameHeight, stride, 0, htmlY);
+    EXPECT_TRUE(frameBuf == etalonBuf);
+  }
+}
+
+TEST(HgHtmlRenderer, draftQuality)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+  std::vector<unsigned char> frameBuf(stride * frameHeight);
+  std::vector<unsigned char> etalonBuf(stride * frameHeight);
+
+  std::string htmlText = hg::util::readFile(dataDir / "test.html");
+  ASSERT_FALSE(htmlText.empty());
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(htmlText);
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+  hgHtmlRenderer.setDraftQuality(
+      true, hg::HgCairo::skipDecorations | hg::HgCairo::skipImages);
+
+  hg::HgHtmlRenderer etalonRenderer;
+  initHgHtmlRenderer(etalonRenderer);
+  etalonRenderer.createHtmlDocumentFromUtf8(htmlText);
+  etalonRenderer.renderHtml(frameWidth, frameHeight);
+
+  // The first frame is not the motion.
+  const auto& stats = hgHtmlRenderer.lastDrawStats();
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_EQ(stats.mDraftCalls, 0);
+  EXPECT_FALSE(hgHtmlRenderer.refine());
+
+  // The exposed strips are draft.
+  for(int htmlY = 20; htmlY <= 100; htmlY += 20) {
+    hgHtmlRenderer.drawHtml(frameBuf.data(), colorFormat, frameWidth,
+        frameHeight, stride, 0, htmlY);
+    EXPECT_GT(stats.mDrawCalls, 0);
+    EXPECT_EQ(stats.mDraftCalls, stats.mDrawCalls);
+  }
+
+  // The motion stops, the viewport is redrawn with the full quality.
+  EXPECT_TRUE(hgHtmlRenderer.refine());
+  EXPECT_EQ(stats.mDrawCalls, 1);
+  EXPECT_EQ(stats.mDraftCalls, 0);
+  EXPECT_FALSE(hgHtmlRenderer.refine());
+
+  etalonRenderer.drawHtml(
+      etalonBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 100);
+  EXPECT_TRUE(frameBuf == etalonBuf);
+}
+
+TEST(HgHtmlRenderer, drawHtmlUntil)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+  std::vector<unsigned char> frameBuf(stride * frameHeight);
+  std::vector<unsigned char> etalonBuf(stride * frameHeight);
+
+  std::string htmlText = hg::util::readFile(dataDir / "test.html");
+  ASSERT_FALSE(htmlText.empty());
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(htmlText);
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+
+  hg::HgHtmlRenderer etalonRenderer;
+  initHgHtmlRenderer(etalonRenderer);
+  etalonRenderer.createHtmlDocumentFromUtf8(htmlText);
+  etalonRenderer.renderHtml(frameWidth, frameHeight);
+
+  // The deadline is reached, one tile of 6 is drawn, it is at the center.
+  const auto& stats = hgHtmlRenderer.lastDrawStats();
+  EXPECT_FALSE(hgHtmlRenderer.drawHtmlUntil(frameBuf.data(), colorFormat,
+      frameWidth, frameHeight, stride, 0, 0, hg::HgHtmlRenderer::Clock::now()));
+  EXPECT_EQ(stats.mDrawCalls, 1);
+  std::vector<litehtml::position> stale = hgHtmlRenderer.staleRects();
+  EXPECT_EQ(stale.size(), 5u);
+  for(const auto& rect : stale) {
+    EXPECT_FALSE(rect.x <= frameWidth / 2 && rect.right() > frameWidth / 2
+        && rect.y <= frameHeight / 2 && rect.bottom() > frameHeight / 2);
+  }
+
+  // The next calls go on, the stale tiles are scrolled.
+  int calls = 0;
+  while(!hgHtmlRenderer.drawHtmlUntil(frameBuf.data(), colorFormat,
+      frameWidth, frameHeight, stride, 0, 20,
+      hg::HgHtmlRenderer::Clock::now())) {
+    ASSERT_LT(++calls, 10);
+  }
+  EXPECT_TRUE(hgHtmlRenderer.staleRects().empty());
+
+  etalonRenderer.drawHtml(
+      etalonBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 20);
+  EXPECT_TRUE(frameBuf == etalonBuf);
+
+  // Without the deadline all is drawn.
+  EXPECT_TRUE(hgHtmlRenderer.drawHtmlUntil(frameBuf.data(), colorFormat,
+      frameWidth, frameHeight, stride, 0, 0,
+      hg::HgHtmlRenderer::Clock::now() + std::chrono::hours(1)));
+  etalonRenderer.drawHtml(
+      etalonBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_TRUE(frameBuf == etalonBuf);
+}
+
+TEST(HgHtmlRenderer, drawThumbnail)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int thumbWidth = frameWidth / 8;
+  const int thumbHeight = frameHeight / 8;
+  const int stride = cairo_format_stride_for_width(colorFormat, thumbWidth);
+  std::vector<uint32_t> thumbBuf(stride / 4 * thumbHeight, 0);
+
+  std::string htmlText = hg::util::readFile(dataDir / "test.html");
+  ASSERT_FALSE(htmlText.empty());
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(htmlText);
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+
+  unsigned char* thumbData = reinterpret_cast<unsigned char*>(thumbBuf.data());
+  hgHtmlRenderer.drawThumbnail(
+      thumbData, colorFormat, thumbWidth, thumbHeight, stride, 1.0 / 8);
+
+  // The white background in the body margin and the text bars.
+  EXPECT_EQ(0xFFFFFFFF, thumbBuf.front());
+  EXPECT_TRUE(std::any_of(thumbBuf.begin(), thumbBuf.end(),
+      [](uint32_t pixel) { return pixel != 0xFFFFFFFF; }));
+  // The main view is not drawn.
+  EXPECT_EQ(hgHtmlRenderer.lastDrawStats().mDrawCalls, 0);
+
+  EXPECT_THROW(hgHtmlRenderer.drawThumbnail(
+                   thumbData, colorFormat, thumbWidth, thumbHeight, stride, 0),
+      std::logic_error);
+
+  // The text bars are gray in any text color.
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(
+      "<html><body><p style=\"color: #FF0000\">Red text</p></body></html>");
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+  std::fill(thumbBuf.begin(), thumbBuf.end(), 0);
+  hgHtmlRenderer.drawThumbnail(
+      thumbData, colorFormat, thumbWidth, thumbHeight, stride, 1.0 / 8);
+  EXPECT_TRUE(std::any_of(thumbBuf.begin(), thumbBuf.end(),
+      [](uint32_t pixel) { return pixel != 0xFFFFFFFF; }));
+  EXPECT_TRUE(std::all_of(thumbBuf.begin(), thumbBuf.end(), [](uint32_t pixel) {
+    return (pixel >> 16 & 0xFF) == (pixel & 0xFF)
+        && (pixel >> 8 & 0xFF) == (pixel & 0xFF);
+  }));
+}
+
+TEST(HgHtmlRenderer, concurrentViews)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+
+  std::string htmlText = hg::util::readFile(dataDir / "test.html");
+  ASSERT_FALSE(htmlText.empty());
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(htmlText);
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+
+  // Etalon frames drawn by the main view.
+  const int viewCount = 4;
+  std::vector<std::vector<unsigned char>> etalonBufs(viewCount);
+  for(int i = 0; i < viewCount; ++i) {
+    etalonBufs[i].resize(stride * frameHeight);
+    hgHtmlRenderer.drawHtml(etalonBufs[i].data(), colorFormat, frameWidth,
+        frameHeight, stride, 0, i * 100);
+  }
+
+  // The same frames drawn by the concurrent views of the same document.
+  std::vector<std::vector<unsigned char>> frameBufs(viewCount);
+  std::vector<std::thread> threads;
+  for(int i = 0; i < viewCount; ++i) {
+    frameBufs[i].resize(stride * frameHeight);
+    hg::HgHtmlViewPtr view = hgHtmlRenderer.newView();
+    threads.emplace_back([&frameBufs, view, i, colorFormat, stride]() {
+      for(int htmlY = 0; htmlY <= i * 100; htmlY += 10) {
+        view->drawHtml(frameBufs[i].data(), colorFormat, frameWidth,
+            frameHeight, stride, 0, htmlY);
+      }
+    });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+
+  for(int i = 0; i < viewCount; ++i) {
+    EXPECT_TRUE(frameBufs[i] == etalonBufs[i]);
+  }
+}
+
+TEST(HgHtmlRenderer, sharedEngine)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+
+  std::string htmlText = hg::util::readFile(dataDir / "test.html");
+  ASSERT_FALSE(htmlText.empty());
+
+  // Etalon frame drawn by the renderer with its own engine.
+  hg::HgHtmlRenderer etalonRenderer;
+  initHgHtmlRenderer(etalonRenderer);
+  etalonRenderer.createHtmlDocumentFromUtf8(htmlText);
+  etalonRenderer.renderHtml(frameWidth, frameHeight);
+  std::vector<unsigned char> etalonBuf(stride * frameHeight);
+  etalonRenderer.drawHtml(etalonBuf.data(), colorFormat, frameWidth,
+      frameHeight, stride, 0, 0);
+
+  // The fonts and the master CSS are loaded once for both renderers.
+  hg::HgEnginePtr engine = std::make_shared<hg::HgEngine>();
+  hg::HgHtmlRenderer hgHtmlRenderer1(engine);
+  initHgHtmlRenderer(hgHtmlRenderer1);
+
+  hg::HgHtmlRenderer hgHtmlRenderer2(engine);
+  hg::HgContainerPtr hgContainer2 = hgHtmlRenderer2.getHgContainer();
+  hgContainer2->setDefaultFontName("Tinos");
+  hgContainer2->setDefaultFontSize(24);
+  hgContainer2->setDeviceDpiX(96);
+  hgContainer2->setDeviceDpiY(96);
+  hgContainer2->setDeviceMediaType(litehtml::media_type_screen);
+  EXPECT_EQ(
+      hgHtmlRenderer1.getHtmlContext(), hgHtmlRenderer2.getHtmlContext());
+  // The images are decoded once by the pool of the engine.
+  EXPECT_EQ(hgHtmlRenderer1.getHgContainer()->getImageCache(),
+      hgContainer2->getImageCache());
+  EXPECT_NE(etalonRenderer.getHgContainer()->getImageCache(),
+      hgContainer2->getImageCache());
+
+  std::vector<unsigned char> frameBuf(stride * frameHeight);
+  for(hg::HgHtmlRenderer* renderer : {&hgHtmlRenderer1, &hgHtmlRenderer2}) {
+    renderer->createHtmlDocumentFromUtf8(htmlText);
+    renderer->renderHtml(frameWidth, frameHeight);
+    renderer->drawHtml(
+        frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+    EXPECT_TRUE(frameBuf == etalonBuf);
+  }
+
+  // The pooled font is shared by the requests of the same face.
+  hg::HgFontPtr font1 =
+      engine->getFont("Tinos", 24, 400, litehtml::fontStyleNormal);
+  hg::HgFontPtr font2 =
+      engine->getFont("Tinos", 24, 400, litehtml::fontStyleNormal);
+  ASSERT_TRUE(font1);
+  EXPECT_EQ(font1, font2);
+  EXPECT_FALSE(
+      engine->getFont("NoSuchFont", 24, 400, litehtml::fontStyleNormal));
+}
+
+TEST(HgHtmlRenderer, createFromFile)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+
+  std::string htmlText = hg::util::readFile(dataDir / "test.html");
+  ASSERT_FALSE(htmlText.empty());
+
+  hg::HgHtmlRenderer etalonRenderer;
+  initHgHtmlRenderer(etalonRenderer);
+  etalonRenderer.createHtmlDocumentFromUtf8(htmlText);
+  etalonRenderer.renderHtml(frameWidth, frameHeight);
+  std::vector<unsigned char> etalonBuf(stride * frameHeight);
+  etalonRenderer.drawHtml(etalonBuf.data(), colorFormat, frameWidth,
+      frameHeight, stride, 0, 0);
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  std::vector<unsigned char> frameBuf(stride * frameHeight);
+
+  // The mapped file.
+  ASSERT_TRUE(hgHtmlRenderer.createHtmlDocumentFromFile(dataDir / "test.html"));
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_TRUE(frameBuf == etalonBuf);
+
+  // The text is not null terminated.
+  std::string paddedText = htmlText + "<p>Not parsed.</p>";
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(
+      paddedText.data(), htmlText.size());
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_TRUE(frameBuf == etalonBuf);
+
+  EXPECT_FALSE(
+      hgHtmlRenderer.createHtmlDocumentFromFile(dataDir / "no_such.html"));
+}
+
+// Independent documents are parsed, laid out and drawn concurrently,
+// with own engines and with the shared engine.
+// Run with -DUSE_TSAN=ON to check for the data races.
+TEST(HgHtmlRenderer, concurrentDocuments)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+
+  std::string htmlText = hg::util::readFile(dataDir / "test.html");
+  ASSERT_FALSE(htmlText.empty());
+
+  hg::HgHtmlRenderer etalonRenderer;
+  initHgHtmlRenderer(etalonRenderer);
+  etalonRenderer.createHtmlDocumentFromUtf8(htmlText);
+  etalonRenderer.renderHtml(frameWidth, frameHeight);
+  std::vector<unsigned char> etalonBuf(stride * frameHeight);
+  etalonRenderer.drawHtml(etalonBuf.data(), colorFormat, frameWidth,
+      frameHeight, stride, 0, 0);
+
+  hg::HgEnginePtr sharedEngine = std::make_shared<hg::HgEngine>();
+  hg::HgHtmlRenderer sharedInitRenderer(sharedEngine);
+  initHgHtmlRenderer(sharedInitRenderer);
+
+  const int threadCount = 8;
+  const int iterations = 10;
+  std::vector<std::vector<unsigned char>> frameBufs(threadCount);
+  std::vector<std::thread> threads;
+  for(int i = 0; i < threadCount; ++i) {
+    frameBufs[i].resize(stride * frameHeight);
+    hg::HgEnginePtr engine = (i % 2) ? sharedEngine : nullptr;
+    threads.emplace_back([&frameBufs, &htmlText, engine, i, colorFormat,
+                             stride]() {
+      for(int j = 0; j < iterations; ++j) {
+        std::shared_ptr<hg::HgHtmlRenderer> renderer;
+        if(engine) {
+          renderer = std::make_shared<hg::HgHtmlRenderer>(engine);
+          hg::HgContainerPtr hgContainer = renderer->getHgContainer();
+          hgContainer->setDefaultFontName("Tinos");
+          hgContainer->setDefaultFontSize(24);
+          hgContainer->setDeviceDpiX(96);
+          hgContainer->setDeviceDpiY(96);
+          hgContainer->setDeviceMediaType(litehtml::media_type_screen);
+        } else {
+          renderer = std::make_shared<hg::HgHtmlRenderer>();
+          initHgHtmlRenderer(*renderer);
+        }
+        renderer->createHtmlDocumentFromUtf8(htmlText);
+        renderer->renderHtml(frameWidth, frameHeight);
+        renderer->drawHtml(frameBufs[i].data(), colorFormat, frameWidth,
+            frameHeight, stride, 0, 0);
+      }
+    });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+
+  for(int i = 0; i < threadCount; ++i) {
+    EXPECT_TRUE(frameBufs[i] == etalonBuf);
+  }
+}
+
+TEST(HgHtmlRenderer, hitTest)
+{
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+
+  hg::HgTextIndex::HitTestResult result;
+  EXPECT_FALSE(hgHtmlRenderer.hitTest(0, 0, result));
+
+  std::string htmlText = hg::util::readFile(dataDir / "test.html");
+  ASSERT_FALSE(htmlText.empty());
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(htmlText);
+  hgHtmlRenderer.renderHtml(320, 240);
+
+  const hg::HgTextIndex& textIndex =
+      hgHtmlRenderer.getDocument()->textIndex();
+  ASSERT_FALSE(textIndex.isEmpty());
+
+  std::size_t textOffset = 0;
+  for(std::size_t i = 0; i < textIndex.runs().size(); ++i) {
+    const hg::HgTextIndex::TextRun& run = textIndex.runs()[i];
+    EXPECT_EQ(textOffset, run.mTextOffset);
+    textOffset += run.mLength;
+
+    const int y = run.mBox.y + run.mBox.height / 2;
+
+    // The run start.
+    ASSERT_TRUE(hgHtmlRenderer.hitTest(run.mBox.x, y, result));
+    EXPECT_EQ(i, result.mRunIndex);
+    EXPECT_EQ(0u, result.mCharOffset);
+    EXPECT_EQ(run.mTextOffset, result.mTextOffset);
+    EXPECT_EQ(run.mBox.x, result.mCaret.x);
+    EXPECT_EQ(run.mBox.y, result.mCaret.y);
+    EXPECT_EQ(run.mBox.height, result.mCaret.height);
+
+    // The run end.
+    ASSERT_TRUE(hgHtmlRenderer.hitTest(run.mBox.right() - 1, y, result));
+    EXPECT_EQ(i, result.mRunIndex);
+    EXPECT_EQ(run.mLength, result.mCharOffset);
+  }
+  EXPECT_EQ(textOffset, textIndex.textLength());
+
+  // Below the text is the text end.
+  ASSERT_TRUE(hgHtmlRenderer.hitTest(0, 100000, result));
+  const hg::HgTextIndex::TextRun& lastRun =
+      textIndex.runs()[result.mRunIndex];
+  EXPECT_EQ(lastRun.mTextOffset + lastRun.mLength, result.mTextOffset);
+}
+
+TEST(HgHtmlRenderer, editText)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+
+  auto html = [](const std::string& firstParagraph) {
+    return "<html><body><p>" + firstParagraph
+        + "</p><p>Second paragraph text.</p>"
+          "<div><p>Far paragraph text.</p></div></body></html>";
+  };
+
+  // Draws the document as it was created from the HTML.
+  auto drawEtalon = [&](const std::string& htmlText) {
+    hg::HgHtmlRenderer etalonRenderer;
+    initHgHtmlRenderer(etalonRenderer);
+    etalonRenderer.createHtmlDocumentFromUtf8(htmlText);
+    etalonRenderer.renderHtml(frameWidth, frameHeight);
+    std::vector<unsigned char> etalonBuf(stride * frameHeight);
+    etalonRenderer.drawHtml(etalonBuf.data(), colorFormat, frameWidth,
+        frameHeight, stride, 0, 0);
+    return etalonBuf;
+  };
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(html("First paragraph text."));
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+  std::vector<unsigned char> frameBuf(stride * frameHeight);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+
+  const hg::HgTextIndex& textIndex =
+      hgHtmlRenderer.getDocument()->textIndex();
+  ASSERT_FALSE(textIndex.isEmpty());
+  const hg::HgTextIndex::TextRun& firstRun = textIndex.runs()[0];
+  ASSERT_EQ("First", firstRun.mText);
+  litehtml::element::ptr paragraph = firstRun.mElement->parent();
+
+  // The block height is not changed, only the block is redrawn.
+  litehtml::position damage =
+      hgHtmlRenderer.insertText(firstRun.mElement, 5, "ly");
+  EXPECT_GT(damage.width, 0);
+  EXPECT_GT(damage.height, 0);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_LT(hgHtmlRenderer.lastDrawStats().mDrawnBytes,
+      static_cast<std::size_t>(stride) * frameHeight);
+  EXPECT_TRUE(frameBuf == drawEtalon(html("Firstly paragraph text.")));
+
+  // The text index is rebuilt on the next use.
+  const hg::HgTextIndex& editedIndex =
+      hgHtmlRenderer.getDocument()->textIndex();
+  EXPECT_EQ("Firstly", editedIndex.runs()[0].mText);
+
+  hgHtmlRenderer.deleteText(editedIndex.runs()[0].mElement, 0, 2);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_TRUE(frameBuf == drawEtalon(html("rstly paragraph text.")));
+
+  // The block height is changed, the blocks below are moved
+  // without their layout.
+  litehtml::element::ptr farText =
+      hgHtmlRenderer.getDocument()->textIndex().runs().back().mElement;
+  litehtml::element::ptr farParagraph = farText->parent();
+  const int oldTop = paragraph->parent()->get_placement().y + paragraph->top();
+  const int oldHeight = paragraph->height();
+  const int oldFarY = farParagraph->get_placement().y;
+  // The far paragraph layout would restore the text position.
+  const int farTextX = farText->get_position().x;
+  farText->get_position().x = farTextX + 1000;
+
+  std::string longText =
+      "The long text of the first paragraph which takes some lines.";
+  damage = hgHtmlRenderer.setText(paragraph, longText);
+  const int delta = paragraph->height() - oldHeight;
+  EXPECT_GT(delta, 0);
+  EXPECT_EQ(oldFarY + delta, farParagraph->get_placement().y);
+  EXPECT_EQ(farTextX + 1000, farText->get_position().x);
+  EXPECT_EQ(oldTop, damage.y);
+  EXPECT_GE(damage.bottom(), hgHtmlRenderer.getDocument()->height());
+  farText->get_position().x = farTextX;
+
+  // The text index is updated by the edits as it is built again.
+  const hg::HgTextIndex& updatedIndex =
+      hgHtmlRenderer.getDocument()->textIndex();
+  hg::HgTextIndex builtIndex;
+  builtIndex.build(hgHtmlRenderer.getDocument()->getHtmlDocument());
+  EXPECT_EQ(builtIndex.text(), updatedIndex.text());
+  EXPECT_EQ(builtIndex.textLength(), updatedIndex.textLength());
+  ASSERT_EQ(builtIndex.runs().size(), updatedIndex.runs().size());
+  for(std::size_t i = 0; i < builtIndex.runs().size(); ++i) {
+    const hg::HgTextIndex::TextRun& builtRun = builtIndex.runs()[i];
+    const hg::HgTextIndex::TextRun& updatedRun = updatedIndex.runs()[i];
+    EXPECT_EQ(builtRun.mElement, updatedRun.mElement);
+    EXPECT_EQ(builtRun.mBox.x, updatedRun.mBox.x);
+    EXPECT_EQ(builtRun.mBox.y, updatedRun.mBox.y);
+    EXPECT_EQ(builtRun.mBox.height, updatedRun.mBox.height);
+    EXPECT_EQ(builtRun.mTextOffset, updatedRun.mTextOffset);
+  }
+  hg::HgTextIndex::HitTestResult builtHit;
+  hg::HgTextIndex::HitTestResult updatedHit;
+  const litehtml::position farBox = farParagraph->get_placement();
+  ASSERT_TRUE(builtIndex.hitTest(farBox.x + 1, farBox.y + 1, builtHit));
+  ASSERT_TRUE(hgHtmlRenderer.hitTest(farBox.x + 1, farBox.y + 1, updatedHit));
+  EXPECT_EQ(builtHit.mTextOffset, updatedHit.mTextOffset);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_TRUE(frameBuf == drawEtalon(html(longText)));
+}
+
+TEST(HgHtmlRenderer, overlays)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+
+  std::string htmlText = hg::util::readFile(dataDir / "test.html");
+  ASSERT_FALSE(htmlText.empty());
+
+  hg::HgHtmlRenderer etalonRenderer;
+  initHgHtmlRenderer(etalonRenderer);
+  etalonRenderer.createHtmlDocumentFromUtf8(htmlText);
+  etalonRenderer.renderHtml(frameWidth, frameHeight);
+  std::vector<unsigned char> etalonBuf(stride * frameHeight);
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(htmlText);
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+  std::vector<unsigned char> frameBuf(stride * frameHeight);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+
+  // The caret is drawn without the document drawing.
+  const litehtml::web_color caretColor(255, 0, 0);
+  hgHtmlRenderer.setOverlay(hg::HgHtmlView::caretLayer,
+      {litehtml::position(10, 10, 2, 20)}, caretColor);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_EQ(0u, hgHtmlRenderer.lastDrawStats().mDrawnBytes);
+  EXPECT_EQ(0, hgHtmlRenderer.lastDrawStats().mDrawCalls);
+  EXPECT_EQ(2u * 20 * 4, hgHtmlRenderer.lastDrawStats().mOverlayBytes);
+  const uint32_t* pixel =
+      reinterpret_cast<const uint32_t*>(frameBuf.data() + 15 * stride) + 11;
+  EXPECT_EQ(0xFFFF0000u, *pixel);
+
+  // The blink restores the document pixels.
+  hgHtmlRenderer.setOverlayVisible(hg::HgHtmlView::caretLayer, false);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_EQ(0u, hgHtmlRenderer.lastDrawStats().mDrawnBytes);
+  etalonRenderer.drawHtml(
+      etalonBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_TRUE(frameBuf == etalonBuf);
+
+  // The blink with many search matches touches the caret rect only.
+  std::vector<litehtml::position> matchRects;
+  for(int y = 100; y < 200; y += 10) {
+    for(int x = 0; x < 300; x += 20) {
+      matchRects.emplace_back(x, y, 15, 8);
+    }
+  }
+  hgHtmlRenderer.setOverlay(hg::HgHtmlView::searchLayer, matchRects,
+      litehtml::web_color(255, 255, 0, 128));
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_EQ(matchRects.size() * 15 * 8 * 4,
+      hgHtmlRenderer.lastDrawStats().mOverlayBytes);
+  hgHtmlRenderer.setOverlayVisible(hg::HgHtmlView::caretLayer, true);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_EQ(2u * 20 * 4, hgHtmlRenderer.lastDrawStats().mOverlayBytes);
+  hgHtmlRenderer.setOverlayVisible(hg::HgHtmlView::caretLayer, false);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_EQ(2u * 20 * 4, hgHtmlRenderer.lastDrawStats().mOverlayBytes);
+
+  // The caret over a match restores and draws the match too.
+  hgHtmlRenderer.setOverlay(hg::HgHtmlView::caretLayer,
+      {litehtml::position(25, 100, 2, 20)}, caretColor);
+  hgHtmlRenderer.setOverlayVisible(hg::HgHtmlView::caretLayer, true);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_EQ(2u * 20 * 4 + 2 * 2 * 15 * 8 * 4,
+      hgHtmlRenderer.lastDrawStats().mOverlayBytes);
+  hgHtmlRenderer.setOverlay(hg::HgHtmlView::searchLayer, {}, caretColor);
+  hgHtmlRenderer.setOverlayVisible(hg::HgHtmlView::caretLayer, false);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_TRUE(frameBuf == etalonBuf);
+  hgHtmlRenderer.setOverlay(hg::HgHtmlView::caretLayer,
+      {litehtml::position(10, 10, 2, 20)}, caretColor);
+
+  // The overlays are moved with the scrolled document.
+  hgHtmlRenderer.setOverlayVisible(hg::HgHtmlView::caretLayer, true);
+  hgHtmlRenderer.setOverlay(hg::HgHtmlView::selectionLayer,
+      {litehtml::position(0, 30, 100, 20), litehtml::position(0, 40, 50, 20)},
+      litehtml::web_color(0, 0, 255, 128));
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 15);
+  pixel = reinterpret_cast<const uint32_t*>(frameBuf.data()) + 11;
+  EXPECT_EQ(0xFFFF0000u, *pixel);
+
+  hgHtmlRenderer.setOverlay(hg::HgHtmlView::caretLayer, {}, caretColor);
+  hgHtmlRenderer.setOverlay(
+      hg::HgHtmlView::selectionLayer, {}, caretColor);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 15);
+  etalonRenderer.drawHtml(
+      etalonBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 15);
+  EXPECT_TRUE(frameBuf == etalonBuf);
+}
+
+TEST(HgHtmlRenderer, findText)
+{
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(
+      "<html><body><p>Find the text, find THE text.</p>"
+      "<p>The end.</p></body></html>");
+  hgHtmlRenderer.renderHtml(320, 240);
+
+  const hg::HgTextIndex& textIndex =
+      hgHtmlRenderer.getDocument()->textIndex();
+  ASSERT_FALSE(textIndex.isEmpty());
+
+  // The matches in the words and across the spaces.
+  hg::HgTextIndex::TextMatchVector matches = hgHtmlRenderer.findAll("the");
+  ASSERT_EQ(1u, matches.size());
+  EXPECT_EQ(5u, matches[0].mTextOffset);
+  EXPECT_EQ(3u, matches[0].mLength);
+  ASSERT_EQ(1u, matches[0].mRects.size());
+
+  matches = hgHtmlRenderer.findAll("the", false);
+  ASSERT_EQ(3u, matches.size());
+  EXPECT_EQ(5u, matches[0].mTextOffset);
+  EXPECT_EQ(20u, matches[1].mTextOffset);
+  EXPECT_EQ(30u, matches[2].mTextOffset);
+  EXPECT_EQ(1u, hgHtmlRenderer.findAll("the", false, 1).size());
+
+  matches = hgHtmlRenderer.findAll("the text");
+  ASSERT_EQ(1u, matches.size());
+  EXPECT_EQ(3u, matches[0].mRects.size());
+  EXPECT_LT(matches[0].mRects.front().x, matches[0].mRects.back().x);
+  EXPECT_EQ(matches[0].mRects.front().y, matches[0].mRects.back().y);
+
+  // The match rects are within the run boxes.
+  for(const auto& match : hgHtmlRenderer.findAll("text", false)) {
+    hg::HgTextIndex::HitTestResult result;
+    const litehtml::position& rect = match.mRects[0];
+    ASSERT_TRUE(hgHtmlRenderer.hitTest(
+        rect.x + 1, rect.y + rect.height / 2, result));
+    EXPECT_EQ(match.mTextOffset, result.mTextOffset);
+    const litehtml::position& box = textIndex.runs()[result.mRunIndex].mBox;
+    EXPECT_GE(rect.left(), box.left());
+    EXPECT_LE(rect.right(), box.right());
+    EXPECT_GT(rect.width, 0);
+  }
+
+  // The next match wraps around the text end.
+  hg::HgTextIndex::TextMatch match;
+  ASSERT_TRUE(textIndex.findNext("find", 1, false, match));
+  EXPECT_EQ(15u, match.mTextOffset);
+  ASSERT_TRUE(textIndex.findNext("find", 16, false, match));
+  EXPECT_EQ(0u, match.mTextOffset);
+  EXPECT_FALSE(textIndex.findNext("missed", 0, false, match));
+  EXPECT_TRUE(hgHtmlRenderer.findAll("").empty());
+
+  // The highlight is drawn by the search overlay.
+  hgHtmlRenderer.highlightMatches(
+      hgHtmlRenderer.findAll("end"), litehtml::web_color(255, 255, 0, 128));
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int stride = cairo_format_stride_for_width(colorFormat, 320);
+  std::vector<unsigned char> frameBuf(stride * 240);
+  hgHtmlRenderer.drawHtml(frameBuf.data(), colorFormat, 320, 240, stride, 0, 0);
+  EXPECT_GT(hgHtmlRenderer.lastDrawStats().mOverlayBytes, 0u);
+}
+
+TEST(HgHtmlRenderer, zoom)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+
+  std::string htmlText = hg::util::readFile(dataDir / "test.html");
+  ASSERT_FALSE(htmlText.empty());
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(htmlText);
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+  std::vector<unsigned char> frameBuf(stride * frameHeight);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  const std::vector<unsigned char> unzoomedBuf = frameBuf;
+
+  // The preview scales the raster without the document drawing.
+  hgHtmlRenderer.setZoomPreview(1.0, 100, 100);
+  EXPECT_TRUE(hgHtmlRenderer.getView()->isZoomPreview());
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_EQ(0, hgHtmlRenderer.lastDrawStats().mDrawCalls);
+  EXPECT_EQ(static_cast<std::size_t>(stride) * frameHeight,
+      hgHtmlRenderer.lastDrawStats().mScaledBytes);
+  EXPECT_TRUE(frameBuf == unzoomedBuf);
+
+  hgHtmlRenderer.setZoomPreview(2.0, 100, 100);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_EQ(0, hgHtmlRenderer.lastDrawStats().mDrawCalls);
+  EXPECT_FALSE(frameBuf == unzoomedBuf);
+
+  // The settled zoom keeps the focus and draws the cached layout scaled.
+  int htmlX;
+  int htmlY;
+  const int documentHeight = hgHtmlRenderer.getDocument()->height();
+  hgHtmlRenderer.endZoomPreview(false, htmlX, htmlY);
+  EXPECT_FALSE(hgHtmlRenderer.getView()->isZoomPreview());
+  EXPECT_EQ(2.0, hgHtmlRenderer.zoom());
+  EXPECT_EQ(100, htmlX);
+  EXPECT_EQ(100, htmlY);
+  EXPECT_EQ(documentHeight, hgHtmlRenderer.getDocument()->height());
+  hgHtmlRenderer.drawHtml(frameBuf.data(), colorFormat, frameWidth,
+      frameHeight, stride, htmlX, htmlY);
+  EXPECT_GT(hgHtmlRenderer.lastDrawStats().mDrawCalls, 0);
+
+  hg::HgHtmlViewPtr zoomedView = hgHtmlRenderer.newView();
+  zoomedView->setZoom(2.0);
+  std::vector<unsigned char> zoomedBuf(stride * frameHeight);
+  zoomedView->drawHtml(zoomedBuf.data(), colorFormat, frameWidth,
+      frameHeight, stride, htmlX, htmlY);
+  EXPECT_TRUE(frameBuf == zoomedBuf);
+
+  // The text zoom wraps the text to the view width.
+  hgHtmlRenderer.setZoom(2.0, true);
+  EXPECT_LE(hgHtmlRenderer.getDocument()->width(), frameWidth / 2);
+  EXPECT_GE(hgHtmlRenderer.getDocument()->height(), documentHeight);
+
+  hgHtmlRenderer.setZoom(1.0, true);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  EXPECT_TRUE(frameBuf == unzoomedBuf);
+}
+
+TEST(HgHtmlRenderer, pager)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int pageWidth = 320;
+  const int pageHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, pageWidth);
+
+  std::string htmlText = "<html><body>";
+  for(int i = 0; i < 50; ++i) {
+    htmlText += "<p>The paragraph " + std::to_string(i)
+        + " with the text which takes some lines of the page.</p>";
+  }
+  htmlText += "</body></html>";
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(htmlText);
+
+  hg::HgHtmlPagerPtr pager = hgHtmlRenderer.newPager();
+  std::vector<unsigned char> pageBuf(stride * pageHeight);
+  EXPECT_FALSE(pager->drawPage(
+      0, pageBuf.data(), colorFormat, pageWidth, pageHeight, stride));
+
+  pager->paginate(pageWidth, pageHeight);
+  pager->waitPaginated();
+  ASSERT_TRUE(pager->isPaginated());
+  const int pageCount = pager->pageCount();
+  ASSERT_GT(pageCount, 1);
+
+  // The pages follow each other and do not cut the lines.
+  const hg::HgTextIndex& textIndex =
+      hgHtmlRenderer.getDocument()->textIndex();
+  int top = 0;
+  for(int page = 0; page < pageCount; ++page) {
+    litehtml::position rect;
+    ASSERT_TRUE(pager->getPageRect(page, rect));
+    EXPECT_EQ(top, rect.y);
+    EXPECT_GT(rect.height, 0);
+    EXPECT_LE(rect.height, pageHeight);
+    top = rect.bottom();
+    for(const auto& run : textIndex.runs()) {
+      EXPECT_FALSE(run.mBox.top() < top && run.mBox.bottom() > top);
+    }
+  }
+  EXPECT_EQ(hgHtmlRenderer.getDocument()->height(), top);
+
+  // The prerendered pages are the same as the drawn ones.
+  hg::HgHtmlPagerPtr directPager = hgHtmlRenderer.newPager();
+  directPager->setPrefetchRadius(0);
+  directPager->paginate(pageWidth, pageHeight);
+  directPager->waitPaginated();
+  ASSERT_EQ(pageCount, directPager->pageCount());
+
+  std::vector<unsigned char> directBuf(stride * pageHeight);
+  for(int page = 0; page < pageCount; ++page) {
+    ASSERT_TRUE(pager->drawPage(
+        page, pageBuf.data(), colorFormat, pageWidth, pageHeight, stride));
+    ASSERT_TRUE(directPager->drawPage(
+        page, directBuf.data(), colorFormat, pageWidth, pageHeight, stride));
+    EXPECT_FALSE(directPager->lastDrawPrefetched());
+    EXPECT_TRUE(pageBuf == directBuf);
+  }
+  EXPECT_FALSE(pager->drawPage(
+      pageCount, pageBuf.data(), colorFormat, pageWidth, pageHeight, stride));
+}
+
+TEST(HgHtmlRenderer, exporter)
+{
+  std::string htmlText = "<html><body>";
+  for(int i = 0; i < 30; ++i) {
+    htmlText += "<p>The paragraph " + std::to_string(i)
+        + " with the text which takes some lines of the page.</p>";
+  }
+  htmlText += "</body></html>";
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  hgHtmlRenderer.createHtmlDocumentFromUtf8(htmlText);
+
+  auto fileStarts = [](const hg::filesystem::path& filePath,
+                        const std::string& signature) {
+    std::string content = hg::util::readFile(filePath);
+    return content.compare(0, signature.size(), signature) == 0;
+  };
+
+  std::shared_ptr<hg::HgHtmlExporter> exporter =
+      hgHtmlRenderer.newExporter();
+  exporter->setPageSize(320, 240);
+  exporter->setThreadPool(std::make_shared<hg::util::ThreadPool>(4));
+
+  hg::filesystem::path pdfPath = testDir / "HgHtmlExporter.pdf";
+  ASSERT_TRUE(exporter->exportPdf(pdfPath));
+  const int pageCount = exporter->pageCount();
+  EXPECT_GT(pageCount, 1);
+  EXPECT_TRUE(fileStarts(pdfPath, "%PDF"));
+
+  // One PNG file per page.
+  hg::filesystem::path pngPrefix = testDir / "HgHtmlExporter";
+  ASSERT_TRUE(exporter->exportPng(pngPrefix));
+  EXPECT_EQ(pageCount, exporter->pageCount());
+  for(int i = 1; i <= pageCount; ++i) {
+    hg::filesystem::path pngPath =
+        pngPrefix.string() + "-" + std::to_string(i) + ".png";
+    EXPECT_TRUE(fileStarts(pngPath, "\x89PNG"));
+  }
+
+  // The pages are broken as by the pager.
+  hg::HgHtmlPagerPtr pager = hgHtmlRenderer.newPager();
+  pager->paginate(320, 240);
+  pager->waitPaginated();
+  EXPECT_EQ(pageCount, pager->pageCount());
+
+  // The full length document is one page.
+  exporter->setFullLength(true);
+  ASSERT_TRUE(exporter->exportPng(pngPrefix.string() + "-full"));
+  EXPECT_EQ(1, exporter->pageCount());
+  EXPECT_TRUE(fileStarts(pngPrefix.string() + "-full-1.png", "\x89PNG"));
+
+  // The full length PNG is streamed by the bands.
+  exporter->setBandHeight(17);
+  ASSERT_TRUE(exporter->exportPng(pngPrefix.string() + "-bands"));
+  EXPECT_TRUE(hg::util::compareFiles(pngPrefix.string() + "-full-1.png",
+      pngPrefix.string() + "-bands-1.png"));
+}
+
+TEST(HgHtmlRenderer, images)
+{
+  const cairo_format_t colorFormat = CAIRO_FORMAT_ARGB32;
+  const int frameWidth = 320;
+  const int frameHeight = 240;
+  const int stride = cairo_format_stride_for_width(colorFormat, frameWidth);
+
+  // The opaque red image and the document next to it.
+  const uint32_t red = 0xFFFF0000;
+  std::vector<uint32_t> image(20 * 10, red);
+  ASSERT_TRUE(hg::util::writePngFile(
+      reinterpret_cast<const unsigned char*>(image.data()), 20, 10, 20 * 4,
+      true, testDir / "HgHtmlRenderer_image.png"));
+  hg::filesystem::path htmlPath = testDir / "HgHtmlRenderer_image.html";
+  FILE* htmlFile = fopen(htmlPath.string().c_str(), "wb");
+  ASSERT_TRUE(htmlFile);
+  fputs("<html><body><img src=\"HgHtmlRenderer_image.png\"><p>Text</p>"
+        "</body></html>",
+      htmlFile);
+  fclose(htmlFile);
+
+  hg::HgHtmlRenderer hgHtmlRenderer;
+  initHgHtmlRenderer(hgHtmlRenderer);
+  hg::HgImageCachePtr imageCache =
+      hgHtmlRenderer.getHgContainer()->getImageCache();
+  std::atomic<int> readyCount(0);
+  hgHtmlRenderer.getHgContainer()->setImageReadyCallback(
+      [&readyCount](const std::string&) { ++readyCount; });
+
+  // The layout takes the image size from the PNG header.
+  ASSERT_TRUE(hgHtmlRenderer.createHtmlDocumentFromFile(htmlPath));
+  hgHtmlRenderer.renderHtml(frameWidth, frameHeight);
+  litehtml::element::ptr img =
+      hgHtmlRenderer.getHtmlDocument()->root()->select_one(_t("img"));
+  ASSERT_TRUE(img);
+  EXPECT_EQ(20, img->width());
+  EXPECT_EQ(10, img->height());
+
+  std::vector<unsigned char> frameBuf(stride * frameHeight);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+
+  // The decoded image is drawn by the next drawing.
+  imageCache->waitDecoded();
+  EXPECT_EQ(1, readyCount);
+  hgHtmlRenderer.drawHtml(
+      frameBuf.data(), colorFormat, frameWidth, frameHeight, stride, 0, 0);
+  int redPixels = 0;
+  for(int y = 0; y < frameHeight; ++y) {
+    for(int x = 0; x < frameWidth; ++x) {
+      uint32_t pixel;
+      std::memcpy(&pixel, frameBuf.data() + y * stride + x * 4, 4);
+      if(pixel == red) {
+        ++redPixels;
+      }
+    }
+  }
+  EXPECT_EQ(20 * 10, redPixels);
 }
@@ -0,0 +1,827 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/renderer/HgHtmlView.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+//#include <chrono>
+//#include <iostream>
+
+namespace hg
+{
+namespace
+{
+litehtml::position intersect(
+    const litehtml::position& rect1, const litehtml::position& rect2)
+{
+  int left = std::max(rect1.left(), rect2.left());
+  int top = std::max(rect1.top(), rect2.top());
+  int right = std::min(rect1.right(), rect2.right());
+  int bottom = std::min(rect1.bottom(), rect2.bottom());
+  if(right <= left || bottom <= top) {
+    return litehtml::position();
+  }
+  return litehtml::position(left, top, right - left, bottom - top);
+}
+}  // namespace
+
+HgHtmlView::HgHtmlView(HgHtmlDocumentConstPtr document)
+    : mBackgroundColor(255, 255, 255)
+    , mPlaceholderColor(238, 238, 238)
+    , mDocument(document)
+    , mLayoutVersion(0)
+    , mImageVersion(0)
+    , mBuffer(nullptr)
+    , mBufferWidth(0)
+    , mBufferHeight(0)
+    , mBufferStride(0)
+    , mHtmlX(0)
+    , mHtmlY(0)
+    , mColorFormat(CAIRO_FORMAT_INVALID)
+    , mBytesPerPixel(0)
+    , mRasterValid(false)
+    , mRasterDraft(false)
+    , mDraftQuality(false)
+    , mDraftSkips(HgCairo::skipNone)
+    , mBudgeted(false)
+    , mZoom(1.0)
+    , mOverscanMargin(0)
+    , mScrollVelocityX(0)
+    , mScrollVelocityY(0)
+    , mOverlaysChanged(false)
+{
+}
+
+void HgHtmlView::drawHtml(unsigned char* buffer,
+    const cairo_format_t colorFormat,
+    const int width,
+    const int height,
+    const int stride,
+    const int htmlX,
+    const int htmlY)
+{
+  mBudgeted = false;
+  drawFrame(buffer, colorFormat, width, height, stride, htmlX, htmlY);
+}
+
+bool HgHtmlView::drawHtmlUntil(unsigned char* buffer,
+    const cairo_format_t colorFormat,
+    const int width,
+    const int height,
+    const int stride,
+    const int htmlX,
+    const int htmlY,
+    const Clock::time_point deadline)
+{
+  mBudgeted = true;
+  mDeadline = deadline;
+  drawFrame(buffer, colorFormat, width, height, stride, htmlX, htmlY);
+  mBudgeted = false;
+  return mStaleRects.empty();
+}
+
+std::vector<litehtml::position> HgHtmlView::staleRects() const
+{
+  std::vector<litehtml::position> rects;
+  rects.reserve(mStaleRects.size());
+  for(const auto& rect : mStaleRects) {
+    rects.emplace_back(
+        rect.x - mHtmlX, rect.y - mHtmlY, rect.width, rect.height);
+  }
+  return rects;
+}
+
+void HgHtmlView::drawFrame(unsigned char* buffer,
+    const cairo_format_t colorFormat,
+    const int width,
+    const int height,
+    const int stride,
+    const int htmlX,
+    const int htmlY)
+{
+  // https://stackoverflow.com/a/18685338
+  //auto start = std::chrono::steady_clock::now();
+
+  mDrawStats = DrawStats{};
+  mColorFormat = colorFormat;
+  mBytesPerPixel = HgCairo::formatBitsPerPixel(colorFormat) / 8;
+
+  if(mZoomPreview.mCairo) {
+    drawZoomPreview(buffer, colorFormat, width, height, stride);
+    return;
+  }
+
+  bool sameRaster = mRasterValid && buffer == mBuffer && width == mBufferWidth
+      && height == mBufferHeight && stride == mBufferStride;
+  bool fullDraw = !sameRaster || abs(mHtmlX - htmlX) >= width
+      || abs(mHtmlY - htmlY) >= height;
+  // The areas exposed by the scrolling may be drawn with the draft quality.
+  bool motion = sameRaster && (htmlX != mHtmlX || htmlY != mHtmlY);
+  HgCairo::Quality quality =
+      mDraftQuality && motion ? HgCairo::draftQuality : HgCairo::fullQuality;
+
+  // The edits damage the parts of the document only.
+  litehtml::position damage;
+  if(mDocument->layoutVersion() != mLayoutVersion) {
+    if(!mCairo || !mDocument->getDamage(mLayoutVersion, damage)) {
+      fullDraw = true;
+      mOverscan.mCairo.reset();
+    } else if(intersect(zoomRect(damage), mOverscan.mHtmlRect).width > 0) {
+      mOverscan.mCairo.reset();
+    }
+    mLayoutVersion = mDocument->layoutVersion();
+  }
+
+  // The decoded images are drawn with the full redraw.
+  if(mDocument->imageVersion() != mImageVersion) {
+    fullDraw = true;
+    mOverscan.mCairo.reset();
+    mImageVersion = mDocument->imageVersion();
+  }
+
+  // The stale tiles are drawn under the overlays.
+  bool redrawOverlays = fullDraw || !mStaleRects.empty();
+
+  if(fullDraw) {
+    dropSavedAreas();
+    mCairo =
+        std::make_shared<HgCairo>(buffer, colorFormat, width, height, stride);
+    mRasterDraft = false;
+    mStaleRects.clear();
+
+    mCairo->setQuality(quality, mDraftSkips);
+    exposeArea(mCairo, 0, 0, width, height, htmlX, htmlY, mDrawStats);
+    mCairo->setQuality(HgCairo::fullQuality);
+    mScrollVelocityX = 0;
+    mScrollVelocityY = 0;
+
+  } else {
+    int diffX = htmlX - mHtmlX;
+    int diffY = htmlY - mHtmlY;
+
+    litehtml::position viewport(mHtmlX, mHtmlY, width, height);
+    litehtml::position area = intersect(zoomRect(damage), viewport);
+
+    // The document raster is changed under the overlays.
+    if(area.width > 0 || diffX != 0 || diffY != 0) {
+      redrawOverlays = true;
+    }
+    if(redrawOverlays) {
+      restoreOverlays(mDrawStats);
+    }
+
+    // Repairs the damage in the current raster before the scrolling.
+    if(area.width > 0 && area.height > 0) {
+      exposeArea(mCairo, area.x - mHtmlX, area.y - mHtmlY, area.width,
+          area.height, mHtmlX, mHtmlY, mDrawStats);
+    }
+
+    mCairo->setQuality(quality, mDraftSkips);
+    scrollArea(mCairo, width, height, htmlX, htmlY, diffX, diffY, mDrawStats);
+    mCairo->setQuality(HgCairo::fullQuality);
+
+    // Smoothed scroll velocity, pixels per frame.
+    if(diffX != 0 || diffY != 0) {
+      mScrollVelocityX = (mScrollVelocityX + diffX) / 2.0;
+      mScrollVelocityY = (mScrollVelocityY + diffY) / 2.0;
+    }
+  }
+
+  if(buffer != mBuffer) {
+    mBuffer = buffer;
+  }
+  if(width != mBufferWidth) {
+    mBufferWidth = width;
+  }
+  if(height != mBufferHeight) {
+    mBufferHeight = height;
+  }
+  if(stride != mBufferStride) {
+    mBufferStride = stride;
+  }
+  if(htmlX != mHtmlX) {
+    mHtmlX = htmlX;
+  }
+  if(htmlY != mHtmlY) {
+    mHtmlY = htmlY;
+  }
+
+  mCairo->setQuality(quality, mDraftSkips);
+  drawStaleTiles(mDrawStats);
+  mCairo->setQuality(HgCairo::fullQuality);
+
+  mRasterValid = true;
+
+  if(redrawOverlays) {
+    drawOverlays(mDrawStats);
+  } else if(mOverlaysChanged) {
+    updateOverlays(mDrawStats);
+  }
+
+  //auto finish = std::chrono::steady_clock::now();
+  //auto elapsed =
+  //    std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+  //std::cout << "HgHtmlView::drawHtml: " << elapsed.count() << "\n";
+}
+
+void HgHtmlView::setZoom(double zoom)
+{
+  if(zoom <= 0) {
+    throw std::logic_error("HgHtmlView::setZoom(), zoom <= 0");
+  }
+  if(zoom != mZoom) {
+    mZoom = zoom;
+    mRasterValid = false;
+    mOverscan = Overscan{};
+  }
+}
+
+void HgHtmlView::setZoomPreview(double zoom, int focusX, int focusY)
+{
+  if(zoom <= 0) {
+    throw std::logic_error("HgHtmlView::setZoomPreview(), zoom <= 0");
+  }
+  if(!mCairo) {
+    return;
+  }
+
+  // Takes the last drawn raster without the overlays.
+  if(!mZoomPreview.mCairo) {
+    DrawStats stats;
+    restoreOverlays(stats);
+    mZoomPreview.mBuffer.assign(
+        mBuffer, mBuffer + static_cast<std::size_t>(mBufferStride)
+            * mBufferHeight);
+    mZoomPreview.mCairo = std::make_shared<HgCairo>(
+        mZoomPreview.mBuffer.data(), mColorFormat, mBufferWidth,
+        mBufferHeight, mBufferStride);
+    mRasterValid = false;
+  }
+  mZoomPreview.mZoom = zoom / mZoom;
+  mZoomPreview.mFocusX = focusX;
+  mZoomPreview.mFocusY = focusY;
+}
+
+void HgHtmlView::endZoomPreview(int& htmlX, int& htmlY)
+{
+  htmlX = mHtmlX;
+  htmlY = mHtmlY;
+  if(!mZoomPreview.mCairo) {
+    return;
+  }
+
+  const ZoomPreview& preview = mZoomPreview;
+  htmlX = static_cast<int>(std::lround(
+      (mHtmlX + preview.mFocusX) * preview.mZoom - preview.mFocusX));
+  htmlY = static_cast<int>(std::lround(
+      (mHtmlY + preview.mFocusY) * preview.mZoom - preview.mFocusY));
+  setZoom(mZoom * preview.mZoom);
+  mZoomPreview = ZoomPreview{};
+}
+
+void HgHtmlView::drawZoomPreview(unsigned char* buffer,
+    const cairo_format_t colorFormat,
+    const int width,
+    const int height,
+    const int stride)
+{
+  HgCairoPtr cairo = mCairo;
+  if(buffer != mBuffer || width != mBufferWidth || height != mBufferHeight
+      || stride != mBufferStride || colorFormat != mColorFormat) {
+    cairo =
+        std::make_shared<HgCairo>(buffer, colorFormat, width, height, stride);
+  }
+
+  // The preview is not the document raster, it is fully drawn after it.
+  dropSavedAreas();
+  mRasterValid = false;
+
+  const ZoomPreview& preview = mZoomPreview;
+  cairo->clear(HgCairo::Color{mBackgroundColor});
+  cairo->rasterScale(*preview.mCairo, preview.mZoom, preview.mFocusX,
+      preview.mFocusY, preview.mFocusX, preview.mFocusY);
+  mDrawStats.mScaledBytes =
+      static_cast<std::size_t>(width) * height * mBytesPerPixel;
+}
+
+litehtml::position HgHtmlView::zoomRect(const litehtml::position& rect) const
+{
+  if(mZoom == 1.0) {
+    return rect;
+  }
+  int left = static_cast<int>(std::floor(rect.left() * mZoom));
+  int top = static_cast<int>(std::floor(rect.top() * mZoom));
+  int right = static_cast<int>(std::ceil(rect.right() * mZoom));
+  int bottom = static_cast<int>(std::ceil(rect.bottom() * mZoom));
+  return litehtml::position(left, top, right - left, bottom - top);
+}
+
+bool HgHtmlView::prerenderOverscan()
+{
+  if(mDocument->isEmpty() || !mCairo || mOverscanMargin <= 0
+      || mBytesPerPixel <= 0
+      || mDocument->layoutVersion() != mLayoutVersion) {
+    return false;
+  }
+
+  litehtml::position rect;
+  if(!getOverscanRect(rect)) {
+    return false;
+  }
+
+  const litehtml::position& cached = mOverscan.mHtmlRect;
+  bool valid = mOverscan.mCairo && mOverscan.mColorFormat == mColorFormat;
+
+  if(valid && rect.left() >= cached.left() && rect.right() <= cached.right()
+      && rect.top() >= cached.top() && rect.bottom() <= cached.bottom()) {
+    return false;  // Already prerendered.
+  }
+
+  int diffX = rect.x - cached.x;
+  int diffY = rect.y - cached.y;
+  bool reuse = valid && rect.width == cached.width
+      && rect.height == cached.height && abs(diffX) < rect.width
+      && abs(diffY) < rect.height;
+
+  DrawStats stats;
+  if(reuse) {
+    // Shift the prerendered pixels and draw the new part only.
+    scrollArea(mOverscan.mCairo, rect.width, rect.height, rect.x, rect.y,
+        diffX, diffY, stats);
+
+  } else {
+    int stride = cairo_format_stride_for_width(mColorFormat, rect.width);
+    mOverscan.mBuffer.resize(stride * rect.height);
+    mOverscan.mCairo = std::make_shared<HgCairo>(mOverscan.mBuffer.data(),
+        mColorFormat, rect.width, rect.height, stride);
+    mOverscan.mColorFormat = mColorFormat;
+
+    drawArea(mOverscan.mCairo, 0, 0, rect.width, rect.height, rect.x, rect.y);
+  }
+
+  mOverscan.mHtmlRect = rect;
+  return true;
+}
+
+bool HgHtmlView::refine()
+{
+  if(!mRasterDraft || !mRasterValid || !mCairo
+      || mDocument->layoutVersion() != mLayoutVersion
+      || mDocument->imageVersion() != mImageVersion) {
+    return false;
+  }
+
+  mDrawStats = DrawStats{};
+  restoreOverlays(mDrawStats);
+  drawArea(mCairo, 0, 0, mBufferWidth, mBufferHeight, mHtmlX, mHtmlY);
+  mDrawStats.mDrawnBytes += static_cast<std::size_t>(mBufferWidth)
+      * mBufferHeight * mBytesPerPixel;
+  ++mDrawStats.mDrawCalls;
+  mRasterDraft = false;
+  mStaleRects.clear();
+
+  drawOverlays(mDrawStats);
+  return true;
+}
+
+bool HgHtmlView::getOverscanRect(litehtml::position& rect) const
+{
+  double speedX = std::abs(mScrollVelocityX);
+  double speedY = std::abs(mScrollVelocityY);
+  double speed = std::max(speedX, speedY);
+  if(speed < 1) {
+    return false;
+  }
+
+  int size = static_cast<int>(std::ceil(speed * OVERSCAN_FRAMES));
+  size = (size + OVERSCAN_STEP - 1) / OVERSCAN_STEP * OVERSCAN_STEP;
+  size = std::min(size, mOverscanMargin);
+
+  // Prerender along the dominant axis of the motion.
+  if(speedY >= speedX) {
+    rect.x = mHtmlX;
+    rect.width = mBufferWidth;
+    rect.height = size;
+    rect.y = mScrollVelocityY > 0 ? mHtmlY + mBufferHeight : mHtmlY - size;
+  } else {
+    rect.y = mHtmlY;
+    rect.height = mBufferHeight;
+    rect.width = size;
+    rect.x = mScrollVelocityX > 0 ? mHtmlX + mBufferWidth : mHtmlX - size;
+  }
+  return true;
+}
+
+bool HgHtmlView::copyFromOverscan(const int x,
+    const int y,
+    const int width,
+    const int height,
+    const int htmlX,
+    const int htmlY)
+{
+  if(!mOverscan.mCairo || mOverscan.mColorFormat != mColorFormat) {
+    return false;
+  }
+
+  const litehtml::position& cached = mOverscan.mHtmlRect;
+  int left = x + htmlX;
+  int top = y + htmlY;
+  if(left < cached.left() || left + width > cached.right()
+      || top < cached.top() || top + height > cached.bottom()) {
+    return false;
+  }
+
+  mCairo->rasterBlit(*mOverscan.mCairo, left - cached.x, top - cached.y, x, y,
+      width, height);
+  return true;
+}
+
+void HgHtmlView::scrollArea(HgCairoPtr& cairo,
+    const int width,
+    const int height,
+    const int htmlX,
+    const int htmlY,
+    const int diffX,
+    const int diffY,
+    DrawStats& stats)
+{
+  cairo->rasterCopy(diffX, diffY);
+  if(diffX != 0 || diffY != 0) {
+    stats.mCopiedBytes += static_cast<std::size_t>(height - abs(diffY))
+        * (width - abs(diffX)) * mBytesPerPixel;
+  }
+
+  int x1 = 0;
+  int y1 = 0;
+  int x2 = width;
+  int y2 = height;
+
+  if(diffX != 0) {
+    if(diffX > 0) {
+      x1 = x2 - diffX;
+    } else {
+      x2 = -diffX;  // x2 = x1 - diffX, but x1 == 0;
+    }
+    if(x1 != x2) {
+      exposeArea(cairo, x1, y1, x2 - x1, y2 - y1, htmlX, htmlY, stats);
+    }
+  }
+
+  if(diffY != 0) {
+    if(width == x2 && 0 != x1) {
+      x2 = x1;
+      x1 = 0;
+    } else if(0 == x1 && width != x2) {
+      x1 = x2;
+      x2 = width;
+    }
+
+    if(diffY > 0) {
+      y1 = y2 - diffY;
+    } else {
+      y2 = -diffY;  // y2 = y1 - diffY, but y1 == 0;
+    }
+    if(y1 != y2) {
+      exposeArea(cairo, x1, y1, x2 - x1, y2 - y1, htmlX, htmlY, stats);
+    }
+  }
+}
+
+void HgHtmlView::exposeArea(HgCairoPtr& cairo,
+    const int x,
+    const int y,
+    const int width,
+    const int height,
+    const int htmlX,
+    const int htmlY,
+    DrawStats& stats)
+{
+  std::size_t bytes = static_cast<std::size_t>(width) * height * mBytesPerPixel;
+
+  // Only the viewport is composed from the overscan.
+  if(cairo == mCairo && copyFromOverscan(x, y, width, height, htmlX, htmlY)) {
+    stats.mOverscanBytes += bytes;
+    return;
+  }
+
+  // The budgeted drawing draws the viewport by the tiles.
+  if(cairo == mCairo && mBudgeted) {
+    cairo->fillRect(x, y, width, height, HgCairo::Color{mPlaceholderColor});
+    mStaleRects.emplace_back(x + htmlX, y + htmlY, width, height);
+    return;
+  }
+
+  drawExposedArea(cairo, x, y, width, height, htmlX, htmlY, stats);
+}
+
+void HgHtmlView::drawExposedArea(HgCairoPtr& cairo,
+    const int x,
+    const int y,
+    const int width,
+    const int height,
+    const int htmlX,
+    const int htmlY,
+    DrawStats& stats)
+{
+  drawArea(cairo, x, y, width, height, htmlX, htmlY);
+  stats.mDrawnBytes +=
+      static_cast<std::size_t>(width) * height * mBytesPerPixel;
+  ++stats.mDrawCalls;
+  if(cairo->quality() == HgCairo::draftQuality) {
+    ++stats.mDraftCalls;
+    if(cairo == mCairo) {
+      mRasterDraft = true;
+    }
+  }
+}
+
+void HgHtmlView::drawStaleTiles(DrawStats& stats)
+{
+  if(mStaleRects.empty()) {
+    return;
+  }
+
+  // The stale areas scrolled out of the viewport are dropped.
+  litehtml::position viewport(mHtmlX, mHtmlY, mBufferWidth, mBufferHeight);
+  std::vector<litehtml::position> tiles;
+  for(const auto& rect : mStaleRects) {
+    litehtml::position area = intersect(rect, viewport);
+    for(int y = area.top(); y < area.bottom(); y += TILE_SIZE) {
+      for(int x = area.left(); x < area.right(); x += TILE_SIZE) {
+        tiles.emplace_back(x, y, std::min(TILE_SIZE, area.right() - x),
+            std::min(TILE_SIZE, area.bottom() - y));
+      }
+    }
+  }
+  mStaleRects.clear();
+
+  // The viewport center first.
+  double centerX = mHtmlX + mBufferWidth / 2.0;
+  double centerY = mHtmlY + mBufferHeight / 2.0;
+  auto distance = [centerX, centerY](const litehtml::position& tile) {
+    double dx = tile.x + tile.width / 2.0 - centerX;
+    double dy = tile.y + tile.height / 2.0 - centerY;
+    return dx * dx + dy * dy;
+  };
+  std::stable_sort(tiles.begin(), tiles.end(),
+      [&distance](const litehtml::position& a, const litehtml::position& b) {
+        return distance(a) < distance(b);
+      });
+
+  for(std::size_t i = 0; i < tiles.size(); ++i) {
+    // At least one tile is drawn to go on with the next call.
+    if(mBudgeted && i > 0 && Clock::now() >= mDeadline) {
+      mStaleRects.assign(tiles.begin() + i, tiles.end());
+      return;
+    }
+
+    const litehtml::position& tile = tiles[i];
+    int x = tile.x - mHtmlX;
+    int y = tile.y - mHtmlY;
+    if(copyFromOverscan(x, y, tile.width, tile.height, mHtmlX, mHtmlY)) {
+      stats.mOverscanBytes += static_cast<std::size_t>(tile.width)
+          * tile.height * mBytesPerPixel;
+      continue;
+    }
+    drawExposedArea(
+        mCairo, x, y, tile.width, tile.height, mHtmlX, mHtmlY, stats);
+  }
+}
+
+void HgHtmlView::restoreOverlays(DrawStats& stats)
+{
+  // In the reverse order for the overlapped areas.
+  for(auto overlay = mOverlays.rbegin(); overlay != mOverlays.rend();
+      ++overlay) {
+    for(std::size_t i = overlay->mSavedCount; i-- > 0;) {
+      const SavedArea& saved = overlay->mSavedAreas[i];
+      const litehtml::position& rect = saved.mRect;
+      mCairo->rasterBlit(
+          *saved.mCairo, 0, 0, rect.x, rect.y, rect.width, rect.height);
+      stats.mOverlayBytes +=
+          static_cast<std::size_t>(rect.width) * rect.height * mBytesPerPixel;
+    }
+    overlay->mSavedCount = 0;
+  }
+}
+
+void HgHtmlView::drawOverlays(DrawStats& stats)
+{
+  // Saves the document pixels under all overlays before any is drawn.
+  for(auto& overlay : mOverlays) {
+    overlay.mSavedCount = 0;
+    overlay.mDirty = false;
+    if(!overlay.mVisible) {
+      continue;
+    }
+    for(const auto& overlayRect : overlay.mRects) {
+      litehtml::position rect = bufferRect(overlayRect);
+      if(rect.width > 0 && rect.height > 0) {
+        saveArea(overlay, rect);
+      }
+    }
+  }
+
+  for(const auto& overlay : mOverlays) {
+    HgCairo::Color color{overlay.mColor};
+    for(std::size_t i = 0; i < overlay.mSavedCount; ++i) {
+      const litehtml::position& rect = overlay.mSavedAreas[i].mRect;
+      mCairo->fillRect(rect.x, rect.y, rect.width, rect.height, color);
+      stats.mOverlayBytes +=
+          static_cast<std::size_t>(rect.width) * rect.height * mBytesPerPixel;
+    }
+  }
+  mOverlaysChanged = false;
+}
+
+void HgHtmlView::updateOverlays(DrawStats& stats)
+{
+  // The old and the new rects of the changed overlays.
+  std::vector<litehtml::position> changed;
+  for(auto& overlay : mOverlays) {
+    for(std::size_t i = 0; i < overlay.mSavedCount; ++i) {
+      SavedArea& saved = overlay.mSavedAreas[i];
+      saved.mRestored = overlay.mDirty;
+      if(overlay.mDirty) {
+        changed.push_back(saved.mRect);
+      }
+    }
+    if(!overlay.mDirty || !overlay.mVisible) {
+      continue;
+    }
+    for(const auto& overlayRect : overlay.mRects) {
+      litehtml::position rect = bufferRect(overlayRect);
+      if(rect.width > 0 && rect.height > 0) {
+        changed.push_back(rect);
+      }
+    }
+  }
+
+  // The drawn rects overlapping the restored ones are restored too,
+  // the translucent colors are not drawn twice.
+  for(std::size_t checked = 0; checked < changed.size();) {
+    std::size_t count = changed.size();
+    for(auto& overlay : mOverlays) {
+      for(std::size_t i = 0; i < overlay.mSavedCount; ++i) {
+        SavedArea& saved = overlay.mSavedAreas[i];
+        if(saved.mRestored) {
+          continue;
+        }
+        for(std::size_t j = checked; j < count; ++j) {
+          if(intersect(saved.mRect, changed[j]).width > 0) {
+            saved.mRestored = true;
+            changed.push_back(saved.mRect);
+            break;
+          }
+        }
+      }
+    }
+    checked = count;
+  }
+
+  // The saved areas have the document pixels only, the order is not
+  // important.
+  for(auto& overlay : mOverlays) {
+    for(std::size_t i = 0; i < overlay.mSavedCount; ++i) {
+      const SavedArea& saved = overlay.mSavedAreas[i];
+      if(!saved.mRestored) {
+        continue;
+      }
+      const litehtml::position& rect = saved.mRect;
+      mCairo->rasterBlit(
+          *saved.mCairo, 0, 0, rect.x, rect.y, rect.width, rect.height);
+      stats.mOverlayBytes +=
+          static_cast<std::size_t>(rect.width) * rect.height * mBytesPerPixel;
+    }
+  }
+
+  // The changed overlays save the pixels under the new rects
+  // before any is drawn.
+  for(auto& overlay : mOverlays) {
+    if(!overlay.mDirty) {
+      continue;
+    }
+    overlay.mSavedCount = 0;
+    if(!overlay.mVisible) {
+      continue;
+    }
+    for(const auto& overlayRect : overlay.mRects) {
+      litehtml::position rect = bufferRect(overlayRect);
+      if(rect.width > 0 && rect.height > 0) {
+        saveArea(overlay, rect);
+        overlay.mSavedAreas[overlay.mSavedCount - 1].mRestored = true;
+      }
+    }
+  }
+
+  for(auto& overlay : mOverlays) {
+    HgCairo::Color color{overlay.mColor};
+    for(std::size_t i = 0; i < overlay.mSavedCount; ++i) {
+      const SavedArea& saved = overlay.mSavedAreas[i];
+      if(!saved.mRestored) {
+        continue;
+      }
+      const litehtml::position& rect = saved.mRect;
+      mCairo->fillRect(rect.x, rect.y, rect.width, rect.height, color);
+      stats.mOverlayBytes +=
+          static_cast<std::size_t>(rect.width) * rect.height * mBytesPerPixel;
+    }
+    overlay.mDirty = false;
+  }
+  mOverlaysChanged = false;
+}
+
+void HgHtmlView::dropSavedAreas()
+{
+  for(auto& overlay : mOverlays) {
+    overlay.mSavedCount = 0;
+  }
+}
+
+void HgHtmlView::saveArea(Overlay& overlay, const litehtml::position& rect)
+{
+  if(overlay.mSavedCount == overlay.mSavedAreas.size()) {
+    overlay.mSavedAreas.emplace_back();
+  }
+  SavedArea& saved = overlay.mSavedAreas[overlay.mSavedCount++];
+
+  // The surface of the same size is reused.
+  if(!saved.mCairo || saved.mColorFormat != mColorFormat
+      || saved.mRect.width != rect.width
+      || saved.mRect.height != rect.height) {
+    int stride = cairo_format_stride_for_width(mColorFormat, rect.width);
+    saved.mBuffer.resize(stride * rect.height);
+    saved.mCairo = std::make_shared<HgCairo>(saved.mBuffer.data(),
+        mColorFormat, rect.width, rect.height, stride);
+    saved.mColorFormat = mColorFormat;
+  }
+  saved.mRect = rect;
+  saved.mCairo->rasterBlit(
+      *mCairo, rect.x, rect.y, 0, 0, rect.width, rect.height);
+}
+
+litehtml::position HgHtmlView::bufferRect(const litehtml::position& rect) const
+{
+  litehtml::position htmlRect = zoomRect(rect);
+  htmlRect.x -= mHtmlX;
+  htmlRect.y -= mHtmlY;
+  return intersect(
+      htmlRect, litehtml::position(0, 0, mBufferWidth, mBufferHeight));
+}
+
+void HgHtmlView::drawArea(HgCairoPtr& cairo,
+    const int x,
+    const int y,
+    const int width,
+    const int height,
+    const int htmlX,
+    const int htmlY)
+{
+  cairo->save();
+  cairo->clip(x, y, width, height);
+  // The clear is skipped under the opaque background of the document.
+  cairo->clearDeferred(HgCairo::Color{mBackgroundColor});
+  if(mZoom == 1.0) {
+    litehtml::position clip(x, y, width, height);
+    mDocument->draw(cairo, clip, htmlX, htmlY);
+  } else {
+    // The cached layout is drawn with the scale transform.
+    cairo->translate(-htmlX, -htmlY);
+    cairo->scale(mZoom);
+    int left = static_cast<int>(std::floor((x + htmlX) / mZoom));
+    int top = static_cast<int>(std::floor((y + htmlY) / mZoom));
+    int right = static_cast<int>(std::ceil((x + htmlX + width) / mZoom));
+    int bottom = static_cast<int>(std::ceil((y + htmlY + height) / mZoom));
+    litehtml::position clip(left, top, right - left, bottom - top);
+    mDocument->draw(cairo, clip, 0, 0);
+  }
+  cairo->restore();
+  cairo->flush();
+}
+
+}  // namespace hg
@@ -0,0 +1,417 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_HTML_VIEW_H
+#define HG_HTML_VIEW_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "litehtml.h"
+
+#include "hgkamva/container/HgCairo.h"
+#include "hgkamva/renderer/HgHtmlDocument.h"
+
+namespace hg
+{
+class HgHtmlView;
+
+using HgHtmlViewPtr = std::shared_ptr<HgHtmlView>;
+
+// The viewport and raster state of one view of the shared document.
+// Different views of the same document may draw concurrently.
+class HgHtmlView
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // Counters of the last drawHtml() or refine() call, used by the benchmarks.
+  struct DrawStats
+  {
+    // Bytes moved inside the buffer by rasterCopy().
+    std::size_t mCopiedBytes = 0;
+    // Bytes cleared and rasterized by document::draw().
+    std::size_t mDrawnBytes = 0;
+    // Bytes taken from the prerendered overscan.
+    std::size_t mOverscanBytes = 0;
+    // Bytes restored and drawn by the overlays.
+    std::size_t mOverlayBytes = 0;
+    // Bytes drawn by the zoom preview.
+    std::size_t mScaledBytes = 0;
+    // Number of document::draw() calls.
+    int mDrawCalls = 0;
+    // Number of them with the draft quality.
+    int mDraftCalls = 0;
+  };
+
+  // The overlays are drawn in this order over the document raster.
+  enum OverlayLayer : int
+  {
+    searchLayer,
+    selectionLayer,
+    caretLayer,
+    overlayLayerCount,
+  };
+
+  HgHtmlView() = delete;
+
+  // TODO: Copy/move constructors/operators.
+  explicit HgHtmlView(HgHtmlDocumentConstPtr document);
+  virtual ~HgHtmlView() = default;
+
+  virtual void drawHtml(unsigned char* buffer,
+      const cairo_format_t colorFormat,
+      const int width,
+      const int height,
+      const int stride,
+      const int htmlX,
+      const int htmlY);
+  // Like drawHtml() but returns after the deadline is reached. The areas to
+  // draw are split to the tiles which are drawn from the viewport center,
+  // the tiles not drawn in time are filled with the placeholder color
+  // and are stale. The next call draws them first, at least one tile
+  // is drawn by every call. Returns true if nothing is stale.
+  bool drawHtmlUntil(unsigned char* buffer,
+      const cairo_format_t colorFormat,
+      const int width,
+      const int height,
+      const int stride,
+      const int htmlX,
+      const int htmlY,
+      const Clock::time_point deadline);
+  // The stale areas of the viewport in the buffer coordinates.
+  std::vector<litehtml::position> staleRects() const;
+
+  void setBackgroundColor(const litehtml::web_color& color);
+  const litehtml::web_color& backgroundColor() const;
+  void setPlaceholderColor(const litehtml::web_color& color);
+
+  // Max size (pixels) of the area prerendered ahead of the viewport
+  // in the direction of the scrolling, 0 disables the overscan.
+  void setOverscanMargin(int margin);
+  // Prerenders the overscan for the current scroll velocity.
+  // Call it in the idle time, between the drawHtml() calls.
+  // Returns false if nothing was to do.
+  bool prerenderOverscan();
+
+  // With the draft quality the areas exposed by the scrolling are drawn
+  // cheaper, see HgCairo::Quality, the draft skips are
+  // the HgCairo::DraftSkip flags. The overscan is prerendered
+  // with the full quality.
+  void setDraftQuality(bool draft, unsigned int draftSkips);
+  bool isDraftQuality() const;
+  // True if the raster has the areas drawn with the draft quality.
+  bool isDraftRaster() const;
+  // Redraws the viewport with the full quality if the raster has
+  // the draft areas. Call it in the idle time when the motion stops.
+  // Returns false if nothing was to do.
+  bool refine();
+
+  // The rects are in the document coordinates. The changes are drawn
+  // by the next drawHtml() which touches the old and the new rects
+  // of the changed overlays and the overlay rects overlapping them only,
+  // the document is not drawn for them.
+  void setOverlay(OverlayLayer layer,
+      const std::vector<litehtml::position>& rects,
+      const litehtml::web_color& color);
+  // For the caret blinking.
+  void setOverlayVisible(OverlayLayer layer, bool visible);
+
+  // The view scale of the document, the laid out document is drawn
+  // with the scale transform. The scroll position of drawHtml()
+  // is in the zoomed pixels, the overlay rects are in the document ones.
+  void setZoom(double zoom);
+  double zoom() const;
+
+  // The pinch zoom gesture. Until endZoomPreview() drawHtml() scales
+  // the last drawn raster by the zoom relative to zoom() with the bilinear
+  // filter instead of the document drawing, the viewport point
+  // focusX, focusY is kept in place.
+  void setZoomPreview(double zoom, int focusX, int focusY);
+  bool isZoomPreview() const;
+  // Sets the zoom of the preview and the scroll position which keeps
+  // the preview focus in place. The next drawHtml() draws the document
+  // at the new zoom.
+  void endZoomPreview(int& htmlX, int& htmlY);
+
+  const DrawStats& lastDrawStats() const;
+
+  HgHtmlDocumentConstPtr getDocument() const;
+
+private:
+  // The document pixels under the drawn overlay rect.
+  struct SavedArea
+  {
+    // In the buffer coordinates.
+    litehtml::position mRect;
+    std::vector<unsigned char> mBuffer;
+    HgCairoPtr mCairo;
+    cairo_format_t mColorFormat = CAIRO_FORMAT_INVALID;
+    // Is restored by the current overlays update.
+    bool mRestored = false;
+  };
+
+  struct Overlay
+  {
+    std::vector<litehtml::position> mRects;
+    litehtml::web_color mColor;
+    bool mVisible = true;
+    // Is changed since it was drawn.
+    bool mDirty = false;
+    // The first mSavedCount areas are under the drawn rects, the buffers
+    // are kept for the next frames.
+    std::vector<SavedArea> mSavedAreas;
+    std::size_t mSavedCount = 0;
+  };
+
+  // Document pixels prerendered ahead of the viewport.
+  struct Overscan
+  {
+    std::vector<unsigned char> mBuffer;
+    HgCairoPtr mCairo;
+    cairo_format_t mColorFormat = CAIRO_FORMAT_INVALID;
+    // In the document coordinates.
+    litehtml::position mHtmlRect;
+  };
+
+  // The raster scaled during the pinch zoom.
+  struct ZoomPreview
+  {
+    std::vector<unsigned char> mBuffer;
+    HgCairoPtr mCairo;
+    // Relative to mZoom.
+    double mZoom = 1.0;
+    int mFocusX = 0;
+    int mFocusY = 0;
+  };
+
+  // Frames of the motion which are covered by the overscan.
+  static constexpr double OVERSCAN_FRAMES = 4.0;
+  // The overscan size is rounded up to it to reuse the prerendered pixels.
+  static constexpr int OVERSCAN_STEP = 64;
+  // Max size of the tiles drawn by drawHtmlUntil().
+  static constexpr int TILE_SIZE = 128;
+
+  void drawFrame(unsigned char* buffer,
+      const cairo_format_t colorFormat,
+      const int width,
+      const int height,
+      const int stride,
+      const int htmlX,
+      const int htmlY);
+
+  void drawArea(HgCairoPtr& cairo,
+      const int x,
+      const int y,
+      const int width,
+      const int height,
+      const int htmlX,
+      const int htmlY);
+  void exposeArea(HgCairoPtr& cairo,
+      const int x,
+      const int y,
+      const int width,
+      const int height,
+      const int htmlX,
+      const int htmlY,
+      DrawStats& stats);
+  void drawExposedArea(HgCairoPtr& cairo,
+      const int x,
+      const int y,
+      const int width,
+      const int height,
+      const int htmlX,
+      const int htmlY,
+      DrawStats& stats);
+  void drawStaleTiles(DrawStats& stats);
+  void scrollArea(HgCairoPtr& cairo,
+      const int width,
+      const int height,
+      const int htmlX,
+      const int htmlY,
+      const int diffX,
+      const int diffY,
+      DrawStats& stats);
+
+  // Restores and draws all overlays.
+  void restoreOverlays(DrawStats& stats);
+  void drawOverlays(DrawStats& stats);
+  // Restores and draws the changed overlays and the overlay rects
+  // overlapping them only.
+  void updateOverlays(DrawStats& stats);
+  // The raster under the overlays is replaced.
+  void dropSavedAreas();
+  void saveArea(Overlay& overlay, const litehtml::position& rect);
+  // The visible part of the overlay rect in the buffer coordinates.
+  litehtml::position bufferRect(const litehtml::position& rect) const;
+
+  void drawZoomPreview(unsigned char* buffer,
+      const cairo_format_t colorFormat,
+      const int width,
+      const int height,
+      const int stride);
+  // The document rect in the zoomed pixels.
+  litehtml::position zoomRect(const litehtml::position& rect) const;
+
+  bool getOverscanRect(litehtml::position& rect) const;
+  bool copyFromOverscan(const int x,
+      const int y,
+      const int width,
+      const int height,
+      const int htmlX,
+      const int htmlY);
+
+  litehtml::web_color mBackgroundColor;
+  litehtml::web_color mPlaceholderColor;
+
+  HgHtmlDocumentConstPtr mDocument;
+  unsigned int mLayoutVersion;
+  unsigned int mImageVersion;
+
+  HgCairoPtr mCairo;
+
+  unsigned char* mBuffer;
+  int mBufferWidth;
+  int mBufferHeight;
+  int mBufferStride;
+  int mHtmlX;
+  int mHtmlY;
+  cairo_format_t mColorFormat;
+  int mBytesPerPixel;
+  // False if the buffer is changed not by the document drawing.
+  bool mRasterValid;
+  bool mRasterDraft;
+
+  bool mDraftQuality;
+  unsigned int mDraftSkips;
+
+  // The exposed areas are stale until the tiles are drawn.
+  bool mBudgeted;
+  Clock::time_point mDeadline;
+  // In the document coordinates.
+  std::vector<litehtml::position> mStaleRects;
+
+  double mZoom;
+  ZoomPreview mZoomPreview;
+
+  int mOverscanMargin;
+  double mScrollVelocityX;
+  double mScrollVelocityY;
+  Overscan mOverscan;
+
+  std::array<Overlay, overlayLayerCount> mOverlays;
+  bool mOverlaysChanged;
+
+  DrawStats mDrawStats;
+};
+
+inline void HgHtmlView::setBackgroundColor(const litehtml::web_color& color)
+{
+  if(color.red != mBackgroundColor.red || color.green != mBackgroundColor.green
+      || color.blue != mBackgroundColor.blue
+      || color.alpha != mBackgroundColor.alpha) {
+    mOverscan.mCairo.reset();
+  }
+  mBackgroundColor = color;
+}
+
+inline const litehtml::web_color& HgHtmlView::backgroundColor() const
+{
+  return mBackgroundColor;
+}
+
+inline void HgHtmlView::setPlaceholderColor(const litehtml::web_color& color)
+{
+  mPlaceholderColor = color;
+}
+
+inline void HgHtmlView::setOverscanMargin(int margin)
+{
+  mOverscanMargin = margin;
+  if(mOverscanMargin <= 0) {
+    mOverscan = Overscan{};
+  }
+}
+
+inline void HgHtmlView::setDraftQuality(bool draft, unsigned int draftSkips)
+{
+  mDraftQuality = draft;
+  mDraftSkips = draftSkips;
+}
+
+inline bool HgHtmlView::isDraftQuality() const
+{
+  return mDraftQuality;
+}
+
+inline bool HgHtmlView::isDraftRaster() const
+{
+  return mRasterDraft;
+}
+
+inline void HgHtmlView::setOverlay(OverlayLayer layer,
+    const std::vector<litehtml::position>& rects,
+    const litehtml::web_color& color)
+{
+  mOverlays[layer].mRects = rects;
+  mOverlays[layer].mColor = color;
+  mOverlays[layer].mDirty = true;
+  mOverlaysChanged = true;
+}
+
+inline void HgHtmlView::setOverlayVisible(OverlayLayer layer, bool visible)
+{
+  if(mOverlays[layer].mVisible != visible) {
+    mOverlays[layer].mVisible = visible;
+    mOverlays[layer].mDirty = true;
+    mOverlaysChanged = true;
+  }
+}
+
+inline double HgHtmlView::zoom() const
+{
+  return mZoom;
+}
+
+inline bool HgHtmlView::isZoomPreview() const
+{
+  return mZoomPreview.mCairo != nullptr;
+}
+
+inline const HgHtmlView::DrawStats& HgHtmlView::lastDrawStats() const
+{
+  return mDrawStats;
+}
+
+inline HgHtmlDocumentConstPtr HgHtmlView::getDocument() const
+{
+  return mDocument;
+}
+
+}  // namespace hg
+
+#endif  // HG_HTML_VIEW_H
@@ -0,0 +1,460 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/renderer/HgTextIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+
+#include "hgkamva/container/HgContainer.h"
+#include "hgkamva/util/StringUtil.h"
+
+namespace hg
+{
+namespace
+{
+// The element is in the ancestor or is removed from the document.
+bool isInside(
+    litehtml::element::ptr element, const litehtml::element::ptr& ancestor)
+{
+  litehtml::document::ptr document = element->get_document();
+  for(; element->parent(); element = element->parent()) {
+    if(element == ancestor) {
+      return true;
+    }
+  }
+  return element == ancestor || !document || element != document->root();
+}
+}  // namespace
+
+void HgTextIndex::build(const litehtml::document::ptr& document)
+{
+  clear();
+  if(!document || !document->root()) {
+    return;
+  }
+  addRuns(document->root());
+
+  mFoldedText = mText;
+  util::utf8FoldCase(mFoldedText);
+
+  mRunsByTop.resize(mRuns.size());
+  std::iota(mRunsByTop.begin(), mRunsByTop.end(), 0);
+  std::sort(mRunsByTop.begin(), mRunsByTop.end(),
+      [this](std::size_t a, std::size_t b) { return isAbove(a, b); });
+  updateMaxBottoms();
+}
+
+bool HgTextIndex::update(const litehtml::element::ptr& block,
+    const litehtml::position& oldBox,
+    int delta,
+    const litehtml::element::ptr& moveStop)
+{
+  // The old runs of the block are together in the document order.
+  std::size_t first = mRuns.size();
+  std::size_t last = 0;
+  auto it = std::lower_bound(mRunsByTop.begin(), mRunsByTop.end(), oldBox.y,
+      [this](std::size_t index, int y) { return mRuns[index].mBox.y < y; });
+  for(; it != mRunsByTop.end() && mRuns[*it].mBox.y < oldBox.bottom(); ++it) {
+    if(isInside(mRuns[*it].mElement, block)) {
+      first = std::min(first, *it);
+      last = std::max(last, *it + 1);
+    }
+  }
+  if(first >= last) {
+    return false;
+  }
+  // The runs overflowing the old box.
+  while(first > 0 && isInside(mRuns[first - 1].mElement, block)) {
+    --first;
+  }
+  while(last < mRuns.size() && isInside(mRuns[last].mElement, block)) {
+    ++last;
+  }
+
+  HgTextIndex blockIndex;
+  blockIndex.mTextLength = mRuns[first].mTextOffset;
+  blockIndex.addRuns(block);
+
+  const std::size_t oldCount = last - first;
+  const std::size_t newCount = blockIndex.mRuns.size();
+  const std::size_t byteBegin = mRunByteOffsets[first];
+  const std::size_t oldBytes =
+      (last < mRuns.size() ? mRunByteOffsets[last] : mText.size())
+      - byteBegin;
+  const std::size_t newBytes = blockIndex.mText.size();
+  const std::size_t oldLength =
+      (last < mRuns.size() ? mRuns[last].mTextOffset : mTextLength)
+      - mRuns[first].mTextOffset;
+  const std::size_t newLength =
+      blockIndex.mTextLength - mRuns[first].mTextOffset;
+
+  // The runs after the block.
+  for(std::size_t i = last; i < mRuns.size(); ++i) {
+    TextRun& run = mRuns[i];
+    run.mTextOffset = run.mTextOffset - oldLength + newLength;
+    mRunByteOffsets[i] = mRunByteOffsets[i] - oldBytes + newBytes;
+    if(delta != 0 && (!moveStop || isInside(run.mElement, moveStop))) {
+      run.mBox.y += delta;
+    }
+  }
+
+  for(std::size_t& byteOffset : blockIndex.mRunByteOffsets) {
+    byteOffset += byteBegin;
+  }
+  mRuns.erase(mRuns.begin() + first, mRuns.begin() + last);
+  mRuns.insert(mRuns.begin() + first,
+      std::make_move_iterator(blockIndex.mRuns.begin()),
+      std::make_move_iterator(blockIndex.mRuns.end()));
+  mRunByteOffsets.erase(
+      mRunByteOffsets.begin() + first, mRunByteOffsets.begin() + last);
+  mRunByteOffsets.insert(mRunByteOffsets.begin() + first,
+      blockIndex.mRunByteOffsets.begin(), blockIndex.mRunByteOffsets.end());
+
+  std::string foldedText = blockIndex.mText;
+  util::utf8FoldCase(foldedText);
+  mText.replace(byteBegin, oldBytes, blockIndex.mText);
+  mFoldedText.replace(byteBegin, oldBytes, foldedText);
+  mTextLength = mTextLength - oldLength + newLength;
+
+  // The kept runs keep their order, the block runs are merged to them.
+  auto byTop = [this](std::size_t a, std::size_t b) { return isAbove(a, b); };
+  std::vector<std::size_t> runsByTop;
+  runsByTop.reserve(mRuns.size());
+  for(std::size_t index : mRunsByTop) {
+    if(index < first) {
+      runsByTop.push_back(index);
+    } else if(index >= last) {
+      runsByTop.push_back(index - oldCount + newCount);
+    }
+  }
+  auto middle = runsByTop.end() - runsByTop.begin();
+  for(std::size_t i = first; i < first + newCount; ++i) {
+    runsByTop.push_back(i);
+  }
+  std::sort(runsByTop.begin() + middle, runsByTop.end(), byTop);
+  // The moved runs may pass the not moved ones.
+  if(!std::is_sorted(runsByTop.begin(), runsByTop.begin() + middle, byTop)) {
+    std::sort(runsByTop.begin(), runsByTop.begin() + middle, byTop);
+  }
+  std::inplace_merge(runsByTop.begin(), runsByTop.begin() + middle,
+      runsByTop.end(), byTop);
+  mRunsByTop.swap(runsByTop);
+  updateMaxBottoms();
+  return true;
+}
+
+bool HgTextIndex::isAbove(std::size_t runIndex1, std::size_t runIndex2) const
+{
+  const litehtml::position& box1 = mRuns[runIndex1].mBox;
+  const litehtml::position& box2 = mRuns[runIndex2].mBox;
+  return box1.y < box2.y || (box1.y == box2.y && box1.x < box2.x);
+}
+
+void HgTextIndex::updateMaxBottoms()
+{
+  mMaxBottoms.clear();
+  mMaxBottoms.reserve(mRunsByTop.size());
+  int maxBottom = std::numeric_limits<int>::min();
+  for(std::size_t index : mRunsByTop) {
+    maxBottom = std::max(maxBottom, mRuns[index].mBox.bottom());
+    mMaxBottoms.push_back(maxBottom);
+  }
+}
+
+void HgTextIndex::clear()
+{
+  mRuns.clear();
+  mRunsByTop.clear();
+  mMaxBottoms.clear();
+  mTextLength = 0;
+  mText.clear();
+  mFoldedText.clear();
+  mRunByteOffsets.clear();
+}
+
+void HgTextIndex::addRuns(const litehtml::element::ptr& element)
+{
+  std::size_t childCount = element->get_children_count();
+  if(childCount > 0) {
+    if(element->get_display() == litehtml::display_none) {
+      return;
+    }
+    for(std::size_t i = 0; i < childCount; ++i) {
+      addRuns(element->get_child(static_cast<int>(i)));
+    }
+    return;
+  }
+
+  // The text elements are the leaves without the tag name.
+  const litehtml::tchar_t* tagName = element->get_tagName();
+  if(element->is_replaced() || (tagName && *tagName)) {
+    return;
+  }
+
+  // Skips the collapsed spaces and the comments.
+  litehtml::position box = element->get_placement();
+  if(box.width <= 0 || box.height <= 0) {
+    return;
+  }
+
+  HgFontPtr font = HgContainer::getFont(element->get_font());
+  if(!font) {
+    return;
+  }
+
+  TextRun run;
+  run.mElement = element;
+  run.mBox = box;
+  run.mFont = font;
+  element->get_text(run.mText);
+  run.mTextOffset = mTextLength;
+  run.mLength = util::utf8Length(run.mText);
+  run.mWhiteSpace = element->is_white_space();
+
+  mTextLength += run.mLength;
+  mRunByteOffsets.push_back(mText.size());
+  mText += run.mText;
+  mRuns.push_back(std::move(run));
+}
+
+std::size_t HgTextIndex::nearestRun(int x, int y) const
+{
+  auto horizontalDistance = [x](const litehtml::position& box) {
+    if(x < box.left()) {
+      return box.left() - x;
+    }
+    if(x >= box.right()) {
+      return x - box.right() + 1;
+    }
+    return 0;
+  };
+
+  // The runs which may contain y are in [first, last), usually they are
+  // the runs of one line.
+  std::size_t first =
+      std::upper_bound(mMaxBottoms.begin(), mMaxBottoms.end(), y)
+      - mMaxBottoms.begin();
+  std::size_t last =
+      std::upper_bound(mRunsByTop.begin(), mRunsByTop.end(), y,
+          [this](int y, std::size_t index) { return y < mRuns[index].mBox.y; })
+      - mRunsByTop.begin();
+
+  std::size_t nearest = mRuns.size();
+  int minDistance = std::numeric_limits<int>::max();
+  for(std::size_t i = first; i < last && minDistance > 0; ++i) {
+    const litehtml::position& box = mRuns[mRunsByTop[i]].mBox;
+    if(y < box.bottom() && horizontalDistance(box) < minDistance) {
+      minDistance = horizontalDistance(box);
+      nearest = mRunsByTop[i];
+    }
+  }
+  if(nearest < mRuns.size()) {
+    return nearest;
+  }
+
+  // Below the text.
+  if(last == mRunsByTop.size()) {
+    return mRunsByTop.back();
+  }
+
+  // Above the text or between the lines, takes the next line.
+  const int lineTop = mRuns[mRunsByTop[last]].mBox.y;
+  for(std::size_t i = last;
+      i < mRunsByTop.size() && mRuns[mRunsByTop[i]].mBox.y == lineTop; ++i) {
+    const litehtml::position& box = mRuns[mRunsByTop[i]].mBox;
+    if(horizontalDistance(box) < minDistance) {
+      minDistance = horizontalDistance(box);
+      nearest = mRunsByTop[i];
+    }
+  }
+  return nearest;
+}
+
+bool HgTextIndex::hitTest(int x, int y, HitTestResult& result) const
+{
+  if(mRuns.empty()) {
+    return false;
+  }
+
+  std::size_t runIndex = nearestRun(x, y);
+  const TextRun& run = mRuns[runIndex];
+  int runX = std::min(std::max(x - run.mBox.x, 0), run.mBox.width);
+
+  std::size_t byteOffset;
+  double caretX;
+  if(run.mWhiteSpace) {
+    // The white space is drawn as one space of the box width.
+    bool after = runX * 2 >= run.mBox.width;
+    byteOffset = after ? run.mText.size() : 0;
+    caretX = after ? run.mBox.width : 0;
+  } else {
+    byteOffset = run.mFont->textOffsetAtX(run.mText, runX);
+    caretX = run.mFont->xAtTextOffset(run.mText, byteOffset);
+  }
+
+  result.mRunIndex = runIndex;
+  result.mCharOffset = util::utf8Length(run.mText, byteOffset);
+  result.mTextOffset = run.mTextOffset + result.mCharOffset;
+  result.mCaret = litehtml::position(
+      run.mBox.x + static_cast<int>(std::lround(caretX)), run.mBox.y, 0,
+      run.mBox.height);
+  return true;
+}
+
+std::string HgTextIndex::searchPattern(const std::string& query,
+    bool caseSensitive)
+{
+  std::string pattern = query;
+  if(!caseSensitive) {
+    util::utf8FoldCase(pattern);
+  }
+  return pattern;
+}
+
+std::size_t HgTextIndex::find(const std::string& pattern,
+    std::size_t fromByteOffset,
+    bool caseSensitive) const
+{
+  const std::string& text = caseSensitive ? mText : mFoldedText;
+  if(fromByteOffset >= text.size()) {
+    return std::string::npos;
+  }
+  return text.find(pattern, fromByteOffset);
+}
+
+HgTextIndex::TextMatch HgTextIndex::makeMatch(std::size_t byteOffset,
+    std::size_t byteLength,
+    std::size_t textOffset) const
+{
+  TextMatch match;
+  match.mTextOffset = textOffset;
+  match.mLength = util::utf8Length(mText.data() + byteOffset, byteLength);
+
+  const std::size_t byteEnd = byteOffset + byteLength;
+  std::size_t runIndex =
+      std::upper_bound(
+          mRunByteOffsets.begin(), mRunByteOffsets.end(), byteOffset)
+      - mRunByteOffsets.begin() - 1;
+  for(; runIndex < mRuns.size() && mRunByteOffsets[runIndex] < byteEnd;
+      ++runIndex) {
+    const TextRun& run = mRuns[runIndex];
+    const std::size_t runStart = mRunByteOffsets[runIndex];
+    std::size_t first = std::max(byteOffset, runStart) - runStart;
+    std::size_t last = std::min(byteEnd, runStart + run.mText.size())
+        - runStart;
+
+    int left = 0;
+    int right = run.mBox.width;
+    if(!run.mWhiteSpace) {
+      left = static_cast<int>(
+          std::lround(run.mFont->xAtTextOffset(run.mText, first)));
+      right = static_cast<int>(
+          std::lround(run.mFont->xAtTextOffset(run.mText, last)));
+    }
+    match.mRects.emplace_back(run.mBox.x + left, run.mBox.y,
+        std::max(right - left, 0), run.mBox.height);
+  }
+  return match;
+}
+
+HgTextIndex::TextMatchVector HgTextIndex::findAll(const std::string& query,
+    bool caseSensitive,
+    std::size_t maxMatches) const
+{
+  TextMatchVector matches;
+  if(query.empty()) {
+    return matches;
+  }
+
+  // The searcher tables are built once for all matches.
+  const std::string& text = caseSensitive ? mText : mFoldedText;
+  const std::string pattern = searchPattern(query, caseSensitive);
+  const std::boyer_moore_horspool_searcher<std::string::const_iterator>
+      searcher(pattern.begin(), pattern.end());
+
+  // The text offsets are counted incrementally from the previous match.
+  auto it = text.begin();
+  std::size_t countedBytes = 0;
+  std::size_t textOffset = 0;
+  while(matches.size() < maxMatches) {
+    it = std::search(it, text.end(), searcher);
+    if(it == text.end()) {
+      break;
+    }
+    std::size_t byteOffset = static_cast<std::size_t>(it - text.begin());
+    textOffset += util::utf8Length(
+        mText.data() + countedBytes, byteOffset - countedBytes);
+    countedBytes = byteOffset;
+
+    matches.push_back(makeMatch(byteOffset, pattern.size(), textOffset));
+    it += static_cast<std::ptrdiff_t>(pattern.size());
+  }
+  return matches;
+}
+
+bool HgTextIndex::findNext(const std::string& query,
+    std::size_t fromTextOffset,
+    bool caseSensitive,
+    TextMatch& match) const
+{
+  if(query.empty() || mRuns.empty()) {
+    return false;
+  }
+
+  // Starts the byte offset search from the run of fromTextOffset.
+  fromTextOffset = std::min(fromTextOffset, mTextLength);
+  std::size_t runIndex =
+      std::upper_bound(mRuns.begin(), mRuns.end(), fromTextOffset,
+          [](std::size_t offset, const TextRun& run) {
+            return offset < run.mTextOffset;
+          })
+      - mRuns.begin() - 1;
+  const TextRun& run = mRuns[runIndex];
+  std::size_t fromByteOffset = mRunByteOffsets[runIndex]
+      + util::utf8ByteOffset(run.mText, fromTextOffset - run.mTextOffset);
+
+  const std::string pattern = searchPattern(query, caseSensitive);
+  std::size_t byteOffset = find(pattern, fromByteOffset, caseSensitive);
+  std::size_t textOffset;
+  if(byteOffset != std::string::npos) {
+    textOffset = fromTextOffset
+        + util::utf8Length(
+            mText.data() + fromByteOffset, byteOffset - fromByteOffset);
+  } else {
+    byteOffset = find(pattern, 0, caseSensitive);
+    if(byteOffset == std::string::npos) {
+      return false;
+    }
+    textOffset = util::utf8Length(mText, byteOffset);
+  }
+
+  match = makeMatch(byteOffset, pattern.size(), textOffset);
+  return true;
+}
+
+}  // namespace hg
@@ -0,0 +1,175 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_TEXT_INDEX_H
+#define HG_TEXT_INDEX_H
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "litehtml.h"
+
+#include "hgkamva/container/HgFont.h"
+
+namespace hg
+{
+// The index of the laid out text runs for the hit-testing, the caret
+// positioning and the text search. Is built after every full layout
+// and is updated by the edits.
+class HgTextIndex
+{
+public:
+  struct TextRun
+  {
+    litehtml::element::ptr mElement;
+    // In the document coordinates.
+    litehtml::position mBox;
+    HgFontPtr mFont;
+    // UTF-8.
+    std::string mText;
+    // The characters before the run in the document text.
+    std::size_t mTextOffset;
+    // In characters.
+    std::size_t mLength;
+    bool mWhiteSpace;
+  };
+
+  struct HitTestResult
+  {
+    // In the document order.
+    std::size_t mRunIndex = 0;
+    // In characters from the run start.
+    std::size_t mCharOffset = 0;
+    // In characters from the document text start.
+    std::size_t mTextOffset = 0;
+    // The caret line in the document coordinates, width is 0.
+    litehtml::position mCaret;
+  };
+
+  struct TextMatch
+  {
+    // In characters from the document text start.
+    std::size_t mTextOffset = 0;
+    // In characters.
+    std::size_t mLength = 0;
+    // One rect per matched run part, in the document coordinates.
+    std::vector<litehtml::position> mRects;
+  };
+  using TextMatchVector = std::vector<TextMatch>;
+
+  void build(const litehtml::document::ptr& document);
+  void clear();
+  // Replaces the runs of the block laid out again and moves the runs
+  // after it by delta up to the end of moveStop, or to the document end
+  // if it is null, without the document walk. The old runs are found
+  // in the old block box or are removed from the document. Returns false
+  // if there are no old runs, then the index must be built again.
+  bool update(const litehtml::element::ptr& block,
+      const litehtml::position& oldBox,
+      int delta,
+      const litehtml::element::ptr& moveStop);
+
+  // Finds the text position nearest to the document point x, y
+  // in O(log n) of the runs. Returns false if there is no text.
+  bool hitTest(int x, int y, HitTestResult& result) const;
+
+  // Finds up to maxMatches not overlapping occurrences of the UTF-8 query
+  // in the document text without the relayout. The case insensitive
+  // search folds ASCII, Latin-1, Greek and Cyrillic letters.
+  TextMatchVector findAll(const std::string& query,
+      bool caseSensitive = true,
+      std::size_t maxMatches = std::numeric_limits<std::size_t>::max()) const;
+  // Finds the first occurrence starting at or after the character
+  // fromTextOffset, wraps around the document end.
+  bool findNext(const std::string& query,
+      std::size_t fromTextOffset,
+      bool caseSensitive,
+      TextMatch& match) const;
+
+  bool isEmpty() const;
+  // In the document order.
+  const std::vector<TextRun>& runs() const;
+  // In characters.
+  std::size_t textLength() const;
+  // The run texts in the document order, UTF-8.
+  const std::string& text() const;
+
+private:
+  void addRuns(const litehtml::element::ptr& element);
+  // The order of mRunsByTop.
+  bool isAbove(std::size_t runIndex1, std::size_t runIndex2) const;
+  void updateMaxBottoms();
+  std::size_t nearestRun(int x, int y) const;
+  // The query or its folded copy.
+  static std::string searchPattern(const std::string& query,
+      bool caseSensitive);
+  // In bytes of mText, std::string::npos if it is not found.
+  std::size_t find(const std::string& pattern,
+      std::size_t fromByteOffset,
+      bool caseSensitive) const;
+  // The match at [byteOffset, byteOffset + byteLength) of mText.
+  TextMatch makeMatch(std::size_t byteOffset,
+      std::size_t byteLength,
+      std::size_t textOffset) const;
+
+private:
+  // In the document order.
+  std::vector<TextRun> mRuns;
+  // The run indexes ordered by the top and the left.
+  std::vector<std::size_t> mRunsByTop;
+  // The max bottom of mRunsByTop[0..i], is not decreasing.
+  std::vector<int> mMaxBottoms;
+  std::size_t mTextLength = 0;
+  // The run texts in the document order and its folded copy
+  // for the case insensitive search, have the same byte offsets.
+  std::string mText;
+  std::string mFoldedText;
+  // The run start offsets in mText, is increasing.
+  std::vector<std::size_t> mRunByteOffsets;
+};  // class HgTextIndex
+
+inline bool HgTextIndex::isEmpty() const
+{
+  return mRuns.empty();
+}
+
+inline const std::vector<HgTextIndex::TextRun>& HgTextIndex::runs() const
+{
+  return mRuns;
+}
+
+inline std::size_t HgTextIndex::textLength() const
+{
+  return mTextLength;
+}
+
+inline const std::string& HgTextIndex::text() const
+{
+  return mText;
+}
+
+}  // namespace hg
+
+#endif  // HG_TEXT_INDEX_H
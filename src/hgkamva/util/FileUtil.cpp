@@ -23,79 +23,73 @@
 
 #include "hgkamva/util/FileUtil.h"
 
-#include <algorithm>
-#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <ios>
-#include <iterator>
-#include <vector>
+
+#include "hgkamva/util/ImageWriter.h"
+#include "hgkamva/util/MappedFile.h"
 
 namespace hg
 {
 namespace util
 {
-// Writing the buffer to a .PPM file, assuming it has RGB-structure, one byte
-// per color component.
-// http://www.antigrain.com/doc/basic_renderers/basic_renderers.agdoc.html
 bool writePpmFile(const unsigned char* buf,
     unsigned width,
     unsigned height,
-    unsigned bytePerPixel,
+    int stride,
     const hg::filesystem::path& fileName)
 {
-  FILE* fd = fopen(fileName.c_str(), "wb");
-  if(fd) {
-    fprintf(fd, "P6 %d %d 255 ", width, height);
-
-    unsigned int size = width * height * bytePerPixel;
-    for(unsigned int i = 0; i < size; i += bytePerPixel) {
-      fwrite(buf + i, 1, 3, fd);
-    }
+  return writeImageFile(buf, width, height, stride, PixelFormat::rgb24,
+      ImageFileType::ppm, fileName);
+}
 
-    fclose(fd);
-    return true;
-  }
-  return false;
+bool writePngFile(const unsigned char* buf,
+    unsigned width,
+    unsigned height,
+    int stride,
+    bool hasAlpha,
+    const hg::filesystem::path& fileName)
+{
+  return writeImageFile(buf, width, height, stride,
+      hasAlpha ? PixelFormat::argb32 : PixelFormat::rgb24, ImageFileType::png,
+      fileName);
 }
 
-//https://stackoverflow.com/a/37575457
+// The files are mapped to the memory and compared at once.
 bool compareFiles(const hg::filesystem::path& filePath1,
     const hg::filesystem::path& filePath2)
 {
-  std::ifstream f1(filePath1.string(), std::ifstream::binary | std::ifstream::ate);
-  std::ifstream f2(filePath2.string(), std::ifstream::binary | std::ifstream::ate);
+  MappedFile f1(filePath1);
+  MappedFile f2(filePath2);
 
-  if(f1.fail() || f2.fail()) {
+  if(!f1.isOpen() || !f2.isOpen()) {
     return false;  // File problem.
   }
 
-  if(f1.tellg() != f2.tellg()) {
+  if(f1.size() != f2.size()) {
     return false;  // Size mismatch.
   }
 
-  // Seek back to beginning and use std::equal to compare contents.
-  f1.seekg(0, std::ifstream::beg);
-  f2.seekg(0, std::ifstream::beg);
-  return std::equal(std::istreambuf_iterator<char>(f1.rdbuf()),
-      std::istreambuf_iterator<char>(),
-      std::istreambuf_iterator<char>(f2.rdbuf()));
+  return f1.size() == 0 || std::memcmp(f1.data(), f2.data(), f1.size()) == 0;
 }
 
 // https://stackoverflow.com/a/525103
 // https://stackoverflow.com/a/43009155
+// The file is read directly to the string, see MappedFile to avoid the copy.
 std::string readFile(const hg::filesystem::path& fileName)
 {
   std::ifstream ifs(fileName.string(), std::ios::in | std::ios::binary | std::ios::ate);
 
   std::ifstream::pos_type fileSize = ifs.tellg();
-  if(fileSize < 0)
+  if(fileSize <= 0)
     return std::string();
 
   ifs.seekg(0, std::ios::beg);
-  std::vector<char> bytes(fileSize);
+  std::string bytes(static_cast<std::size_t>(fileSize), '\0');
   ifs.read(&bytes[0], fileSize);
-
-  return std::string(&bytes[0], fileSize);
+  bytes.resize(static_cast<std::size_t>(ifs.gcount()));
+  return bytes;
 }
 
 }  // namespace util
@@ -32,10 +32,21 @@ namespace hg
 {
 namespace util
 {
+// Writes the image of 32 bits native endian pixels (cairo's ARGB32 or RGB24)
+// to the binary PPM file, the alpha is dropped, see writeImageFile().
 bool writePpmFile(const unsigned char* buf,
     unsigned width,
     unsigned height,
-    unsigned bytePerPixel,
+    int stride,
+    const hg::filesystem::path& fileName);
+
+// Writes the image of 32 bits native endian pixels (cairo's ARGB32 with
+// the premultiplied alpha or RGB24) to the PNG file.
+bool writePngFile(const unsigned char* buf,
+    unsigned width,
+    unsigned height,
+    int stride,
+    bool hasAlpha,
     const hg::filesystem::path& fileName);
 
 bool compareFiles(const hg::filesystem::path& filePath1,
@@ -0,0 +1,268 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/util/ImageCompare.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__SSE2__)
+#define HG_IMAGE_COMPARE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "hgkamva/util/ImageWriter.h"
+#include "hgkamva/util/MappedFile.h"
+
+namespace hg
+{
+namespace util
+{
+namespace
+{
+struct PpmImage
+{
+  const unsigned char* mPixels = nullptr;
+  unsigned mWidth = 0;
+  unsigned mHeight = 0;
+};
+
+bool readPpmNumber(
+    const unsigned char*& pos, const unsigned char* end, unsigned& number)
+{
+  // Skip the whitespaces and the comments before the number.
+  while(pos < end && (std::isspace(*pos) || *pos == '#')) {
+    if(*pos == '#') {
+      while(pos < end && *pos != '\n') {
+        ++pos;
+      }
+    } else {
+      ++pos;
+    }
+  }
+
+  const unsigned char* start = pos;
+  uint64_t value = 0;
+  while(pos < end && std::isdigit(*pos) && value <= UINT32_MAX) {
+    value = value * 10 + (*pos - '0');
+    ++pos;
+  }
+  if(pos == start || value > UINT32_MAX) {
+    return false;
+  }
+  number = static_cast<unsigned>(value);
+  return true;
+}
+
+// The header is terminated by the single whitespace,
+// the space of the old references or the new line of writeImageFile().
+bool parsePpm(const MappedFile& file, PpmImage& image)
+{
+  const unsigned char* pos = file.data();
+  const unsigned char* end = pos + file.size();
+  if(file.size() < 2 || pos[0] != 'P' || pos[1] != '6') {
+    return false;
+  }
+  pos += 2;
+
+  unsigned maxValue;
+  if(!readPpmNumber(pos, end, image.mWidth)
+      || !readPpmNumber(pos, end, image.mHeight)
+      || !readPpmNumber(pos, end, maxValue) || maxValue != 255) {
+    return false;
+  }
+  if(pos == end || !std::isspace(*pos)) {
+    return false;
+  }
+  ++pos;
+
+  uint64_t size = static_cast<uint64_t>(image.mWidth) * image.mHeight * 3;
+  if(size > static_cast<uint64_t>(end - pos)) {
+    return false;
+  }
+  image.mPixels = pos;
+  return true;
+}
+
+inline unsigned pixelDiff(const unsigned char* p1, const unsigned char* p2)
+{
+  unsigned diff = 0;
+  for(int i = 0; i < 3; ++i) {
+    diff = std::max(diff,
+        static_cast<unsigned>(std::abs(static_cast<int>(p1[i]) - p2[i])));
+  }
+  return diff;
+}
+
+std::size_t countDifferentPixels(const unsigned char* expected,
+    const unsigned char* actual,
+    std::size_t width,
+    unsigned tolerance,
+    unsigned& maxDiff)
+{
+  std::size_t count = 0;
+  for(std::size_t x = 0; x < width; ++x) {
+    unsigned diff = pixelDiff(expected + x * 3, actual + x * 3);
+    maxDiff = std::max(maxDiff, diff);
+    if(diff > tolerance) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+// Compares the row of the packed R, G, B pixels.
+std::size_t compareRow(const unsigned char* expected,
+    const unsigned char* actual,
+    std::size_t width,
+    unsigned tolerance,
+    unsigned& maxDiff)
+{
+  std::size_t count = 0;
+  std::size_t x = 0;
+
+#ifdef HG_IMAGE_COMPARE_SSE2
+  // 16 pixels per step, the pixels are counted only in the steps
+  // with the channels over the tolerance.
+  const __m128i toleranceV =
+      _mm_set1_epi8(static_cast<char>(std::min(tolerance, 255u)));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i maxV = zero;
+  for(; x + 16 <= width; x += 16) {
+    __m128i over = zero;
+    for(int i = 0; i < 3; ++i) {
+      __m128i e = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(expected + x * 3 + i * 16));
+      __m128i a = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(actual + x * 3 + i * 16));
+      __m128i diff = _mm_or_si128(_mm_subs_epu8(e, a), _mm_subs_epu8(a, e));
+      maxV = _mm_max_epu8(maxV, diff);
+      over = _mm_or_si128(over, _mm_subs_epu8(diff, toleranceV));
+    }
+    if(_mm_movemask_epi8(_mm_cmpeq_epi8(over, zero)) != 0xFFFF) {
+      count += countDifferentPixels(
+          expected + x * 3, actual + x * 3, 16, tolerance, maxDiff);
+    }
+  }
+
+  unsigned char maxBytes[16];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(maxBytes), maxV);
+  maxDiff = std::max(maxDiff,
+      static_cast<unsigned>(*std::max_element(maxBytes, maxBytes + 16)));
+#endif
+
+  count += countDifferentPixels(
+      expected + x * 3, actual + x * 3, width - x, tolerance, maxDiff);
+  return count;
+}
+
+bool writeHeatmap(const PpmImage& expected,
+    const PpmImage& actual,
+    unsigned tolerance,
+    const hg::filesystem::path& fileName)
+{
+  std::size_t size =
+      static_cast<std::size_t>(expected.mWidth) * expected.mHeight;
+  std::vector<uint32_t> pixels(size);
+  for(std::size_t i = 0; i < size; ++i) {
+    const unsigned char* e = expected.mPixels + i * 3;
+    unsigned diff = pixelDiff(e, actual.mPixels + i * 3);
+    if(diff > tolerance) {
+      pixels[i] = (128u + diff / 2) << 16;
+    } else {
+      uint32_t gray = (e[0] + e[1] + e[2]) / 9;
+      pixels[i] = (gray << 16) | (gray << 8) | gray;
+    }
+  }
+  return writeImageFile(reinterpret_cast<const unsigned char*>(pixels.data()),
+      expected.mWidth, expected.mHeight,
+      static_cast<int>(expected.mWidth * 4), PixelFormat::rgb24,
+      ImageFileType::ppm, fileName);
+}
+
+}  // namespace
+
+ImageCompareOptions ImageCompareOptions::antialiasing()
+{
+  ImageCompareOptions options;
+  options.mChannelTolerance = 24;
+  options.mMaxDifferentPixels = 64;
+  return options;
+}
+
+std::ostream& operator<<(std::ostream& os, const ImageCompareResult& result)
+{
+  if(!result.mValid) {
+    return os << "not comparable PPM files";
+  }
+  return os << result.mWidth << "x" << result.mHeight << ", "
+            << result.mDifferentPixels << " different pixels, "
+            << "max channel diff " << result.mMaxChannelDiff;
+}
+
+ImageCompareResult compareImageFiles(const hg::filesystem::path& expected,
+    const hg::filesystem::path& actual,
+    const ImageCompareOptions& options,
+    const hg::filesystem::path& heatmap)
+{
+  ImageCompareResult result;
+
+  MappedFile expectedFile(expected);
+  MappedFile actualFile(actual);
+  PpmImage expectedImage;
+  PpmImage actualImage;
+  if(!parsePpm(expectedFile, expectedImage)
+      || !parsePpm(actualFile, actualImage)) {
+    return result;
+  }
+  result.mValid = true;
+  result.mWidth = expectedImage.mWidth;
+  result.mHeight = expectedImage.mHeight;
+
+  if(actualImage.mWidth != expectedImage.mWidth
+      || actualImage.mHeight != expectedImage.mHeight) {
+    result.mDifferentPixels =
+        static_cast<std::size_t>(result.mWidth) * result.mHeight;
+    return result;
+  }
+
+  std::size_t rowSize = static_cast<std::size_t>(result.mWidth) * 3;
+  for(unsigned y = 0; y < result.mHeight; ++y) {
+    result.mDifferentPixels += compareRow(expectedImage.mPixels + y * rowSize,
+        actualImage.mPixels + y * rowSize, result.mWidth,
+        options.mChannelTolerance, result.mMaxChannelDiff);
+  }
+  result.mMatched = result.mDifferentPixels <= options.mMaxDifferentPixels;
+
+  if(!result.mMatched && !heatmap.empty()) {
+    writeHeatmap(
+        expectedImage, actualImage, options.mChannelTolerance, heatmap);
+  }
+  return result;
+}
+
+}  // namespace util
+}  // namespace hg
@@ -0,0 +1,72 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_IMAGE_COMPARE_H
+#define HG_IMAGE_COMPARE_H
+
+#include <cstddef>
+#include <ostream>
+
+#include "hgkamva/util/Filesystem.h"
+
+namespace hg
+{
+namespace util
+{
+struct ImageCompareOptions
+{
+  // The pixel differs if any of its channels differs more.
+  unsigned mChannelTolerance = 0;
+  // The images match if no more pixels differ.
+  std::size_t mMaxDifferentPixels = 0;
+
+  // Allows the small antialiasing changes of FreeType and cairo.
+  static ImageCompareOptions antialiasing();
+};
+
+struct ImageCompareResult
+{
+  // Both files are the binary PPMs.
+  bool mValid = false;
+  bool mMatched = false;
+  unsigned mWidth = 0;
+  unsigned mHeight = 0;
+  std::size_t mDifferentPixels = 0;
+  unsigned mMaxChannelDiff = 0;
+};
+
+std::ostream& operator<<(std::ostream& os, const ImageCompareResult& result);
+
+// Compares the binary PPM (P6) files pixel by pixel.
+// If the images do not match and the heatmap path is not empty,
+// the differing pixels are written to it as the red PPM image
+// over the dimmed expected one.
+ImageCompareResult compareImageFiles(const hg::filesystem::path& expected,
+    const hg::filesystem::path& actual,
+    const ImageCompareOptions& options = ImageCompareOptions(),
+    const hg::filesystem::path& heatmap = hg::filesystem::path());
+
+}  // namespace util
+}  // namespace hg
+
+#endif  // HG_IMAGE_COMPARE_H
@@ -0,0 +1,105 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/util/ImageCompare.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "hgkamva/util/FileUtil.h"
+
+namespace
+{
+const unsigned WIDTH = 37;
+const unsigned HEIGHT = 5;
+
+hg::filesystem::path writeImage(
+    const std::vector<unsigned char>& pixels, const std::string& fileName)
+{
+  hg::filesystem::path path = hg::filesystem::temp_directory_path() / fileName;
+  hg::util::writePpmFile(pixels.data(), WIDTH, HEIGHT, WIDTH * 4, path);
+  return path;
+}
+}  // namespace
+
+TEST(ImageCompareTest, compareImageFiles)
+{
+  std::vector<unsigned char> pixels(WIDTH * HEIGHT * 4, 100);
+  hg::filesystem::path expected = writeImage(pixels, "ImageCompare_1.ppm");
+
+  hg::util::ImageCompareResult result =
+      hg::util::compareImageFiles(expected, expected);
+  EXPECT_TRUE(result.mValid);
+  EXPECT_TRUE(result.mMatched);
+  EXPECT_EQ(WIDTH, result.mWidth);
+  EXPECT_EQ(HEIGHT, result.mHeight);
+  EXPECT_EQ(0u, result.mDifferentPixels);
+
+  // The pixels in the vector step and in the scalar tail of the row.
+  pixels[(WIDTH + 3) * 4 + 1] = 110;
+  pixels[(WIDTH * 3 - 1) * 4 + 2] = 20;
+  hg::filesystem::path actual = writeImage(pixels, "ImageCompare_2.ppm");
+  hg::filesystem::path heatmap =
+      hg::filesystem::temp_directory_path() / "ImageCompare_diff.ppm";
+  hg::filesystem::remove(heatmap);
+
+  result = hg::util::compareImageFiles(
+      expected, actual, hg::util::ImageCompareOptions(), heatmap);
+  EXPECT_TRUE(result.mValid);
+  EXPECT_FALSE(result.mMatched);
+  EXPECT_EQ(2u, result.mDifferentPixels);
+  EXPECT_EQ(80u, result.mMaxChannelDiff);
+  EXPECT_TRUE(hg::filesystem::exists(heatmap));
+  EXPECT_TRUE(hg::util::compareImageFiles(heatmap, heatmap).mMatched);
+
+  hg::util::ImageCompareOptions options;
+  options.mChannelTolerance = 10;
+  result = hg::util::compareImageFiles(expected, actual, options);
+  EXPECT_FALSE(result.mMatched);
+  EXPECT_EQ(1u, result.mDifferentPixels);
+
+  options.mMaxDifferentPixels = 1;
+  EXPECT_TRUE(hg::util::compareImageFiles(expected, actual, options).mMatched);
+
+  EXPECT_FALSE(
+      hg::util::compareImageFiles(expected, expected.string() + ".none")
+          .mValid);
+}
+
+TEST(ImageCompareTest, compareFiles)
+{
+  std::vector<unsigned char> pixels(WIDTH * HEIGHT * 4, 7);
+  hg::filesystem::path file1 = writeImage(pixels, "ImageCompare_3.ppm");
+  pixels.back() = 8;
+  hg::filesystem::path file2 = writeImage(pixels, "ImageCompare_4.ppm");
+  pixels[pixels.size() - 2] = 8;
+  hg::filesystem::path file3 = writeImage(pixels, "ImageCompare_5.ppm");
+
+  EXPECT_TRUE(hg::util::compareFiles(file1, file1));
+  // The alpha byte is not written.
+  EXPECT_TRUE(hg::util::compareFiles(file1, file2));
+  EXPECT_FALSE(hg::util::compareFiles(file1, file3));
+  EXPECT_FALSE(hg::util::compareFiles(file1, file1.string() + ".none"));
+}
@@ -0,0 +1,155 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/util/ImageWriter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if(defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HG_SWIZZLE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#include "hgkamva/util/PngWriter.h"
+
+namespace hg
+{
+namespace util
+{
+namespace
+{
+// The size of the file writes.
+constexpr std::size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+void swizzleToRgbScalar(
+    const unsigned char* src, std::size_t width, unsigned char* dst)
+{
+  for(std::size_t x = 0; x < width; ++x) {
+    uint32_t pixel;
+    std::memcpy(&pixel, src + x * 4, 4);
+    *dst++ = static_cast<unsigned char>(pixel >> 16);
+    *dst++ = static_cast<unsigned char>(pixel >> 8);
+    *dst++ = static_cast<unsigned char>(pixel);
+  }
+}
+
+#ifdef HG_SWIZZLE_SSSE3
+// 4 pixels per step, the little endian B, G, R, A bytes to R, G, B.
+__attribute__((target("ssse3"))) void swizzleToRgbSsse3(
+    const unsigned char* src, std::size_t width, unsigned char* dst)
+{
+  const __m128i shuffle = _mm_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+  // The 16 bytes store writes 4 bytes over the 12 converted ones,
+  // they are overwritten by the next step or by the scalar tail.
+  std::size_t x = 0;
+  for(; x + 6 <= width; x += 4) {
+    __m128i pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 3),
+        _mm_shuffle_epi8(pixels, shuffle));
+  }
+  swizzleToRgbScalar(src + x * 4, width - x, dst + x * 3);
+}
+
+bool hasSsse3()
+{
+  static const bool has = __builtin_cpu_supports("ssse3");
+  return has;
+}
+#endif  // HG_SWIZZLE_SSSE3
+
+bool writePpm(const unsigned char* buf,
+    unsigned width,
+    unsigned height,
+    int stride,
+    const hg::filesystem::path& fileName)
+{
+  FILE* fd = fopen(fileName.c_str(), "wb");
+  if(!fd) {
+    return false;
+  }
+
+  std::string header = "P6 " + std::to_string(width) + " "
+      + std::to_string(height) + " 255\n";
+  bool written = fwrite(header.data(), 1, header.size(), fd) == header.size();
+
+  // The rows are converted to the buffer and are written by the chunks.
+  const std::size_t rowSize = static_cast<std::size_t>(width) * 3;
+  const std::size_t rowsPerWrite =
+      std::max(WRITE_BUFFER_SIZE / std::max<std::size_t>(rowSize, 1),
+          std::size_t{1});
+  std::vector<unsigned char> chunk(rowsPerWrite * rowSize);
+  for(unsigned y = 0; y < height && written;) {
+    std::size_t rows = std::min<std::size_t>(rowsPerWrite, height - y);
+    for(std::size_t i = 0; i < rows; ++i, ++y) {
+      swizzleToRgb(buf + static_cast<std::size_t>(y) * stride, width,
+          chunk.data() + i * rowSize);
+    }
+    written = fwrite(chunk.data(), 1, rows * rowSize, fd) == rows * rowSize;
+  }
+
+  return fclose(fd) == 0 && written;
+}
+}  // namespace
+
+void swizzleToRgb(const unsigned char* src, std::size_t width,
+    unsigned char* dst)
+{
+#ifdef HG_SWIZZLE_SSSE3
+  if(hasSsse3()) {
+    swizzleToRgbSsse3(src, width, dst);
+    return;
+  }
+#endif
+  swizzleToRgbScalar(src, width, dst);
+}
+
+bool writeImageFile(const unsigned char* buf,
+    unsigned width,
+    unsigned height,
+    int stride,
+    PixelFormat format,
+    ImageFileType fileType,
+    const hg::filesystem::path& fileName)
+{
+  switch(fileType) {
+    case ImageFileType::ppm:
+      return writePpm(buf, width, height, stride, fileName);
+    case ImageFileType::png: {
+      PngWriter writer;
+      return writer.open(fileName, width, height, format == PixelFormat::argb32)
+          && writer.writeRows(buf, height, stride) && writer.close();
+    }
+  }
+  return false;
+}
+
+}  // namespace util
+}  // namespace hg
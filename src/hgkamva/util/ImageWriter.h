@@ -0,0 +1,68 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_IMAGE_WRITER_H
+#define HG_IMAGE_WRITER_H
+
+#include <cstddef>
+
+#include "hgkamva/util/Filesystem.h"
+
+namespace hg
+{
+namespace util
+{
+// The 32 bits native endian pixels of cairo.
+enum class PixelFormat
+{
+  // The premultiplied alpha.
+  argb32,
+  // The high byte is not used.
+  rgb24,
+};
+
+enum class ImageFileType
+{
+  // Binary PPM (P6), the alpha is dropped.
+  ppm,
+  png,
+};
+
+// Converts the row of the 32 bits native endian pixels to the packed
+// R, G, B bytes, the alpha is dropped. Uses SSSE3 if the CPU has it.
+void swizzleToRgb(const unsigned char* src, std::size_t width,
+    unsigned char* dst);
+
+// Writes the image with the row stride to the file.
+bool writeImageFile(const unsigned char* buf,
+    unsigned width,
+    unsigned height,
+    int stride,
+    PixelFormat format,
+    ImageFileType fileType,
+    const hg::filesystem::path& fileName);
+
+}  // namespace util
+}  // namespace hg
+
+#endif  // HG_IMAGE_WRITER_H
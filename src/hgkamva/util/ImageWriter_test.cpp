@@ -0,0 +1,93 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/util/ImageWriter.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "hgkamva/util/FileUtil.h"
+
+namespace
+{
+std::vector<unsigned char> makePixels(std::size_t count)
+{
+  std::vector<unsigned char> pixels(count * 4);
+  for(std::size_t i = 0; i < count; ++i) {
+    uint32_t pixel = 0xFF000000u | static_cast<uint32_t>(i * 0x010203u);
+    std::memcpy(pixels.data() + i * 4, &pixel, 4);
+  }
+  return pixels;
+}
+}  // namespace
+
+TEST(ImageWriterTest, swizzleToRgb)
+{
+  // All widths around the vector steps.
+  for(std::size_t width = 0; width < 40; ++width) {
+    std::vector<unsigned char> pixels = makePixels(width);
+    std::vector<unsigned char> rgb(width * 3 + 1, 0xAB);
+    hg::util::swizzleToRgb(pixels.data(), width, rgb.data());
+    for(std::size_t i = 0; i < width; ++i) {
+      uint32_t pixel;
+      std::memcpy(&pixel, pixels.data() + i * 4, 4);
+      EXPECT_EQ((pixel >> 16) & 0xFF, rgb[i * 3]);
+      EXPECT_EQ((pixel >> 8) & 0xFF, rgb[i * 3 + 1]);
+      EXPECT_EQ(pixel & 0xFF, rgb[i * 3 + 2]);
+    }
+    EXPECT_EQ(0xAB, rgb.back());
+  }
+}
+
+TEST(ImageWriterTest, writePpmWithStride)
+{
+  const unsigned width = 5;
+  const unsigned height = 3;
+  const int stride = 32;
+  std::vector<unsigned char> buf(stride * height, 0xEE);
+  std::vector<unsigned char> pixels = makePixels(width * height);
+  for(unsigned y = 0; y < height; ++y) {
+    std::memcpy(buf.data() + y * stride, pixels.data() + y * width * 4,
+        width * 4);
+  }
+
+  hg::filesystem::path fileName =
+      hg::filesystem::temp_directory_path() / "ImageWriter_test.ppm";
+  ASSERT_TRUE(hg::util::writeImageFile(buf.data(), width, height, stride,
+      hg::util::PixelFormat::rgb24, hg::util::ImageFileType::ppm, fileName));
+
+  std::string expected = "P6 5 3 255\n";
+  std::vector<unsigned char> rgb(width * height * 3);
+  hg::util::swizzleToRgb(pixels.data(), width * height, rgb.data());
+  expected.append(rgb.begin(), rgb.end());
+  EXPECT_EQ(expected, hg::util::readFile(fileName));
+
+  fileName.replace_extension(".png");
+  ASSERT_TRUE(hg::util::writeImageFile(buf.data(), width, height, stride,
+      hg::util::PixelFormat::argb32, hg::util::ImageFileType::png, fileName));
+  EXPECT_EQ(0, hg::util::readFile(fileName).compare(0, 4, "\x89PNG"));
+}
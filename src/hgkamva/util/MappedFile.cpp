@@ -0,0 +1,186 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/util/MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hg
+{
+namespace util
+{
+MappedFile::MappedFile(
+    const hg::filesystem::path& fileName, bool nullTerminated)
+{
+  open(fileName, nullTerminated);
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const hg::filesystem::path& fileName, bool nullTerminated)
+{
+  close();
+
+  HANDLE file = CreateFileW(fileName.wstring().c_str(), GENERIC_READ,
+      FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+      nullptr);
+  if(file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  mFileHandle = file;
+
+  LARGE_INTEGER size;
+  if(!GetFileSizeEx(file, &size)) {
+    close();
+    return false;
+  }
+
+  if(size.QuadPart > 0) {
+    HANDLE mapping =
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!mapping) {
+      close();
+      return false;
+    }
+    mMappingHandle = mapping;
+
+    mView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!mView) {
+      close();
+      return false;
+    }
+    mData = static_cast<const unsigned char*>(mView);
+    mSize = static_cast<std::size_t>(size.QuadPart);
+  }
+
+  if(nullTerminated) {
+    // The rest of the last page of the view is zero filled.
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    if(mSize % info.dwPageSize == 0) {
+      mCopy.assign(mData, mData + mSize);
+      mCopy.push_back(0);
+      mData = mCopy.data();
+    }
+  }
+  mOpen = true;
+  return true;
+}
+
+void MappedFile::close()
+{
+  if(mView) {
+    UnmapViewOfFile(mView);
+  }
+  if(mMappingHandle) {
+    CloseHandle(mMappingHandle);
+  }
+  if(mFileHandle) {
+    CloseHandle(mFileHandle);
+  }
+  mCopy.clear();
+  mData = nullptr;
+  mSize = 0;
+  mView = nullptr;
+  mMappingHandle = nullptr;
+  mFileHandle = nullptr;
+  mOpen = false;
+}
+
+#else  // #ifndef _WIN32
+
+bool MappedFile::open(const hg::filesystem::path& fileName, bool nullTerminated)
+{
+  close();
+
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return false;
+  }
+
+  struct stat fileStat;
+  if(fstat(fd, &fileStat) != 0) {
+    ::close(fd);
+    return false;
+  }
+
+  std::size_t size = static_cast<std::size_t>(fileStat.st_size);
+  std::size_t mappedSize = nullTerminated ? size + 1 : size;
+  if(mappedSize > 0) {
+    void* data;
+    if(nullTerminated) {
+      // The file is mapped over the zero filled anonymous pages,
+      // the rest of its last page or the next page terminates it.
+      data = mmap(nullptr, mappedSize, PROT_READ,
+          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if(data != MAP_FAILED && size > 0
+          && mmap(data, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0)
+              == MAP_FAILED) {
+        munmap(data, mappedSize);
+        data = MAP_FAILED;
+      }
+    } else {
+      data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if(data == MAP_FAILED) {
+      ::close(fd);
+      return false;
+    }
+    mData = static_cast<const unsigned char*>(data);
+    mSize = size;
+    mMappedSize = mappedSize;
+  }
+
+  // The mapping is kept after the closing.
+  ::close(fd);
+  mOpen = true;
+  return true;
+}
+
+void MappedFile::close()
+{
+  if(mData) {
+    munmap(const_cast<unsigned char*>(mData), mMappedSize);
+  }
+  mData = nullptr;
+  mSize = 0;
+  mMappedSize = 0;
+  mOpen = false;
+}
+
+#endif  // #ifdef _WIN32
+
+}  // namespace util
+}  // namespace hg
@@ -0,0 +1,93 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_MAPPED_FILE_H
+#define HG_MAPPED_FILE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "hgkamva/util/Filesystem.h"
+
+namespace hg
+{
+namespace util
+{
+// The read only memory mapping of the whole file.
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  explicit MappedFile(
+      const hg::filesystem::path& fileName, bool nullTerminated = false);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Returns false if the file is not mapped, the empty file is mapped
+  // with the null data. If nullTerminated, data()[size()] is the zero byte
+  // and data() is not null, for the parsers of the C strings.
+  bool open(
+      const hg::filesystem::path& fileName, bool nullTerminated = false);
+  void close();
+
+  bool isOpen() const;
+  const unsigned char* data() const;
+  std::size_t size() const;
+
+private:
+  bool mOpen = false;
+  const unsigned char* mData = nullptr;
+  std::size_t mSize = 0;
+#ifdef _WIN32
+  void* mFileHandle = nullptr;
+  void* mMappingHandle = nullptr;
+  void* mView = nullptr;
+  // The null terminated copy if the file fills its last page.
+  std::vector<unsigned char> mCopy;
+#else
+  // With the zero page after the file.
+  std::size_t mMappedSize = 0;
+#endif
+};  // class MappedFile
+
+inline bool MappedFile::isOpen() const
+{
+  return mOpen;
+}
+
+inline const unsigned char* MappedFile::data() const
+{
+  return mData;
+}
+
+inline std::size_t MappedFile::size() const
+{
+  return mSize;
+}
+
+}  // namespace util
+}  // namespace hg
+
+#endif  // HG_MAPPED_FILE_H
@@ -0,0 +1,75 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/util/MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace
+{
+hg::filesystem::path writeFile(std::size_t size)
+{
+  hg::filesystem::path path = hg::filesystem::temp_directory_path()
+      / ("MappedFile_" + std::to_string(size) + ".txt");
+  std::string text(size, 'a');
+  FILE* fd = fopen(path.string().c_str(), "wb");
+  fwrite(text.data(), 1, text.size(), fd);
+  fclose(fd);
+  return path;
+}
+}  // namespace
+
+TEST(MappedFileTest, open)
+{
+  hg::util::MappedFile file;
+  EXPECT_FALSE(file.isOpen());
+  EXPECT_FALSE(file.open(hg::filesystem::temp_directory_path()
+      / "MappedFile_no_such.txt"));
+
+  ASSERT_TRUE(file.open(writeFile(10)));
+  EXPECT_EQ(10u, file.size());
+  EXPECT_EQ(0, std::memcmp("aaaaaaaaaa", file.data(), 10));
+
+  ASSERT_TRUE(file.open(writeFile(0)));
+  EXPECT_EQ(0u, file.size());
+
+  file.close();
+  EXPECT_FALSE(file.isOpen());
+  EXPECT_EQ(nullptr, file.data());
+}
+
+TEST(MappedFileTest, nullTerminated)
+{
+  // The sizes of the whole pages are terminated too.
+  for(std::size_t size : {0, 1, 4095, 4096, 8192, 65536}) {
+    hg::util::MappedFile file(writeFile(size), true);
+    ASSERT_TRUE(file.isOpen());
+    ASSERT_NE(nullptr, file.data());
+    EXPECT_EQ(size, file.size());
+    EXPECT_EQ(size, std::strlen(reinterpret_cast<const char*>(file.data())));
+  }
+}
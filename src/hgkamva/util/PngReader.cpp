@@ -0,0 +1,281 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/util/PngReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <png.h>
+
+namespace hg
+{
+namespace util
+{
+namespace
+{
+struct MemoryReader
+{
+  const unsigned char* mData;
+  std::size_t mSize;
+  std::size_t mOffset;
+};
+
+void readData(png_structp png, png_bytep out, png_size_t length)
+{
+  MemoryReader* reader = static_cast<MemoryReader*>(png_get_io_ptr(png));
+  if(reader->mSize - reader->mOffset < length) {
+    png_error(png, "Truncated PNG data");
+  }
+  std::memcpy(out, reader->mData + reader->mOffset, length);
+  reader->mOffset += length;
+}
+
+uint32_t readBigEndian(const unsigned char* bytes)
+{
+  return (static_cast<uint32_t>(bytes[0]) << 24)
+      | (static_cast<uint32_t>(bytes[1]) << 16)
+      | (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+}
+
+// From the R, G, B, A bytes with the straight alpha.
+void toNativeRow(const unsigned char* src, unsigned width, uint32_t* dst)
+{
+  for(unsigned x = 0; x < width; ++x, src += 4) {
+    uint32_t alpha = src[3];
+    uint32_t red = src[0];
+    uint32_t green = src[1];
+    uint32_t blue = src[2];
+    if(alpha != 255) {
+      red = (red * alpha + 127) / 255;
+      green = (green * alpha + 127) / 255;
+      blue = (blue * alpha + 127) / 255;
+    }
+    dst[x] = (alpha << 24) | (red << 16) | (green << 8) | blue;
+  }
+}
+
+// The C++ objects are kept by the caller, longjmp() of libpng does not
+// skip their destructors. The rows are one row or the whole image
+// for the interlaced one.
+bool decodeRows(const unsigned char* data,
+    std::size_t size,
+    const PngReader::Header& header,
+    unsigned char* rows,
+    uint32_t* nativeRow,
+    BoxReducer& reducer)
+{
+  MemoryReader reader{data, size, 0};
+
+  png_structp png =
+      png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+  if(!png) {
+    return false;
+  }
+  png_infop info = png_create_info_struct(png);
+  if(!info) {
+    png_destroy_read_struct(&png, nullptr, nullptr);
+    return false;
+  }
+  if(setjmp(png_jmpbuf(png))) {
+    png_destroy_read_struct(&png, &info, nullptr);
+    return false;
+  }
+
+  png_set_read_fn(png, &reader, readData);
+  png_read_info(png, info);
+
+  // To 8 bits R, G, B, A.
+  png_set_expand(png);
+  png_set_strip_16(png);
+  png_set_gray_to_rgb(png);
+  png_set_add_alpha(png, 0xFF, PNG_FILLER_AFTER);
+  int passes = png_set_interlace_handling(png);
+  png_read_update_info(png, info);
+
+  const unsigned width = header.mWidth;
+  const unsigned height = header.mHeight;
+  if(png_get_image_width(png, info) != width
+      || png_get_image_height(png, info) != height
+      || png_get_rowbytes(png, info) != static_cast<std::size_t>(width) * 4
+      || (passes > 1) != header.mInterlaced) {
+    png_destroy_read_struct(&png, &info, nullptr);
+    return false;
+  }
+
+  const std::size_t rowSize = static_cast<std::size_t>(width) * 4;
+  if(header.mInterlaced) {
+    for(int pass = 0; pass < passes; ++pass) {
+      for(unsigned y = 0; y < height; ++y) {
+        png_read_row(png, rows + y * rowSize, nullptr);
+      }
+    }
+    for(unsigned y = 0; y < height; ++y) {
+      toNativeRow(rows + y * rowSize, width, nativeRow);
+      reducer.addRow(nativeRow);
+    }
+  } else {
+    for(unsigned y = 0; y < height; ++y) {
+      png_read_row(png, rows, nullptr);
+      toNativeRow(rows, width, nativeRow);
+      reducer.addRow(nativeRow);
+    }
+  }
+
+  png_read_end(png, nullptr);
+  png_destroy_read_struct(&png, &info, nullptr);
+  return true;
+}
+}  // namespace
+
+BoxReducer::BoxReducer(unsigned width,
+    unsigned height,
+    unsigned factor,
+    unsigned char* buffer,
+    int stride)
+    : mWidth(width)
+    , mHeight(height)
+    , mFactor(std::max(factor, 1u))
+    , mBuffer(buffer)
+    , mStride(stride)
+    , mRow(0)
+    , mSumRows(0)
+{
+  if(mFactor > 1) {
+    mSums.resize(static_cast<std::size_t>(reducedSize(width, mFactor)) * 4);
+  }
+}
+
+void BoxReducer::addRow(const uint32_t* row)
+{
+  if(mRow >= mHeight) {
+    return;
+  }
+
+  if(mFactor == 1) {
+    std::memcpy(mBuffer + static_cast<std::size_t>(mRow) * mStride, row,
+        static_cast<std::size_t>(mWidth) * 4);
+    ++mRow;
+    return;
+  }
+
+  uint64_t* sum = mSums.data();
+  for(uint64_t x = 0; x < mWidth; x += mFactor, sum += 4) {
+    uint64_t end = std::min<uint64_t>(x + mFactor, mWidth);
+    for(uint64_t i = x; i < end; ++i) {
+      uint32_t pixel = row[i];
+      sum[0] += pixel >> 24;
+      sum[1] += (pixel >> 16) & 0xFF;
+      sum[2] += (pixel >> 8) & 0xFF;
+      sum[3] += pixel & 0xFF;
+    }
+  }
+
+  ++mRow;
+  ++mSumRows;
+  if(mSumRows == mFactor || mRow == mHeight) {
+    writeRow();
+  }
+}
+
+void BoxReducer::writeRow()
+{
+  unsigned char* dst =
+      mBuffer + static_cast<std::size_t>((mRow - 1) / mFactor) * mStride;
+  const uint64_t* sum = mSums.data();
+  for(uint64_t x = 0; x < mWidth; x += mFactor, sum += 4, dst += 4) {
+    uint64_t count = (std::min<uint64_t>(x + mFactor, mWidth) - x) * mSumRows;
+    uint32_t pixel =
+        static_cast<uint32_t>(((sum[0] + count / 2) / count << 24)
+            | ((sum[1] + count / 2) / count << 16)
+            | ((sum[2] + count / 2) / count << 8)
+            | (sum[3] + count / 2) / count);
+    std::memcpy(dst, &pixel, 4);
+  }
+  std::fill(mSums.begin(), mSums.end(), 0);
+  mSumRows = 0;
+}
+
+bool PngReader::readHeader(
+    const unsigned char* data, std::size_t size, Header& header)
+{
+  // The IHDR chunk is the first one after the signature.
+  static const unsigned char signature[] = {
+      0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  if(size < HEADER_SIZE || std::memcmp(data, signature, 8) != 0
+      || std::memcmp(data + 12, "IHDR", 4) != 0) {
+    return false;
+  }
+
+  // The PNG limit of the size.
+  const uint32_t maxSize = 0x7FFFFFFF;
+  uint32_t width = readBigEndian(data + 16);
+  uint32_t height = readBigEndian(data + 20);
+  if(width == 0 || height == 0 || width > maxSize || height > maxSize) {
+    return false;
+  }
+  header.mWidth = width;
+  header.mHeight = height;
+  header.mInterlaced = data[28] != 0;
+  return true;
+}
+
+bool PngReader::read(const unsigned char* data,
+    std::size_t size,
+    unsigned factor,
+    unsigned char* buffer,
+    int stride)
+{
+  Header header;
+  if(!readHeader(data, size, header)) {
+    return false;
+  }
+
+  std::size_t rowSize = static_cast<std::size_t>(header.mWidth) * 4;
+  std::vector<unsigned char> rows(
+      header.mInterlaced ? rowSize * header.mHeight : rowSize);
+  std::vector<uint32_t> nativeRow(header.mWidth);
+  BoxReducer reducer(header.mWidth, header.mHeight, factor, buffer, stride);
+  return decodeRows(
+      data, size, header, rows.data(), nativeRow.data(), reducer);
+}
+
+void reduceImage(const unsigned char* src,
+    unsigned width,
+    unsigned height,
+    int srcStride,
+    unsigned factor,
+    unsigned char* dst,
+    int dstStride)
+{
+  BoxReducer reducer(width, height, factor, dst, dstStride);
+  std::vector<uint32_t> row(width);
+  for(unsigned y = 0; y < height; ++y) {
+    std::memcpy(row.data(), src + static_cast<std::size_t>(y) * srcStride,
+        static_cast<std::size_t>(width) * 4);
+    reducer.addRow(row.data());
+  }
+}
+
+}  // namespace util
+}  // namespace hg
@@ -0,0 +1,114 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_PNG_READER_H
+#define HG_PNG_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hg
+{
+namespace util
+{
+// Reduces the image by the factor with the box filter, the rows are added
+// one by one and only the sums of one reduced row are kept.
+// The pixels are 32 bits native endian with the premultiplied alpha
+// (cairo's ARGB32).
+class BoxReducer
+{
+public:
+  // The buffer is of the reduced size, see reducedSize().
+  BoxReducer(unsigned width,
+      unsigned height,
+      unsigned factor,
+      unsigned char* buffer,
+      int stride);
+
+  static unsigned reducedSize(unsigned size, unsigned factor);
+
+  // Adds the next source row, the rows over the height are ignored.
+  void addRow(const uint32_t* row);
+
+private:
+  void writeRow();
+
+  unsigned mWidth;
+  unsigned mHeight;
+  unsigned mFactor;
+  unsigned char* mBuffer;
+  int mStride;
+  unsigned mRow;
+  // The source rows added to the sums.
+  unsigned mSumRows;
+  // A, R, G, B of the reduced pixels.
+  std::vector<uint64_t> mSums;
+};  // class BoxReducer
+
+// Decodes the PNG images from the memory.
+class PngReader
+{
+public:
+  struct Header
+  {
+    unsigned mWidth = 0;
+    unsigned mHeight = 0;
+    bool mInterlaced = false;
+  };
+
+  // The signature and the IHDR chunk read by readHeader().
+  static constexpr std::size_t HEADER_SIZE = 29;
+
+  // Reads the IHDR chunk, returns false if the data is not PNG.
+  static bool readHeader(
+      const unsigned char* data, std::size_t size, Header& header);
+
+  // Decodes the image reduced by the factor to the buffer of the reduced
+  // size. The decoded rows are reduced at once, so the full size image
+  // is not kept but for the interlaced images.
+  static bool read(const unsigned char* data,
+      std::size_t size,
+      unsigned factor,
+      unsigned char* buffer,
+      int stride);
+};  // class PngReader
+
+// Reduces the image with the box filter, see BoxReducer.
+void reduceImage(const unsigned char* src,
+    unsigned width,
+    unsigned height,
+    int srcStride,
+    unsigned factor,
+    unsigned char* dst,
+    int dstStride);
+
+inline unsigned BoxReducer::reducedSize(unsigned size, unsigned factor)
+{
+  return (size + factor - 1) / factor;
+}
+
+}  // namespace util
+}  // namespace hg
+
+#endif  // HG_PNG_READER_H
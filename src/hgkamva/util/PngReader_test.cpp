@@ -0,0 +1,121 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/util/PngReader.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "hgkamva/util/FileUtil.h"
+#include "hgkamva/util/Filesystem.h"
+
+namespace
+{
+std::string encode(const std::vector<uint32_t>& pixels,
+    unsigned width,
+    unsigned height,
+    bool hasAlpha)
+{
+  hg::filesystem::path path =
+      hg::filesystem::temp_directory_path() / "PngReader.png";
+  hg::util::writePngFile(reinterpret_cast<const unsigned char*>(
+                             pixels.data()),
+      width, height, width * 4, hasAlpha, path);
+  return hg::util::readFile(path);
+}
+
+std::vector<uint32_t> decode(
+    const std::string& data, unsigned width, unsigned height, unsigned factor)
+{
+  unsigned reducedWidth = hg::util::BoxReducer::reducedSize(width, factor);
+  std::vector<uint32_t> pixels(
+      reducedWidth * hg::util::BoxReducer::reducedSize(height, factor));
+  EXPECT_TRUE(hg::util::PngReader::read(
+      reinterpret_cast<const unsigned char*>(data.data()), data.size(),
+      factor, reinterpret_cast<unsigned char*>(pixels.data()),
+      reducedWidth * 4));
+  return pixels;
+}
+}  // namespace
+
+TEST(PngReaderTest, readHeader)
+{
+  std::string data = encode(std::vector<uint32_t>(15, 0xFF000000), 5, 3, true);
+  hg::util::PngReader::Header header;
+  ASSERT_TRUE(hg::util::PngReader::readHeader(
+      reinterpret_cast<const unsigned char*>(data.data()), data.size(),
+      header));
+  EXPECT_EQ(5u, header.mWidth);
+  EXPECT_EQ(3u, header.mHeight);
+  EXPECT_FALSE(header.mInterlaced);
+
+  std::string text = "not a PNG image, not a PNG image";
+  EXPECT_FALSE(hg::util::PngReader::readHeader(
+      reinterpret_cast<const unsigned char*>(text.data()), text.size(),
+      header));
+  unsigned char pixel[4];
+  EXPECT_FALSE(hg::util::PngReader::read(
+      reinterpret_cast<const unsigned char*>(text.data()), text.size(), 1,
+      pixel, 4));
+}
+
+TEST(PngReaderTest, read)
+{
+  // The premultiplied alpha.
+  std::vector<uint32_t> pixels = {
+      0xFF102030, 0x80404040, 0x00000000, 0xFFFFFFFF, 0xFF000000, 0xFF204060};
+  for(bool hasAlpha : {true, false}) {
+    std::vector<uint32_t> expected = pixels;
+    if(!hasAlpha) {
+      expected[1] = 0xFF404040;
+      expected[2] = 0xFF000000;
+    }
+    EXPECT_EQ(expected, decode(encode(pixels, 3, 2, hasAlpha), 3, 2, 1));
+  }
+}
+
+TEST(PngReaderTest, reduce)
+{
+  // 3x3 by 2: the edge blocks are averaged over the source pixels in them.
+  std::vector<uint32_t> pixels = {
+      0xFF000000, 0xFF0000FF, 0xFF00FF00,
+      0xFF000000, 0xFF0000FF, 0xFF00FF00,
+      0xFFFF0000, 0xFFFF0000, 0xFFFFFFFF};
+  std::vector<uint32_t> expected = {
+      0xFF000080, 0xFF00FF00, 0xFFFF0000, 0xFFFFFFFF};
+  EXPECT_EQ(expected, decode(encode(pixels, 3, 3, true), 3, 3, 2));
+
+  std::vector<uint32_t> reduced(4);
+  hg::util::reduceImage(reinterpret_cast<const unsigned char*>(pixels.data()),
+      3, 3, 12, 2, reinterpret_cast<unsigned char*>(reduced.data()), 8);
+  EXPECT_EQ(expected, reduced);
+
+  // The factor over the size.
+  EXPECT_EQ(std::vector<uint32_t>{0xFF555555},
+      decode(encode(pixels, 3, 3, true), 3, 3, 4));
+  EXPECT_EQ(2u, hg::util::BoxReducer::reducedSize(3, 2));
+  EXPECT_EQ(1u, hg::util::BoxReducer::reducedSize(3, 4));
+}
@@ -0,0 +1,160 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/util/PngWriter.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <png.h>
+
+#include "hgkamva/util/ImageWriter.h"
+
+namespace hg
+{
+namespace util
+{
+namespace
+{
+// To the RGB(A) bytes with the straight alpha.
+void toPngRow(const unsigned char* src,
+    unsigned width,
+    bool hasAlpha,
+    png_byte* dst)
+{
+  if(!hasAlpha) {
+    swizzleToRgb(src, width, dst);
+    return;
+  }
+
+  for(unsigned x = 0; x < width; ++x) {
+    uint32_t pixel;
+    std::memcpy(&pixel, src + x * 4, 4);
+    unsigned alpha = pixel >> 24;
+    unsigned red = (pixel >> 16) & 0xFF;
+    unsigned green = (pixel >> 8) & 0xFF;
+    unsigned blue = pixel & 0xFF;
+    if(alpha != 0 && alpha != 255) {
+      red = (red * 255 + alpha / 2) / alpha;
+      green = (green * 255 + alpha / 2) / alpha;
+      blue = (blue * 255 + alpha / 2) / alpha;
+    }
+    *dst++ = static_cast<png_byte>(red);
+    *dst++ = static_cast<png_byte>(green);
+    *dst++ = static_cast<png_byte>(blue);
+    *dst++ = static_cast<png_byte>(alpha);
+  }
+}
+}  // namespace
+
+PngWriter::~PngWriter()
+{
+  destroy();
+}
+
+void PngWriter::destroy()
+{
+  if(mPng) {
+    png_destroy_write_struct(&mPng, mInfo ? &mInfo : nullptr);
+  }
+  mPng = nullptr;
+  mInfo = nullptr;
+  if(mFile) {
+    fclose(mFile);
+    mFile = nullptr;
+  }
+}
+
+bool PngWriter::open(const hg::filesystem::path& fileName,
+    unsigned width,
+    unsigned height,
+    bool hasAlpha)
+{
+  destroy();
+  mFile = fopen(fileName.c_str(), "wb");
+  if(!mFile) {
+    return false;
+  }
+
+  mPng =
+      png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+  mInfo = mPng ? png_create_info_struct(mPng) : nullptr;
+  if(!mInfo) {
+    destroy();
+    return false;
+  }
+
+  mWidth = width;
+  mHeight = height;
+  mRow = 0;
+  mHasAlpha = hasAlpha;
+  mRowBuffer.resize(width * (hasAlpha ? 4 : 3));
+
+  // The libpng's errors jump back here.
+  if(setjmp(png_jmpbuf(mPng))) {
+    destroy();
+    return false;
+  }
+  png_init_io(mPng, mFile);
+  png_set_IHDR(mPng, mInfo, width, height, 8,
+      hasAlpha ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB,
+      PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+      PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(mPng, mInfo);
+  return true;
+}
+
+bool PngWriter::writeRows(
+    const unsigned char* buf, unsigned rowCount, int stride)
+{
+  if(!mPng) {
+    return false;
+  }
+  if(setjmp(png_jmpbuf(mPng))) {
+    destroy();
+    return false;
+  }
+  for(unsigned y = 0; y < rowCount && mRow < mHeight; ++y, ++mRow) {
+    toPngRow(buf + y * stride, mWidth, mHasAlpha, mRowBuffer.data());
+    png_write_row(mPng, mRowBuffer.data());
+  }
+  return true;
+}
+
+bool PngWriter::close()
+{
+  if(!mPng || mRow < mHeight) {
+    destroy();
+    return false;
+  }
+  if(setjmp(png_jmpbuf(mPng))) {
+    destroy();
+    return false;
+  }
+  png_write_end(mPng, nullptr);
+  destroy();
+  return true;
+}
+
+}  // namespace util
+}  // namespace hg
@@ -0,0 +1,76 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_PNG_WRITER_H
+#define HG_PNG_WRITER_H
+
+#include <cstdio>
+#include <vector>
+
+#include "hgkamva/util/Filesystem.h"
+
+struct png_struct_def;
+struct png_info_def;
+
+namespace hg
+{
+namespace util
+{
+// Writes the PNG file by the rows, only the row buffer is kept.
+// The pixels are 32 bits native endian (cairo's ARGB32 with
+// the premultiplied alpha or RGB24).
+class PngWriter
+{
+public:
+  PngWriter() = default;
+  ~PngWriter();
+
+  PngWriter(const PngWriter&) = delete;
+  PngWriter& operator=(const PngWriter&) = delete;
+
+  bool open(const hg::filesystem::path& fileName,
+      unsigned width,
+      unsigned height,
+      bool hasAlpha);
+  // Writes the next rows, the rows over the image height are not written.
+  bool writeRows(const unsigned char* buf, unsigned rowCount, int stride);
+  // Returns false if not all rows are written.
+  bool close();
+
+private:
+  void destroy();
+
+  FILE* mFile = nullptr;
+  png_struct_def* mPng = nullptr;
+  png_info_def* mInfo = nullptr;
+  unsigned mWidth = 0;
+  unsigned mHeight = 0;
+  unsigned mRow = 0;
+  bool mHasAlpha = false;
+  std::vector<unsigned char> mRowBuffer;
+};  // class PngWriter
+
+}  // namespace util
+}  // namespace hg
+
+#endif  // HG_PNG_WRITER_H
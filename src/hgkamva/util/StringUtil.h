@@ -24,6 +24,8 @@
 #ifndef HG_STRING_UTIL_H
 #define HG_STRING_UTIL_H
 
+#include <algorithm>
+#include <cstddef>
 #include <string>
 
 namespace hg
@@ -38,6 +40,75 @@ inline bool stringEndsWith(std::string const& value, std::string const& ending)
   return std::equal(ending.rbegin(), ending.rend(), value.rbegin());
 }
 
+// The number of the UTF-8 characters in the byteCount bytes.
+inline std::size_t utf8Length(const char* text, std::size_t byteCount)
+{
+  std::size_t length = 0;
+  for(std::size_t i = 0; i < byteCount; ++i) {
+    // Do not count the continuation bytes 10xxxxxx.
+    if((static_cast<unsigned char>(text[i]) & 0xC0) != 0x80) {
+      ++length;
+    }
+  }
+  return length;
+}
+
+// The number of the UTF-8 characters in the first byteCount bytes.
+inline std::size_t utf8Length(
+    const std::string& text, std::size_t byteCount = std::string::npos)
+{
+  return utf8Length(text.data(), std::min(byteCount, text.size()));
+}
+
+// The byte offset of the UTF-8 character charOffset,
+// text.size() if it is out of the text.
+inline std::size_t utf8ByteOffset(
+    const std::string& text, std::size_t charOffset)
+{
+  for(std::size_t i = 0; i < text.size(); ++i) {
+    if((static_cast<unsigned char>(text[i]) & 0xC0) != 0x80) {
+      if(0 == charOffset) {
+        return i;
+      }
+      --charOffset;
+    }
+  }
+  return text.size();
+}
+
+// Simple lower case folding of the UTF-8 text in place, the byte length
+// of the text is kept. Folds ASCII, Latin-1, Greek and Cyrillic letters.
+inline void utf8FoldCase(std::string& text)
+{
+  for(std::size_t i = 0; i < text.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(text[i]);
+    if(c >= 'A' && c <= 'Z') {
+      text[i] = static_cast<char>(c + ('a' - 'A'));
+      continue;
+    }
+    if((c & 0xE0) != 0xC0 || i + 1 >= text.size()) {
+      continue;
+    }
+
+    // Two bytes character.
+    unsigned int code = ((c & 0x1F) << 6)
+        | (static_cast<unsigned char>(text[i + 1]) & 0x3F);
+    if((code >= 0xC0 && code <= 0xDE && code != 0xD7)
+        || (code >= 0x391 && code <= 0x3A9 && code != 0x3A2)
+        || (code >= 0x410 && code <= 0x42F)) {
+      code += 0x20;
+    } else if(code >= 0x400 && code <= 0x40F) {
+      code += 0x50;
+    } else {
+      ++i;
+      continue;
+    }
+    text[i] = static_cast<char>(0xC0 | (code >> 6));
+    text[i + 1] = static_cast<char>(0x80 | (code & 0x3F));
+    ++i;
+  }
+}
+
 }  // namespace util
 }  // namespace hg
 
@@ -48,3 +48,29 @@ TEST(StringUtilTest, endsWith)
   EXPECT_TRUE(hg::util::stringEndsWith("The string's ending.", " ending."));
   EXPECT_FALSE(hg::util::stringEndsWith("The string's ending.", " begin."));
 }
+
+TEST(StringUtilTest, utf8Length)
+{
+  // "Ж" and "€" are 2 and 3 bytes.
+  std::string text = u8"aЖ€b";
+  EXPECT_EQ(4u, hg::util::utf8Length(text));
+  EXPECT_EQ(2u, hg::util::utf8Length(text, 3));
+  EXPECT_EQ(0u, hg::util::utf8Length(""));
+}
+
+TEST(StringUtilTest, utf8ByteOffset)
+{
+  std::string text = u8"aЖ€b";
+  EXPECT_EQ(0u, hg::util::utf8ByteOffset(text, 0));
+  EXPECT_EQ(1u, hg::util::utf8ByteOffset(text, 1));
+  EXPECT_EQ(3u, hg::util::utf8ByteOffset(text, 2));
+  EXPECT_EQ(6u, hg::util::utf8ByteOffset(text, 3));
+  EXPECT_EQ(text.size(), hg::util::utf8ByteOffset(text, 10));
+}
+
+TEST(StringUtilTest, utf8FoldCase)
+{
+  std::string text = u8"Hello ÀÉÞ×ß ΑΣΩ АЯЁЏ ąĄ 123";
+  hg::util::utf8FoldCase(text);
+  EXPECT_EQ(u8"hello àéþ×ß ασω аяёџ ąĄ 123", text);
+}
@@ -0,0 +1,75 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/util/ThreadPool.h"
+
+#include <algorithm>
+
+namespace hg
+{
+namespace util
+{
+ThreadPool::ThreadPool(unsigned int threadCount)
+    : mStopping(false)
+{
+  if(0 == threadCount) {
+    threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  mThreads.reserve(threadCount);
+  for(unsigned int i = 0; i < threadCount; ++i) {
+    mThreads.emplace_back(&ThreadPool::run, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mCondition.notify_all();
+  for(auto& thread : mThreads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::run()
+{
+  while(true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+      // The queued tasks are done before the stopping.
+      if(mTasks.empty()) {
+        return;
+      }
+      task = std::move(mTasks.front());
+      mTasks.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace util
+}  // namespace hg
@@ -0,0 +1,94 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#ifndef HG_THREAD_POOL_H
+#define HG_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace hg
+{
+namespace util
+{
+// The fixed number of the threads running the submitted tasks
+// in the order of the submitting. The destructor waits for all tasks.
+class ThreadPool
+{
+public:
+  // 0 is the number of the hardware threads.
+  explicit ThreadPool(unsigned int threadCount = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // The exception of the task is thrown by the future's get().
+  template <typename Func>
+  std::future<typename std::result_of<Func()>::type> submit(Func func);
+
+  unsigned int threadCount() const;
+
+private:
+  void run();
+
+  std::vector<std::thread> mThreads;
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  std::deque<std::function<void()>> mTasks;
+  bool mStopping;
+};  // class ThreadPool
+
+template <typename Func>
+std::future<typename std::result_of<Func()>::type> ThreadPool::submit(
+    Func func)
+{
+  using Result = typename std::result_of<Func()>::type;
+
+  // std::function needs the copyable task.
+  auto task = std::make_shared<std::packaged_task<Result()>>(std::move(func));
+  std::future<Result> future = task->get_future();
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTasks.emplace_back([task]() { (*task)(); });
+  }
+  mCondition.notify_one();
+  return future;
+}
+
+inline unsigned int ThreadPool::threadCount() const
+{
+  return static_cast<unsigned int>(mThreads.size());
+}
+
+}  // namespace util
+}  // namespace hg
+
+#endif  // HG_THREAD_POOL_H
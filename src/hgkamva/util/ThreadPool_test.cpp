@@ -0,0 +1,69 @@
+/*****************************************************************************
+ * Project:  HtmlGrapheas
+ * Purpose:  HTML text editor library
+ * Author:   NikitaFeodonit, nfeodonit@yandex.com
+ *****************************************************************************
+ *   Copyright (c) 2017-2018 NikitaFeodonit
+ *
+ *    This file is part of the HtmlGrapheas project.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published
+ *    by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *    See the GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+
+#include "hgkamva/util/ThreadPool.h"
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+TEST(ThreadPoolTest, submit)
+{
+  std::atomic<int> counter{0};
+  std::vector<std::future<int>> results;
+  {
+    hg::util::ThreadPool pool(4);
+    EXPECT_EQ(4u, pool.threadCount());
+    for(int i = 0; i < 100; ++i) {
+      results.push_back(pool.submit([&counter, i]() {
+        ++counter;
+        return i * i;
+      }));
+    }
+    for(int i = 0; i < 100; ++i) {
+      EXPECT_EQ(i * i, results[i].get());
+    }
+  }
+  EXPECT_EQ(100, counter);
+
+  hg::util::ThreadPool defaultPool;
+  EXPECT_GE(defaultPool.threadCount(), 1u);
+  std::future<void> failed =
+      defaultPool.submit([]() { throw std::logic_error("failed"); });
+  EXPECT_THROW(failed.get(), std::logic_error);
+}
+
+TEST(ThreadPoolTest, destructorWaitsTasks)
+{
+  std::atomic<int> counter{0};
+  {
+    hg::util::ThreadPool pool(2);
+    for(int i = 0; i < 50; ++i) {
+      pool.submit([&counter]() { ++counter; });
+    }
+  }
+  EXPECT_EQ(50, counter);
+}